@@ -30,6 +30,27 @@
 #include "gui_dlg.h"
 
 #include "config_file.h"
+#include "band_switch.h"
+#include "srate_switch.h"
+#include "control_latency.h"
+
+#include "tcp_server.h"
+#include "rtl_tcp_client.h"
+#include "udp_sender.h"
+#include "shm_export.h"
+#include "sample_taps.h"
+#include "channelizer.h"
+#include "spectrum.h"
+#include "sweep.h"
+#include "zoom_ddc.h"
+#include "dc_avoid.h"
+#include "ds_hilbert.h"
+#include "lo_chain.h"
+#include "resampler.h"
+#include "buffer_auto.h"
+#include "usb_calib.h"
+#include "device_profile.h"
+#include "rate_qual.h"
 
 #define LIBRTL_EXPORTS 1
 #include "ExtIO_RTL.h"
@@ -44,6 +65,8 @@
 #endif
 
 #include <new>
+#include <chrono>
+#include <mutex>
 
 #define ALWAYS_PCMU8  1
 #define ALWAYS_PCM16  0
@@ -70,6 +93,7 @@ int VAR_ALWAYS_PCM16 = ALWAYS_PCM16;
 
 extern "C" int  LIBRTL_API EXTIO_CALL SetAttenuator(int atten_idx);
 extern "C" int  LIBRTL_API EXTIO_CALL ExtIoSetMGC(int mgc_idx);
+static void update_host_sample_format();
 
 
 
@@ -91,6 +115,11 @@ bool SDRsupportsLogging = false;
 bool SDRsupportsSamplePCMU8 = false;
 bool SDRsupportsSampleFormats = false;
 
+// decimated output (zoom, direct sampling conversion): 0: host's format, 1: 16 bit, 2: float
+static std::atomic_int decimated_format = 1;
+// sample format of the host's stream - as signalled to the host
+static std::atomic_int host_format = SAMPLE_U8;
+
 
 #define MAX_BUFFER_LEN    (256*1024)
 #define NUM_BUFFERS_BEFORE_CALLBACK   ( MAX_DECIMATIONS + 1 )
@@ -109,6 +138,15 @@ std::atomic_bool retune_freq = false;
 
 std::atomic_int bufferSizeIdx = 6;// 64 kBytes
 std::atomic_int buffer_len = buffer_sizes[6];
+std::atomic_int usbBufferSizeIdx = -1;  // -1: same as bufferSizeIdx
+std::atomic_int usb_buffer_len = 0;     // USB transfer size of the running stream
+std::atomic_int usbBufferNum = 0;       // number of USB transfers. 0: librtlsdr's default
+static std::atomic_int usb_buffer_num = 0;  // number of USB transfers of the running stream
+
+// reblocking of USB transfers into the host's blocks - only accessed from the RX thread
+static uint32_t host_block_len = 0;
+static uint8_t* reblockBuf = nullptr;
+static uint32_t reblock_fill = 0;
 
 static int HDSDR_AGC = 2;
 
@@ -120,6 +158,11 @@ std::atomic_bool ThreadStreamToSDR = false;
 static bool GUIDebugConnection = false;
 static volatile HANDLE RX_thread_handle = INVALID_HANDLE_VALUE;
 static volatile HANDLE ConnCheck_thread_handle = INVALID_HANDLE_VALUE;
+std::atomic_bool terminate_Supervise_Thread = false;
+static volatile HANDLE Supervise_thread_handle = INVALID_HANDLE_VALUE;
+// host's StartHW(), StopHW(), CloseHW(), SetHWLO() and ExtIoSetSrate() against the
+//   supervise thread's stream restarts. recursive: StartHW() calls SetHWLO()
+static std::recursive_mutex hw_mtx;
 
 void RX_ThreadProc(void* param);
 int Start_RX_Thread();
@@ -129,6 +172,10 @@ void ConnCheck_ThreadProc(void* param);
 int Start_ConnCheck_Thread();
 int Stop_ConnCheck_Thread();
 
+void Supervise_ThreadProc(void* param);
+int Start_Supervise_Thread();
+int Stop_Supervise_Thread();
+
 
 /* ExtIO Callback */
 pfnExtIOCallback gpfnExtIOCallbackPtr = NULL;
@@ -221,6 +268,7 @@ bool  LIBRTL_API EXTIO_CALL InitHW(char* name, char* model, int& type)
   }
 
   type = extHWtype;
+  host_format = (extHWtype == exthwUSBdata16) ? SAMPLE_PCM16 : SAMPLE_U8;
   return TRUE;
 }
 
@@ -250,18 +298,26 @@ bool  LIBRTL_API EXTIO_CALL OpenHW()
   }
   post_update_gui_init();  // post_update_gui_fields();
 
+  // .cfg file overrides the host's stored setting
+  const std::optional<int> cfg_buf_num = get_config_usb_buf_num();
+  if (cfg_buf_num && *cfg_buf_num >= 0 && *cfg_buf_num <= 64)
+    usbBufferNum = *cfg_buf_num;
+
   Start_ConnCheck_Thread();
 
   return true;
 }
 
 
-static CtrlFlagT _setHwLO_check_bands(int64_t freq)
+// band_switched: true when moving into another band - then n_changes is its number of changed values
+static CtrlFlagT _setHwLO_check_bands(int64_t freq, bool& band_switched, unsigned& n_changes)
 {
   static std::string last_band_name{};
   static char acMsg[256];
   static bool last_was_undefined_band = false;
   CtrlFlagT changed_flags = 0;
+  band_switched = false;
+  n_changes = 0;
   const BandAction::Band_Info bi = get_band_info();
   if (bi != BandAction::Band_Info::info_ok)
     return changed_flags;
@@ -269,7 +325,8 @@ static CtrlFlagT _setHwLO_check_bands(int64_t freq)
   if (nxt.LO_freq.load() == freq && !last_band_name.empty())
     return changed_flags;
 
-  const BandAction* new_band = update_band_action(double(freq));
+  bool entered = false;
+  const BandAction* new_band = update_band_action(double(freq), entered);
   if (!new_band)
   {
     if (!last_was_undefined_band)
@@ -281,12 +338,15 @@ static CtrlFlagT _setHwLO_check_bands(int64_t freq)
     }
     return changed_flags;
   }
+  if (!entered)
+    return changed_flags;   // still in the same band
 
   // we are now moving into a new band with some defined action(s)
   const BandAction& ba = *new_band;   // have a shorter alias
 
   const std::string& new_band_name = (ba.name.has_value()) ? ba.name.value() : ba.id;
-  const bool update_band_name = is_gui_available() && (last_band_name.empty() || new_band_name != last_band_name);
+  const bool update_band_name = is_gui_available()
+    && (last_band_name.empty() || last_was_undefined_band || new_band_name != last_band_name);
   if (update_band_name)
   {
     last_band_name = new_band_name;
@@ -296,99 +356,9 @@ static CtrlFlagT _setHwLO_check_bands(int64_t freq)
     SDRLG(extHw_MSG_LOG, "new band name: '%s'", band_disp_text);
   }
 
-  if (ba.sampling_mode)
-  {
-    if (ba.sampling_mode.value() == 'I')
-      nxt.sampling_mode = 1;
-    else if (ba.sampling_mode.value() == 'Q')
-      nxt.sampling_mode = 2;
-    else if (ba.sampling_mode.value() == 'C')
-      nxt.sampling_mode = 0;
-    changed_flags |= CtrlFlags::sampling_mode;  // direct sampling mode;
-  }
-
-  if (ba.rtl_digital_agc)
-  {
-    nxt.rtl_agc = ba.rtl_digital_agc.value() ? 1 : 0;
-    changed_flags |= CtrlFlags::rtl_agc;  // rtl agc
-  }
-
-  if (ba.tuner_rf_agc)
-  {
-    nxt.tuner_rf_agc = ba.tuner_rf_agc.value() ? 1 : 0;
-    changed_flags |= CtrlFlags::rf_agc;
-  }
-
-  if (ba.tuner_if_agc)
-  {
-    nxt.tuner_if_agc = ba.tuner_if_agc.value() ? 1 : 0;
-    changed_flags |= CtrlFlags::if_agc_gain;
-  }
-
-  if (ba.tuning_sideband)
-  {
-    if (ba.tuning_sideband.value() == 'L')
-      nxt.USB_sideband = 0;
-    else if (ba.tuning_sideband.value() == 'U')
-      nxt.USB_sideband = 1;
-    changed_flags |= CtrlFlags::tuner_sideband;
-  }
-
-  if (ba.gpio_button0)
-    nxt.GPIO[0] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button1)
-    nxt.GPIO[1] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button2)
-    nxt.GPIO[2] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button3)
-    nxt.GPIO[3] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button4)
-    nxt.GPIO[4] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button0 || ba.gpio_button1 || ba.gpio_button2 || ba.gpio_button3 || ba.gpio_button4)
-    changed_flags |= CtrlFlags::gpio;
-
-  if (ba.tuner_rf_gain_db)
-  {
-    nxt.tuner_rf_agc = 0;    // also deactivate AGC
-    const int rf_gain_tenth_db = int(ba.tuner_rf_gain_db.value() * 10.0);
-    if (GotTunerInfo && tunerNo < tuners::N)
-    {
-      int gainIdx = nearestGainIdx(rf_gain_tenth_db, tuners::rf_gains[tunerNo].gain, tuners::rf_gains[tunerNo].num);
-      if (gainIdx >= 0 && gainIdx < tuners::rf_gains[tunerNo].num)
-        nxt.rf_gain = tuners::rf_gains[tunerNo].gain[gainIdx];
-    }
-    changed_flags |= (CtrlFlags::rf_agc | CtrlFlags::rf_gain);
-  }
-  else if (ba.tuner_rf_gain_db && GotTunerInfo && tunerNo < tuners::N)
-  {
-    nxt.tuner_rf_agc = 0;    // also deactivate AGC
-    const int rf_gain_tenth_db = int(ba.tuner_rf_gain_db.value() * 10.0);
-    int gainIdx = nearestGainIdx(rf_gain_tenth_db, tuners::rf_gains[tunerNo].gain, tuners::rf_gains[tunerNo].num);
-    SetAttenuator(gainIdx);
-  }
-
-  if (ba.tuner_if_gain_db)
-  {
-    nxt.tuner_if_agc = 0;    // also deactivate AGC
-    int if_gain_tenth_db = int(ba.tuner_if_gain_db.value() * 10.0);
-    if (GotTunerInfo && tunerNo < tuners::N)
-    {
-      nxt.if_gain_idx = nearestGainIdx(if_gain_tenth_db, tuners::if_gains[tunerNo].gain, tuners::if_gains[tunerNo].num);
-      if (nxt.if_gain_idx >= 0 && nxt.if_gain_idx < tuners::if_gains[tunerNo].num)
-        nxt.if_gain_val = tuners::if_gains[tunerNo].gain[nxt.if_gain_idx];
-
-    }
-    changed_flags |= CtrlFlags::if_agc_gain;
-  }
-  else if (ba.tuner_if_gain_db && GotTunerInfo && tunerNo < tuners::N)
-  {
-    nxt.tuner_if_agc = 0;    // also deactivate AGC
-    const int if_gain_tenth_db = int(ba.tuner_if_gain_db.value() * 10.0);
-
-    int if_gain_idx = nearestGainIdx(if_gain_tenth_db, tuners::if_gains[tunerNo].gain, tuners::if_gains[tunerNo].num);
-    ExtIoSetMGC(if_gain_idx);
-  }
-
+  // the band's precompiled plan: only values differing from the live state
+  band_switched = true;
+  changed_flags = band_switch_apply(ba, n_changes);
 
   //if (!changed_flags.is_empty())  // update GUI fields on changes
   if (changed_flags || update_band_name)
@@ -402,13 +372,53 @@ static CtrlFlagT _setHwLO_check_bands(int64_t freq)
 }
 
 
+// the band's samplerate is commanded: the stream's boundary - and the host's new samplerate
+static void band_srate_changed(bool srate_switch, bool host_signalled)
+{
+  if (srate_switch)
+    srate_switch_end(usb_buffer_num.load() ? usb_buffer_num.load() : USB_DEFAULT_BUF_NUM);
+  gui_SetSrate(nxt.srate_idx);
+  if (!host_signalled)
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+}
+
+// SetHWLO() and SetHWLO64(): band plan, zoom, DC avoidance and direct sampling conversion
+//   on the host's frequency - then retune, with the band's samplerate switch
+static void _setHwLO(int64_t freq, const char* caller)
+{
+  std::lock_guard<std::recursive_mutex> lock(hw_mtx);
+  char acMsg[256];
+  const auto t0 = std::chrono::steady_clock::now();
+  const bool ds_hilbert_was_active = ds_hilbert_active();
+  bool band_switched = false;
+  unsigned band_changes = 0;
+  CtrlFlagT change_flags = _setHwLO_check_bands(freq, band_switched, band_changes);
+  // with zoom, the tuner's LO only follows when the zoomed band leaves the tuner's band
+  const int64_t host_LO = zoom_set_LO(freq, host_LO_from_hw(nxt.LO_freq.load()), rates::tab[nxt.srate_idx].valueInt);
+  // with DC avoidance, the tuner's LO is offset from the host's LO. a running sweep keeps it for its end
+  set_hw_LO_from_host(host_LO, nxt.tune_freq.load()); // +nxt.band_center_LO_delta;
+  // the band's sampling mode may switch the direct sampling conversion - with its half samplerate
+  const bool ds_toggled = (ds_hilbert_active() != ds_hilbert_was_active);
+  if (ds_toggled)
+  {
+    update_host_sample_format();
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+  }
+  const bool srate_switch = (change_flags & CtrlFlags::srate) && ThreadStreamToSDR;
+  if (srate_switch)
+    srate_switch_begin(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()));
+  SDRLG(extHw_MSG_DEBUG, "%s() -> trigger_control()", caller);
+  trigger_control(change_flags | CtrlFlags::freq);
+  if (change_flags & CtrlFlags::srate)
+    band_srate_changed(srate_switch, ds_toggled);
+  if (band_switched)
+    band_switch_record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count()), band_changes);
+}
+
 extern "C"
 long LIBRTL_API EXTIO_CALL SetHWLO(long freq)
 {
-  CtrlFlagT change_flags = _setHwLO_check_bands(freq);
-  nxt.LO_freq.store(freq); // +nxt.band_center_LO_delta;
-  SDRLOG(extHw_MSG_DEBUG, "SetHWLO() -> trigger_control()");
-  trigger_control(change_flags | CtrlFlags::freq);
+  _setHwLO(freq, "SetHWLO");
   return 0;
 }
 
@@ -416,10 +426,7 @@ long LIBRTL_API EXTIO_CALL SetHWLO(long freq)
 extern "C"
 int64_t LIBRTL_API EXTIO_CALL SetHWLO64(int64_t freq)
 {
-  CtrlFlagT change_flags = _setHwLO_check_bands(freq);
-  nxt.LO_freq.store(freq); // +nxt.band_center_LO_delta;
-  SDRLOG(extHw_MSG_DEBUG, "SetHWLO64() -> trigger_control()");
-  trigger_control(change_flags | CtrlFlags::freq);
+  _setHwLO(freq, "SetHWLO64");
   return 0;
 }
 
@@ -428,12 +435,20 @@ extern "C"
 void LIBRTL_API EXTIO_CALL TuneChanged64(int64_t tunefreq)
 {
   nxt.tune_freq = tunefreq;
+  const bool host_LO_changed = zoom_tune_changed(tunefreq);
+  dc_avoid_tune_changed(tunefreq);
+  if (host_LO_changed)
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
 }
 
 extern "C"
 void LIBRTL_API EXTIO_CALL TuneChanged(long tunefreq)
 {
   nxt.tune_freq = tunefreq;
+  const bool host_LO_changed = zoom_tune_changed(tunefreq);
+  dc_avoid_tune_changed(tunefreq);
+  if (host_LO_changed)
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
 }
 
 extern "C"
@@ -452,14 +467,16 @@ long LIBRTL_API EXTIO_CALL GetTune(void)
 extern "C"
 int LIBRTL_API EXTIO_CALL StartHW(long freq)
 {
+  std::lock_guard<std::recursive_mutex> lock(hw_mtx);
   char acMsg[256];
   SDRLG(extHw_MSG_DEBUG, "StartHW() with device handle 0x%p", RtlSdrDev);
 
+  rate_qual_stop();
   Stop_ConnCheck_Thread();
 
-  while (!RtlSdrDev || !is_device_handle_valid())
+  while (!is_device_open() || !is_device_handle_valid())
   {
-    if (!RtlSdrDev)
+    if (!is_device_open())
       SDRLOG(extHw_MSG_ERROR, "StartHW(): fail without open device");
     else
       SDRLOG(extHw_MSG_ERROR, "StartHW(): failed with invalid device handle");
@@ -500,15 +517,53 @@ int LIBRTL_API EXTIO_CALL StartHW(long freq)
     SDRLOG(extHw_MSG_DEBUG, "StartHW(): using 'other' sample type - NOT PCMU8 or PCM16!");
 
   ThreadStreamToSDR = true;
+  zoom_reset();
+  ds_hilbert_reset();
+  resample_reset();
+  update_host_sample_format();
+  if (buffer_auto.load())
+  {
+    const int idx = buffer_auto_select(bufferSizeIdx.load(), int(sizeof(buffer_sizes) / sizeof(buffer_sizes[0])),
+      RtlOpenDevice.serial, rates::tab[nxt.srate_idx].valueInt);
+    buffer_len = buffer_sizes[idx] * 1024;
+  }
+  // USB transfers are reblocked into the host's block size
+  host_block_len = uint32_t(buffer_len.load());
+  usb_buffer_len = (usbBufferSizeIdx.load() < 0) ? int(host_block_len) : buffer_sizes[usbBufferSizeIdx.load()] * 1024;
+  usb_buffer_num = usbBufferNum.load();
+  DeviceProfile profile;
+  if (RtlSdrDev && usb_calib_use.load() && device_profile_get(RtlOpenDevice.serial, profile)
+    && profile.tuner_type == int(tunerNo.load()) && profile.usb_srate == rates::tab[nxt.srate_idx].valueInt)
+  {
+    usb_buffer_num = profile.usb_buf_num;
+    usb_buffer_len = profile.usb_buf_len;
+  }
+  reblock_fill = 0;
+  srate_switch_reset();
   if (Start_RX_Thread() < 0)
   {
     SDRLOG(extHw_MSG_ERROR, "StartHW(): Error to start streaming thread");
     return -1;
   }
   SDRLOG(extHw_MSG_DEBUG, "StartHW(): Started streaming thread");
+  Start_Supervise_Thread();
+
+  if (tcp_server_port.load() > 0 && !tcp_server_start())
+    SDRLOG(extHw_MSG_ERROR, "StartHW(): Error starting rtl_tcp server");
+  if (udp_out_host[0] && !udp_sender_start())
+    SDRLOG(extHw_MSG_ERROR, "StartHW(): Error starting UDP output");
+  if (shm_export_name[0] && !shm_export_start())
+    SDRLOG(extHw_MSG_ERROR, "StartHW(): Error starting shared memory export");
+  power_meter_start();
+  channelizer_start();
+  if (spectrum_enabled.load() && !spectrum_start())
+    SDRLOG(extHw_MSG_ERROR, "StartHW(): Error starting spectrum");
 
   commandEverything = true;
   SetHWLO(freq);
+  // sweep takes over the LO after the host's frequency is set
+  if (sweep_enabled.load() && !sweep_start())
+    SDRLOG(extHw_MSG_ERROR, "StartHW(): Error starting sweep");
 
   DisableGUIControlsAtStart();
 
@@ -516,7 +571,8 @@ int LIBRTL_API EXTIO_CALL StartHW(long freq)
   // else, we get just 64 = 512 / 8 I/Q Samples with 1 kB bufferSize!
   int numIQpairs = buffer_len / 2;
 
-  snprintf(acMsg, 255, "StartHW() = %d. Callback will deliver %d I/Q pairs per call", numIQpairs, numIQpairs);
+  snprintf(acMsg, 255, "StartHW() = %d. Callback will deliver %d I/Q pairs per call, from %d USB transfers of %d bytes", numIQpairs, numIQpairs,
+    usb_buffer_num.load() ? usb_buffer_num.load() : USB_DEFAULT_BUF_NUM, usb_buffer_len.load());
   SDRLOG(extHw_MSG_DEBUG, acMsg);
 
   return numIQpairs;
@@ -526,36 +582,99 @@ int LIBRTL_API EXTIO_CALL StartHW(long freq)
 extern "C"
 int64_t LIBRTL_API EXTIO_CALL GetHWLO64()
 {
-  return nxt.LO_freq;
+  return zoom_host_LO(host_LO_from_hw(nxt.LO_freq.load()));
 }
 
 extern "C"
 long LIBRTL_API EXTIO_CALL GetHWLO()
 {
-  return (long)nxt.LO_freq;
+  return (long)zoom_host_LO(host_LO_from_hw(nxt.LO_freq.load()));
+}
+
+// samplerate reduction of the host's stream: zoom or direct sampling conversion
+static int host_decimation()
+{
+  return (zoom_active() ? zoom_decimation.load() : 1) * ds_hilbert_decimation();
+}
+
+// decimated streams keep their added resolution in 16 bit or float - when the host supports format changes
+static SampleFormat host_sample_format()
+{
+  if ((host_decimation() > 1 || resample_active()) && SDRsupportsSampleFormats)
+  {
+    if (decimated_format.load() == 1)
+      return SAMPLE_PCM16;
+    if (decimated_format.load() == 2)
+      return SAMPLE_FLT32;
+  }
+  return (extHWtype == exthwUSBdata16) ? SAMPLE_PCM16 : SAMPLE_U8;
+}
+
+static void update_host_sample_format()
+{
+  const SampleFormat fmt = host_sample_format();
+  if (fmt == host_format.load())
+    return;
+  host_format = fmt;
+  if (gpfnExtIOCallbackPtr)
+  {
+    if (fmt == SAMPLE_FLT32)
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_SampleFormat_FLT32);
+    else if (fmt == SAMPLE_PCM16)
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_SampleFormat_PCM16);
+    else
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_SampleFormat_PCMU8);
+  }
+}
+
+// direct sampling conversion switched on/off: keep the host's LO, signal the new samplerate
+static void ds_hilbert_switched(int64_t host_LO)
+{
+  const int64_t base_LO = zoom_set_LO(host_LO, host_LO_from_hw(nxt.LO_freq.load()), rates::tab[nxt.srate_idx].valueInt);
+  set_hw_LO_from_host(base_LO, nxt.tune_freq.load());
+  trigger_control(CtrlFlags::freq);
+  update_host_sample_format();
+  if (gpfnExtIOCallbackPtr)
+  {
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
+  }
 }
 
 
 extern "C"
 long LIBRTL_API EXTIO_CALL GetHWSR()
 {
+  if (resample_active())
+    return resample_rate.load();
   long sr = long(rates::tab[nxt.srate_idx].valueInt);
 #if ( FULL_DECIMATION )
   sr /= nxt.decimation;
 #endif
+  sr /= host_decimation();
   return sr;
 }
 
 extern "C"
 int LIBRTL_API EXTIO_CALL ExtIoGetSrates(int srate_idx, double* samplerate)
 {
-  if (srate_idx < rates::N)
+  // resampling: the host sees only the output rate
+  if (resample_active())
+  {
+    if (srate_idx != 0)
+      return 1;
+    *samplerate = resample_rate.load();
+    return 0;
+  }
+  // rates above the device's qualified max are hidden - but not the selected one
+  if (srate_idx < rates::N && (rate_qual_stable(rates::tab[srate_idx].valueInt) || srate_idx <= nxt.srate_idx))
   {
 #if ( FULL_DECIMATION )
     *samplerate = rates::tab[srate_idx].value / nxt.decimation;
 #else
     * samplerate = rates::tab[srate_idx].value;
 #endif
+    *samplerate /= host_decimation();
     return 0;
   }
   return 1; // ERROR
@@ -564,10 +683,17 @@ int LIBRTL_API EXTIO_CALL ExtIoGetSrates(int srate_idx, double* samplerate)
 extern "C"
 long LIBRTL_API EXTIO_CALL ExtIoGetBandwidth(int srate_idx)
 {
+  if (resample_active())
+  {
+    long bw = (srate_idx == 0) ? resample_rate.load() * 3L / 4L : 0L;
+    if (nxt.tuner_bw && nxt.tuner_bw * 1000L < bw)
+      bw = nxt.tuner_bw * 1000L;
+    return bw;
+  }
   if (srate_idx < rates::N)
   {
     // ~ 3/4 of spectrum usable
-    long bw = rates::tab[srate_idx].valueInt * 3L / (nxt.decimation * 4L);
+    long bw = rates::tab[srate_idx].valueInt * 3L / (nxt.decimation * host_decimation() * 4L);
     if (nxt.tuner_bw && nxt.tuner_bw * 1000L < bw)
       bw = nxt.tuner_bw * 1000L;
     return bw;
@@ -578,12 +704,17 @@ long LIBRTL_API EXTIO_CALL ExtIoGetBandwidth(int srate_idx)
 extern "C"
 int  LIBRTL_API EXTIO_CALL ExtIoGetActualSrateIdx(void)
 {
+  if (resample_active())
+    return 0;
   return nxt.srate_idx;
 }
 
 extern "C"
 int  LIBRTL_API EXTIO_CALL ExtIoSetSrate(int srate_idx)
 {
+  std::lock_guard<std::recursive_mutex> lock(hw_mtx);
+  if (resample_active())
+    return (srate_idx == 0) ? 0 : 1;   // the plan selects the ADC rate
   if (srate_idx >= 0 && srate_idx < rates::N)
   {
     SDRLOG(extHw_MSG_DEBUG, "ExtIoSetSrate() -> trigger_control()");
@@ -792,6 +923,84 @@ enum class Setting {
   , RTL_AAGC_KRF3
   , RTL_AAGC_KRF4
 
+  , TCP_SERVER_PORT
+  , TCP_SERVER_BIND_ANY
+  , TCP_SERVER_MAX_CLIENTS
+  , TCP_SERVER_SLOW_CLIENT
+  , TCP_SERVER_ALLOW_CONTROL
+
+  , RTL_TCP_CLIENT_HOST
+  , RTL_TCP_CLIENT_PORT
+  , RTL_TCP_CLIENT_JITTER_MIN
+  , RTL_TCP_CLIENT_JITTER_MAX
+  , RTL_TCP_CLIENT_STATS
+
+  , RTL_TCP_CLIENT_COMPRESSION
+  , RTL_TCP_CLIENT_LOSSY_BITS
+  , TCP_SERVER_CODEC_STATS
+
+  , UDP_OUT_HOST
+  , UDP_OUT_PORT
+  , UDP_OUT_TTL
+  , UDP_OUT_PAYLOAD
+  , UDP_OUT_STATS
+
+  , SHM_EXPORT_NAME
+
+  , SAMPLE_TAPS_THREADS
+  , SAMPLE_TAPS_STATS
+  , POWER_METER
+  , POWER_METER_DBFS
+  , SPECTRUM
+  , SPECTRUM_FFT_SIZE
+  , SPECTRUM_WINDOW
+  , SPECTRUM_OVERLAP
+  , SPECTRUM_AVERAGES
+  , SPECTRUM_FORMAT
+  , SPECTRUM_FILE
+  , SPECTRUM_STATS
+  , SWEEP
+  , SWEEP_START_FREQ
+  , SWEEP_STOP_FREQ
+  , SWEEP_OVERLAP
+  , SWEEP_DWELL
+  , SWEEP_SETTLE
+  , SWEEP_FILE
+  , SWEEP_STATS
+  , CHANNELIZER
+  , CHANNELIZER_CHANNELS
+  , CHANNELIZER_DECIMATION
+  , CHANNELIZER_FREQS
+  , CHANNELIZER_LEVELS
+  , CHANNELIZER_STATS
+  , ZOOM_DECIMATION
+  , ZOOM_FOLLOW_TUNE
+  , ZOOM_STATS
+  , DC_AVOID
+  , DC_AVOID_OFFSET
+  , DS_HILBERT
+  , DECIMATED_FORMAT
+  , OUTPUT_BITS
+  , RESAMPLE_RATE
+  , RESAMPLE_STATS
+  , BUFFER_AUTO
+  , BUFFER_AUTO_DUTY
+  , BUFFER_AUTO_STATS
+  , USB_BUFFER_SIZE_IDX
+  , USB_BUF_NUM
+  , USB_CALIB_USE
+  , USB_CALIBRATE
+  , USB_CALIB_STATS
+  , RATE_QUALIFY
+  , RATE_QUAL_STATS
+  , BAND_PLAN_STATS
+  , BAND_SWITCH_STATS
+  , SRATE_SWITCH_STATS
+  , CONTROL_BATCHED
+  , CONTROL_STATS
+  , CONTROL_LATENCY_STATS
+  , CONTROL_LATENCY_FILE
+
   , NUM   // Last One == Amount
 };
 
@@ -1048,6 +1257,315 @@ int   LIBRTL_API EXTIO_CALL ExtIoGetSetting(int idx, char* description, char* va
     snprintf(value, 1024, "%d", nxt.rtl_aagc_krf[3].load());
     return 0;
 
+  case Setting::TCP_SERVER_PORT:
+    snprintf(description, 1024, "%s", "rtl_tcp server: TCP port, e.g. 1234. 0: disabled");
+    snprintf(value, 1024, "%d", tcp_server_port.load());
+    return 0;
+  case Setting::TCP_SERVER_BIND_ANY:
+    snprintf(description, 1024, "%s", "rtl_tcp server: 0: localhost only, 1: all interfaces (LAN)");
+    snprintf(value, 1024, "%d", tcp_server_bind_any.load());
+    return 0;
+  case Setting::TCP_SERVER_MAX_CLIENTS:
+    snprintf(description, 1024, "%s", "rtl_tcp server: maximum number of simultaneous clients");
+    snprintf(value, 1024, "%d", tcp_server_max_clients.load());
+    return 0;
+  case Setting::TCP_SERVER_SLOW_CLIENT:
+    snprintf(description, 1024, "%s", "rtl_tcp server: slow clients: 0: drop connection, 1: skip samples");
+    snprintf(value, 1024, "%d", tcp_server_slow_client.load());
+    return 0;
+  case Setting::TCP_SERVER_ALLOW_CONTROL:
+    snprintf(description, 1024, "%s", "rtl_tcp server: 0: ignore client commands, 1: apply (frequency, gain, ..)");
+    snprintf(value, 1024, "%d", tcp_server_allow_control.load());
+    return 0;
+
+  case Setting::RTL_TCP_CLIENT_HOST:
+    snprintf(description, 1024, "%s", "rtl_tcp client: remote server host name or address. empty: use local USB devices");
+    snprintf(value, 1024, "%s", rtl_tcp_client_host);
+    return 0;
+  case Setting::RTL_TCP_CLIENT_PORT:
+    snprintf(description, 1024, "%s", "rtl_tcp client: remote server TCP port");
+    snprintf(value, 1024, "%d", rtl_tcp_client_port.load());
+    return 0;
+  case Setting::RTL_TCP_CLIENT_JITTER_MIN:
+    snprintf(description, 1024, "%s", "rtl_tcp client: minimum jitter buffer prefetch in ms");
+    snprintf(value, 1024, "%d", rtl_tcp_client_jitter_min_ms.load());
+    return 0;
+  case Setting::RTL_TCP_CLIENT_JITTER_MAX:
+    snprintf(description, 1024, "%s", "rtl_tcp client: maximum jitter buffer prefetch in ms");
+    snprintf(value, 1024, "%d", rtl_tcp_client_jitter_max_ms.load());
+    return 0;
+  case Setting::RTL_TCP_CLIENT_STATS:
+    {
+      RtlTcpClientStats s;
+      char codec[256] = "raw";
+      rtl_tcp_client_get_stats(s);
+      if (s.compressed)
+        rtl_tcp_client_codec_stats(codec, 256);
+      snprintf(description, 1024, "%s", "rtl_tcp client: statistics (read only)");
+      snprintf(value, 1024, "depth %d ms, target %d ms, underruns %llu, overruns %llu, received %llu bytes, %s",
+        s.depth_ms, s.target_ms, (unsigned long long)s.underruns, (unsigned long long)s.overruns,
+        (unsigned long long)s.received_bytes, codec);
+    }
+    return 0;
+
+  case Setting::RTL_TCP_CLIENT_COMPRESSION:
+    snprintf(description, 1024, "%s", "rtl_tcp client: request compression. 0: raw, 1: lossless, 2: lossy. server must be this plugin");
+    snprintf(value, 1024, "%d", rtl_tcp_client_compression.load());
+    return 0;
+  case Setting::RTL_TCP_CLIENT_LOSSY_BITS:
+    snprintf(description, 1024, "%s", "rtl_tcp client: bits per sample for lossy compression: 1 .. 7");
+    snprintf(value, 1024, "%d", rtl_tcp_client_lossy_bits.load());
+    return 0;
+  case Setting::TCP_SERVER_CODEC_STATS:
+    snprintf(description, 1024, "%s", "rtl_tcp server: compression statistics (read only)");
+    tcp_server_codec_stats(value, 1024);
+    return 0;
+
+  case Setting::UDP_OUT_HOST:
+    snprintf(description, 1024, "%s", "UDP output: destination address, unicast or multicast. empty: disabled");
+    snprintf(value, 1024, "%s", udp_out_host);
+    return 0;
+  case Setting::UDP_OUT_PORT:
+    snprintf(description, 1024, "%s", "UDP output: destination port");
+    snprintf(value, 1024, "%d", udp_out_port.load());
+    return 0;
+  case Setting::UDP_OUT_TTL:
+    snprintf(description, 1024, "%s", "UDP output: time to live for multicast: 1 stays in the local network");
+    snprintf(value, 1024, "%d", udp_out_ttl.load());
+    return 0;
+  case Setting::UDP_OUT_PAYLOAD:
+    snprintf(description, 1024, "%s", "UDP output: I/Q bytes per packet: 256 .. 65000. keep below MTU to avoid fragmentation");
+    snprintf(value, 1024, "%d", udp_out_payload.load());
+    return 0;
+  case Setting::UDP_OUT_STATS:
+    snprintf(description, 1024, "%s", "UDP output: statistics (read only)");
+    snprintf(value, 1024, "sent %llu packets, dropped %llu packets",
+      (unsigned long long)udp_sender_sent_packets(), (unsigned long long)udp_sender_dropped_packets());
+    return 0;
+
+  case Setting::SHM_EXPORT_NAME:
+    snprintf(description, 1024, "%s", "shared memory export: name of the I/Q ring, e.g. ExtIO_RTL_IQ. empty: disabled");
+    snprintf(value, 1024, "%s", shm_export_name);
+    return 0;
+
+  case Setting::SAMPLE_TAPS_THREADS:
+    snprintf(description, 1024, "%s", "sample taps: number of pool threads for in-process processors: 1 .. 8");
+    snprintf(value, 1024, "%d", sample_taps_threads.load());
+    return 0;
+  case Setting::SAMPLE_TAPS_STATS:
+    snprintf(description, 1024, "%s", "sample taps: statistics per tap (read only)");
+    sample_taps_format_stats(value, 1024);
+    return 0;
+  case Setting::POWER_METER:
+    snprintf(description, 1024, "%s", "power meter: 0: off, 1: measure mean power of the stream");
+    snprintf(value, 1024, "%d", power_meter_enabled.load());
+    return 0;
+  case Setting::POWER_METER_DBFS:
+    snprintf(description, 1024, "%s", "power meter: mean power in dBFS (read only)");
+    snprintf(value, 1024, "%.1f", power_meter_dBFS());
+    return 0;
+  case Setting::SPECTRUM:
+    snprintf(description, 1024, "%s", "spectrum: 0: off, 1: log averaged power spectrum beside the stream");
+    snprintf(value, 1024, "%d", spectrum_enabled.load());
+    return 0;
+  case Setting::SPECTRUM_FFT_SIZE:
+    snprintf(description, 1024, "%s", "spectrum: FFT size, power of 2: 16 .. 65536");
+    snprintf(value, 1024, "%d", spectrum_fft_size.load());
+    return 0;
+  case Setting::SPECTRUM_WINDOW:
+    snprintf(description, 1024, "%s", "spectrum: window 0: rectangle, 1: Hann, 2: Blackman-Harris");
+    snprintf(value, 1024, "%d", spectrum_window.load());
+    return 0;
+  case Setting::SPECTRUM_OVERLAP:
+    snprintf(description, 1024, "%s", "spectrum: overlap of FFT frames in percent: 0 .. 90");
+    snprintf(value, 1024, "%d", spectrum_overlap.load());
+    return 0;
+  case Setting::SPECTRUM_AVERAGES:
+    snprintf(description, 1024, "%s", "spectrum: number of averaged FFTs per line");
+    snprintf(value, 1024, "%d", spectrum_averages.load());
+    return 0;
+  case Setting::SPECTRUM_FORMAT:
+    snprintf(description, 1024, "%s", "spectrum: log format 0: CSV like rtl_power, 1: binary, 2: archive with time/frequency index");
+    snprintf(value, 1024, "%d", spectrum_format.load());
+    return 0;
+  case Setting::SPECTRUM_FILE:
+    snprintf(description, 1024, "%s", "spectrum: log filename");
+    snprintf(value, 1024, "%s", spectrum_file);
+    return 0;
+  case Setting::SPECTRUM_STATS:
+    snprintf(description, 1024, "%s", "spectrum: FFT statistics and capacity (read only)");
+    spectrum_format_stats(value, 1024);
+    return 0;
+  case Setting::SWEEP:
+    snprintf(description, 1024, "%s", "sweep: 0: off, 1: hop the LO and log stitched panorama spectra");
+    snprintf(value, 1024, "%d", sweep_enabled.load());
+    return 0;
+  case Setting::SWEEP_START_FREQ:
+    snprintf(description, 1024, "%s", "sweep: start frequency in Hz");
+    snprintf(value, 1024, "%lld", (long long)sweep_start_freq.load());
+    return 0;
+  case Setting::SWEEP_STOP_FREQ:
+    snprintf(description, 1024, "%s", "sweep: stop frequency in Hz");
+    snprintf(value, 1024, "%lld", (long long)sweep_stop_freq.load());
+    return 0;
+  case Setting::SWEEP_OVERLAP:
+    snprintf(description, 1024, "%s", "sweep: overlap of hops in percent of samplerate, trimmed at the edges: 0 .. 50");
+    snprintf(value, 1024, "%d", sweep_overlap.load());
+    return 0;
+  case Setting::SWEEP_DWELL:
+    snprintf(description, 1024, "%s", "sweep: dwell time per hop in ms");
+    snprintf(value, 1024, "%d", sweep_dwell_ms.load());
+    return 0;
+  case Setting::SWEEP_SETTLE:
+    snprintf(description, 1024, "%s", "sweep: discarded settling time after each retune in ms");
+    snprintf(value, 1024, "%d", sweep_settle_ms.load());
+    return 0;
+  case Setting::SWEEP_FILE:
+    snprintf(description, 1024, "%s", "sweep: log filename");
+    snprintf(value, 1024, "%s", sweep_file);
+    return 0;
+  case Setting::SWEEP_STATS:
+    snprintf(description, 1024, "%s", "sweep: sweeps/s and retune overhead (read only)");
+    sweep_format_stats(value, 1024);
+    return 0;
+  case Setting::CHANNELIZER:
+    snprintf(description, 1024, "%s", "channelizer: 0: off, 1: polyphase filter bank, 2: selected channels");
+    snprintf(value, 1024, "%d", channelizer_mode.load());
+    return 0;
+  case Setting::CHANNELIZER_CHANNELS:
+    snprintf(description, 1024, "%s", "channelizer: number of filter bank channels, power of 2: 16 .. 1024");
+    snprintf(value, 1024, "%d", channelizer_channels.load());
+    return 0;
+  case Setting::CHANNELIZER_DECIMATION:
+    snprintf(description, 1024, "%s", "channelizer: decimation of selected channels: 2 .. 256");
+    snprintf(value, 1024, "%d", channelizer_decimation.load());
+    return 0;
+  case Setting::CHANNELIZER_FREQS:
+    snprintf(description, 1024, "%s", "channelizer: selected channels' offsets from LO in Hz, comma separated");
+    snprintf(value, 1024, "%s", channelizer_freqs);
+    return 0;
+  case Setting::CHANNELIZER_LEVELS:
+    snprintf(description, 1024, "%s", "channelizer: power per channel (read only)");
+    channelizer_format_levels(value, 1024);
+    return 0;
+  case Setting::CHANNELIZER_STATS:
+    snprintf(description, 1024, "%s", "channelizer: CPU load and channels x rate per core (read only)");
+    channelizer_format_stats(value, 1024);
+    return 0;
+  case Setting::ZOOM_DECIMATION:
+    snprintf(description, 1024, "%s", "zoom: decimation of the host's stream around the zoom center - 1: off, 2 .. 64: power of 2");
+    snprintf(value, 1024, "%d", zoom_decimation.load());
+    return 0;
+  case Setting::ZOOM_FOLLOW_TUNE:
+    snprintf(description, 1024, "%s", "zoom: 0: zoom center is the host's LO, 1: zoom center follows the tune frequency");
+    snprintf(value, 1024, "%d", zoom_follow_tune.load());
+    return 0;
+  case Setting::ZOOM_STATS:
+    snprintf(description, 1024, "%s", "zoom: output rate, NCO offset and CPU load (read only)");
+    zoom_format_stats(value, 1024);
+    return 0;
+  case Setting::DC_AVOID:
+    snprintf(description, 1024, "%s", "DC avoidance: 0: off, 1: offset the tuner's LO and shift back - keeps the DC spur away from the tune frequency");
+    snprintf(value, 1024, "%d", dc_avoid_enabled.load());
+    return 0;
+  case Setting::DC_AVOID_OFFSET:
+    snprintf(description, 1024, "%s", "DC avoidance: LO offset in Hz - 10000 .. 1000000");
+    snprintf(value, 1024, "%d", dc_avoid_offset.load());
+    return 0;
+  case Setting::DS_HILBERT:
+    snprintf(description, 1024, "%s", "direct sampling: 0: pass I/Q unchanged, 1: complex from the active branch with half-band Hilbert filter at half samplerate");
+    snprintf(value, 1024, "%d", ds_hilbert_enabled.load());
+    return 0;
+  case Setting::DECIMATED_FORMAT:
+    snprintf(description, 1024, "%s", "decimated output: 0: host's format, 1: 16 bit, 2: float - keeping the added resolution, if the host supports format changes");
+    snprintf(value, 1024, "%d", decimated_format.load());
+    return 0;
+  case Setting::OUTPUT_BITS:
+  {
+    snprintf(description, 1024, "%s", "output: sample format and effective bits (read only)");
+    const SampleFormat fmt = SampleFormat(host_format.load());
+    const double reduction = resample_active() ? double(rates::tab[nxt.srate_idx].valueInt) / resample_rate.load() : double(host_decimation());
+    const double bits = (fmt == SAMPLE_U8) ? 8.0 : dsp_effective_bits(reduction);
+    snprintf(value, 1024, "%s, %.1f effective bits", (fmt == SAMPLE_FLT32) ? "float" : (fmt == SAMPLE_PCM16) ? "16 bit" : "8 bit", bits);
+    return 0;
+  }
+  case Setting::RESAMPLE_RATE:
+    snprintf(description, 1024, "%s", "resampler: output rate in Hz - 0: off. ADC rate, decimation and fractional ratio are chosen automatically");
+    snprintf(value, 1024, "%d", resample_rate.load());
+    return 0;
+  case Setting::RESAMPLE_STATS:
+    snprintf(description, 1024, "%s", "resampler: chosen plan, estimated and measured CPU cost (read only)");
+    resample_format_stats(value, 1024);
+    return 0;
+  case Setting::BUFFER_AUTO:
+    snprintf(description, 1024, "%s", "buffer size: 0: manual, 1: auto - smallest size without drops and within the duty cycle target");
+    snprintf(value, 1024, "%d", buffer_auto.load());
+    return 0;
+  case Setting::BUFFER_AUTO_DUTY:
+    snprintf(description, 1024, "%s", "buffer size auto: target duty cycle of the callback in % - 10 .. 90");
+    snprintf(value, 1024, "%d", buffer_auto_duty.load());
+    return 0;
+  case Setting::BUFFER_AUTO_STATS:
+    snprintf(description, 1024, "%s", "buffer size auto: measured duty cycle, jitter, drops and reason of the choice (read only)");
+    buffer_auto_format_stats(value, 1024);
+    return 0;
+  case Setting::USB_BUFFER_SIZE_IDX:
+    snprintf(description, 1024, "%s", "USB transfer size: -1: same as buffer size, else index 0 .. 8 of 1 .. 256 kB - reblocked into the host's buffer size");
+    snprintf(value, 1024, "%d", usbBufferSizeIdx.load());
+    return 0;
+  case Setting::USB_BUF_NUM:
+    snprintf(description, 1024, "%s", "number of USB transfers: 0: librtlsdr's default, else 1 .. 64 - usb_buf_num in .cfg file overrides");
+    snprintf(value, 1024, "%d", usbBufferNum.load());
+    return 0;
+  case Setting::USB_CALIB_USE:
+    snprintf(description, 1024, "%s", "USB transfers: 1: use the device's calibrated number and size - at the calibrated samplerate");
+    snprintf(value, 1024, "%d", usb_calib_use.load());
+    return 0;
+  case Setting::USB_CALIBRATE:
+    snprintf(description, 1024, "%s", "USB transfers: set 1 while streaming: calibrate number x size at the running samplerate - takes about a minute");
+    snprintf(value, 1024, "%d", usb_calib_running() ? 1 : 0);
+    return 0;
+  case Setting::USB_CALIB_STATS:
+    snprintf(description, 1024, "%s", "USB transfers: calibration progress or result (read only)");
+    usb_calib_format_stats(value, 1024);
+    return 0;
+  case Setting::RATE_QUALIFY:
+    snprintf(description, 1024, "%s", "samplerates: set 1 while stopped: qualify the rates from 2.4 Msps up with the test mode counter - unstable rates get hidden");
+    snprintf(value, 1024, "%d", rate_qual_running() ? 1 : 0);
+    return 0;
+  case Setting::RATE_QUAL_STATS:
+    snprintf(description, 1024, "%s", "samplerates: qualification progress or max loss-free rate of the device on this computer (read only)");
+    rate_qual_format_stats(value, 1024);
+    return 0;
+  case Setting::BAND_PLAN_STATS:
+    snprintf(description, 1024, "%s", "band plan: number of bands, load time from the compiled cache against the parse time of the .cfg (read only)");
+    format_band_plan_stats(value, 1024);
+    return 0;
+  case Setting::BAND_SWITCH_STATS:
+    snprintf(description, 1024, "%s", "band plan: latency of the band switches - retuning included - and their number of changed values (read only)");
+    band_switch_format_stats(value, 1024);
+    return 0;
+  case Setting::SRATE_SWITCH_STATS:
+    snprintf(description, 1024, "%s", "band plan: gap in the stream at the band's samplerate switches while streaming (read only)");
+    srate_switch_format_stats(value, 1024);
+    return 0;
+  case Setting::CONTROL_BATCHED:
+    snprintf(description, 1024, "%s", "control: 1 for batched application of the settings - in dependency order, skipping values in effect. 0 for single calls");
+    snprintf(value, 1024, "%d", control_batched.load());
+    return 0;
+  case Setting::CONTROL_STATS:
+    snprintf(description, 1024, "%s", "control: time to configured at device open and at changes - batched against single calls (read only)");
+    control_format_stats(value, 1024);
+    return 0;
+  case Setting::CONTROL_LATENCY_STATS:
+    snprintf(description, 1024, "%s", "control: passes commanding everything and latency per rtlsdr_set_*() call - count p50/p99/max us (read only)");
+    control_latency_format_stats(value, 1024);
+    return 0;
+  case Setting::CONTROL_LATENCY_FILE:
+    snprintf(description, 1024, "%s", "control: set 1 to write the latency histograms to 'rtl_sdr_extio_control_latency.txt' in the profile directory. 2 resets them");
+    snprintf(value, 1024, "%d", 0);
+    return 0;
+
   default:
     return -1;  // ERROR
   }
@@ -1104,7 +1622,14 @@ void  LIBRTL_API EXTIO_CALL ExtIoSetSetting(int idx, const char* value)
   case Setting::DIRECT_SAMPLING_MODE:
     tempInt = atoi(value);
     if (tempInt < 0)  tempInt = 0;  else if (tempInt > 2) tempInt = 2;
-    nxt.sampling_mode = tempInt;
+    if (tempInt != nxt.sampling_mode.load())
+    {
+      const int64_t host_LO = GetHWLO64();
+      const bool ds_hilbert_was_active = ds_hilbert_active();
+      nxt.sampling_mode = tempInt;
+      if (ds_hilbert_active() != ds_hilbert_was_active)
+        ds_hilbert_switched(host_LO);
+    }
     break;
 
   case Setting::TUNER_IF_AGC:             // int nxt.tuner_if_agc = 1
@@ -1262,6 +1787,314 @@ void  LIBRTL_API EXTIO_CALL ExtIoSetSetting(int idx, const char* value)
   case Setting::RTL_AAGC_KRF4:
     nxt.rtl_aagc_krf[3] = atoi(value);
     break;
+
+  case Setting::TCP_SERVER_PORT:
+    tempInt = atoi(value);
+    tcp_server_port = (tempInt > 0 && tempInt < 65536) ? tempInt : 0;
+    break;
+  case Setting::TCP_SERVER_BIND_ANY:
+    tcp_server_bind_any = atoi(value) ? 1 : 0;
+    break;
+  case Setting::TCP_SERVER_MAX_CLIENTS:
+    tempInt = atoi(value);
+    if (tempInt >= 1 && tempInt <= 16)
+      tcp_server_max_clients = tempInt;
+    break;
+  case Setting::TCP_SERVER_SLOW_CLIENT:
+    tcp_server_slow_client = atoi(value) ? 1 : 0;
+    break;
+  case Setting::TCP_SERVER_ALLOW_CONTROL:
+    tcp_server_allow_control = atoi(value) ? 1 : 0;
+    break;
+
+  case Setting::RTL_TCP_CLIENT_HOST:
+    snprintf(rtl_tcp_client_host, 255, "%s", value); rtl_tcp_client_host[255] = 0;
+    break;
+  case Setting::RTL_TCP_CLIENT_PORT:
+    tempInt = atoi(value);
+    if (tempInt > 0 && tempInt < 65536)
+      rtl_tcp_client_port = tempInt;
+    break;
+  case Setting::RTL_TCP_CLIENT_JITTER_MIN:
+    tempInt = atoi(value);
+    if (tempInt >= 10 && tempInt <= 5000)
+      rtl_tcp_client_jitter_min_ms = tempInt;
+    break;
+  case Setting::RTL_TCP_CLIENT_JITTER_MAX:
+    tempInt = atoi(value);
+    if (tempInt >= 10 && tempInt <= 5000)
+      rtl_tcp_client_jitter_max_ms = tempInt;
+    break;
+  case Setting::RTL_TCP_CLIENT_STATS:
+    break;  // read only
+
+  case Setting::RTL_TCP_CLIENT_COMPRESSION:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 2)
+      rtl_tcp_client_compression = tempInt;
+    break;
+  case Setting::RTL_TCP_CLIENT_LOSSY_BITS:
+    tempInt = atoi(value);
+    if (tempInt >= 1 && tempInt <= 7)
+      rtl_tcp_client_lossy_bits = tempInt;
+    break;
+  case Setting::TCP_SERVER_CODEC_STATS:
+    break;  // read only
+
+  case Setting::UDP_OUT_HOST:
+    snprintf(udp_out_host, 255, "%s", value); udp_out_host[255] = 0;
+    break;
+  case Setting::UDP_OUT_PORT:
+    tempInt = atoi(value);
+    if (tempInt > 0 && tempInt < 65536)
+      udp_out_port = tempInt;
+    break;
+  case Setting::UDP_OUT_TTL:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 255)
+      udp_out_ttl = tempInt;
+    break;
+  case Setting::UDP_OUT_PAYLOAD:
+    tempInt = atoi(value);
+    if (tempInt >= 256 && tempInt <= 65000)
+      udp_out_payload = tempInt & ~1;
+    break;
+  case Setting::UDP_OUT_STATS:
+    break;  // read only
+
+  case Setting::SHM_EXPORT_NAME:
+    snprintf(shm_export_name, 63, "%s", value); shm_export_name[63] = 0;
+    break;
+
+  case Setting::SAMPLE_TAPS_THREADS:
+    tempInt = atoi(value);
+    if (tempInt >= 1 && tempInt <= 8)
+      sample_taps_threads = tempInt;
+    break;
+  case Setting::SAMPLE_TAPS_STATS:
+    break;  // read only
+  case Setting::POWER_METER:
+    power_meter_enabled = atoi(value) ? 1 : 0;
+    break;
+  case Setting::POWER_METER_DBFS:
+    break;  // read only
+  case Setting::SPECTRUM:
+    spectrum_enabled = atoi(value) ? 1 : 0;
+    break;
+  case Setting::SPECTRUM_FFT_SIZE:
+    tempInt = atoi(value);
+    if (tempInt >= 16 && tempInt <= 65536 && !(tempInt & (tempInt - 1)))
+      spectrum_fft_size = tempInt;
+    break;
+  case Setting::SPECTRUM_WINDOW:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 2)
+      spectrum_window = tempInt;
+    break;
+  case Setting::SPECTRUM_OVERLAP:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 90)
+      spectrum_overlap = tempInt;
+    break;
+  case Setting::SPECTRUM_AVERAGES:
+    tempInt = atoi(value);
+    if (tempInt >= 1)
+      spectrum_averages = tempInt;
+    break;
+  case Setting::SPECTRUM_FORMAT:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 2)
+      spectrum_format = tempInt;
+    break;
+  case Setting::SPECTRUM_FILE:
+    snprintf(spectrum_file, 255, "%s", value); spectrum_file[255] = 0;
+    break;
+  case Setting::SPECTRUM_STATS:
+    break;  // read only
+  case Setting::SWEEP:
+    sweep_enabled = atoi(value) ? 1 : 0;
+    break;
+  case Setting::SWEEP_START_FREQ:
+    sweep_start_freq = atoll(value);
+    break;
+  case Setting::SWEEP_STOP_FREQ:
+    sweep_stop_freq = atoll(value);
+    break;
+  case Setting::SWEEP_OVERLAP:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 50)
+      sweep_overlap = tempInt;
+    break;
+  case Setting::SWEEP_DWELL:
+    tempInt = atoi(value);
+    if (tempInt >= 1)
+      sweep_dwell_ms = tempInt;
+    break;
+  case Setting::SWEEP_SETTLE:
+    tempInt = atoi(value);
+    if (tempInt >= 0)
+      sweep_settle_ms = tempInt;
+    break;
+  case Setting::SWEEP_FILE:
+    snprintf(sweep_file, 255, "%s", value); sweep_file[255] = 0;
+    break;
+  case Setting::SWEEP_STATS:
+    break;  // read only
+  case Setting::CHANNELIZER:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 2)
+      channelizer_mode = tempInt;
+    break;
+  case Setting::CHANNELIZER_CHANNELS:
+    tempInt = atoi(value);
+    if (tempInt >= 16 && tempInt <= 1024 && !(tempInt & (tempInt - 1)))
+      channelizer_channels = tempInt;
+    break;
+  case Setting::CHANNELIZER_DECIMATION:
+    tempInt = atoi(value);
+    if (tempInt >= 2 && tempInt <= 256)
+      channelizer_decimation = tempInt;
+    break;
+  case Setting::CHANNELIZER_FREQS:
+    snprintf(channelizer_freqs, 1023, "%s", value); channelizer_freqs[1023] = 0;
+    break;
+  case Setting::CHANNELIZER_LEVELS:
+  case Setting::CHANNELIZER_STATS:
+    break;  // read only
+  case Setting::ZOOM_DECIMATION:
+    tempInt = atoi(value);
+    if (tempInt >= 1 && tempInt <= 64 && !(tempInt & (tempInt - 1)) && tempInt != zoom_decimation.load())
+    {
+      const int64_t host_LO = GetHWLO64();
+      zoom_decimation = tempInt;
+      // keep the host's LO as zoom center
+      zoom_set_LO(host_LO, host_LO_from_hw(nxt.LO_freq.load()), rates::tab[nxt.srate_idx].valueInt);
+      update_host_sample_format();
+      if (gpfnExtIOCallbackPtr)
+      {
+        EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+        EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
+      }
+    }
+    break;
+  case Setting::ZOOM_FOLLOW_TUNE:
+    zoom_follow_tune = atoi(value) ? 1 : 0;
+    break;
+  case Setting::ZOOM_STATS:
+    break;  // read only
+  case Setting::DC_AVOID:
+    dc_avoid_configure(atoi(value) ? 1 : 0, dc_avoid_offset.load());
+    break;
+  case Setting::DC_AVOID_OFFSET:
+    tempInt = atoi(value);
+    if (tempInt >= 10000 && tempInt <= 1000000)
+      dc_avoid_configure(dc_avoid_enabled.load(), tempInt);
+    break;
+  case Setting::DS_HILBERT:
+    tempInt = atoi(value) ? 1 : 0;
+    if (tempInt != ds_hilbert_enabled.load())
+    {
+      const int64_t host_LO = GetHWLO64();
+      const bool ds_hilbert_was_active = ds_hilbert_active();
+      ds_hilbert_enabled = tempInt;
+      if (ds_hilbert_active() != ds_hilbert_was_active)
+        ds_hilbert_switched(host_LO);
+    }
+    break;
+  case Setting::DECIMATED_FORMAT:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 2)
+    {
+      decimated_format = tempInt;
+      update_host_sample_format();
+    }
+    break;
+  case Setting::OUTPUT_BITS:
+    break;  // read only
+  case Setting::RESAMPLE_RATE:
+    tempInt = atoi(value);
+    if (tempInt != resample_rate.load())
+    {
+      ResamplePlan plan;
+      if (tempInt == 0)
+        resample_rate = 0;
+      else if (tempInt > 0 && resample_find_plan(tempInt, plan))
+      {
+        resample_rate = tempInt;
+        nxt.srate_idx = plan.srate_idx;
+        gui_SetSrate(plan.srate_idx);
+        trigger_control(CtrlFlags::srate);
+      }
+      else
+      {
+        SDRLOG(extHw_MSG_ERROR, "resampler: no ADC rate for the output rate");
+        break;
+      }
+      update_host_sample_format();
+      if (gpfnExtIOCallbackPtr)
+        EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+    }
+    break;
+  case Setting::RESAMPLE_STATS:
+    break;  // read only
+  case Setting::BUFFER_AUTO:
+    buffer_auto = atoi(value) ? 1 : 0;
+    break;
+  case Setting::BUFFER_AUTO_DUTY:
+    tempInt = atoi(value);
+    if (tempInt >= 10 && tempInt <= 90)
+      buffer_auto_duty = tempInt;
+    break;
+  case Setting::BUFFER_AUTO_STATS:
+    break;  // read only
+  case Setting::USB_BUFFER_SIZE_IDX:
+    tempInt = atoi(value);
+    if (tempInt >= -1 && tempInt < int(sizeof(buffer_sizes) / sizeof(buffer_sizes[0])))
+      usbBufferSizeIdx = tempInt;
+    break;
+  case Setting::USB_BUF_NUM:
+    tempInt = atoi(value);
+    if (tempInt >= 0 && tempInt <= 64)
+      usbBufferNum = tempInt;
+    break;
+  case Setting::USB_CALIB_USE:
+    usb_calib_use = atoi(value) ? 1 : 0;
+    break;
+  case Setting::USB_CALIBRATE:
+    // USB devices only: rtl_tcp has no transfers to tune
+    if (atoi(value) && ThreadStreamToSDR && RtlSdrDev)
+      usb_calib_start(RtlOpenDevice.serial, rates::tab[last.srate_idx].valueInt, usb_buffer_num.load(), usb_buffer_len.load());
+    break;
+  case Setting::USB_CALIB_STATS:
+    break;  // read only
+  case Setting::RATE_QUALIFY:
+    // USB devices only: rtl_tcp has no test mode
+    if (atoi(value) && !ThreadStreamToSDR && RtlSdrDev)
+      rate_qual_start(RtlSdrDev, RtlOpenDevice.serial, usbBufferNum.load(),
+        (usbBufferSizeIdx.load() < 0) ? buffer_len.load() : buffer_sizes[usbBufferSizeIdx.load()] * 1024);
+    break;
+  case Setting::RATE_QUAL_STATS:
+    break;  // read only
+  case Setting::BAND_PLAN_STATS:
+    break;  // read only
+  case Setting::BAND_SWITCH_STATS:
+    break;  // read only
+  case Setting::SRATE_SWITCH_STATS:
+    break;  // read only
+  case Setting::CONTROL_BATCHED:
+    control_batched = atoi(value) ? 1 : 0;
+    break;
+  case Setting::CONTROL_STATS:
+    break;  // read only
+  case Setting::CONTROL_LATENCY_STATS:
+    break;  // read only
+  case Setting::CONTROL_LATENCY_FILE:
+    tempInt = atoi(value);
+    if (tempInt == 1 && !control_latency_write_file())
+      SDRLOG(extHw_MSG_ERROR, "Error writing the control latency file");
+    else if (tempInt == 2)
+      control_latency_reset();
+    break;
   }
 }
 
@@ -1269,9 +2102,20 @@ void  LIBRTL_API EXTIO_CALL ExtIoSetSetting(int idx, const char* value)
 extern "C"
 void LIBRTL_API EXTIO_CALL StopHW()
 {
+  std::lock_guard<std::recursive_mutex> lock(hw_mtx);
   SDRLOG(extHw_MSG_DEBUG, "StopHW()");
   ThreadStreamToSDR = false;
+  Stop_Supervise_Thread();
+  usb_calib_abort();
+  sweep_stop();
   Stop_RX_Thread();
+  tcp_server_stop();
+  udp_sender_stop();
+  shm_export_stop();
+  power_meter_stop();
+  channelizer_stop();
+  spectrum_stop();
+  device_profile_flush();   // ppm changes while streaming
   EnableGUIControlsAtStop();
   Start_ConnCheck_Thread();
 }
@@ -1279,9 +2123,20 @@ void LIBRTL_API EXTIO_CALL StopHW()
 extern "C"
 void LIBRTL_API EXTIO_CALL CloseHW()
 {
+  std::lock_guard<std::recursive_mutex> lock(hw_mtx);
   SDRLOG(extHw_MSG_DEBUG, "CloseHW()");
   ThreadStreamToSDR = false;
+  Stop_Supervise_Thread();
+  usb_calib_abort();
+  sweep_stop();
   Stop_RX_Thread();
+  tcp_server_stop();
+  udp_sender_stop();
+  shm_export_stop();
+  power_meter_stop();
+  channelizer_stop();
+  spectrum_stop();
+  rate_qual_stop();
   close_rtl_device();
   DestroyGUI();
 }
@@ -1368,11 +2223,17 @@ int Start_RX_Thread()
         return -1;
       }
     }
+    reblockBuf = new (std::nothrow) uint8_t[MAX_BUFFER_LEN + 1024];
+    if (reblockBuf == 0)
+    {
+      MessageBox(NULL, TEXT("Couldn't Allocate Sample Buffers!"), TEXT("Error!"), MB_OK | MB_ICONERROR);
+      return -1;
+    }
     rcvBufsAllocated = true;
   }
 
   // Reset endpoint
-  if (rtlsdr_reset_buffer(RtlSdrDev) < 0)
+  if (RtlSdrDev && rtlsdr_reset_buffer(RtlSdrDev) < 0)
   {
     SDRLOG(extHw_MSG_ERROR, "Start_RX_Thread(): Error at rtlsdr_reset_buffer()");
     return -1;
@@ -1392,14 +2253,57 @@ int Start_RX_Thread()
   return 0;
 }
 
-static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
+// host's callback - timed for the adaptive buffer size
+static uint64_t host_callback_ns = 0;   // only accessed from the RX thread
+
+static void host_callback(int n_samples, void* data)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  gpfnExtIOCallbackPtr(n_samples, 0, 0, data);
+  host_callback_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+}
+
+static void process_block(unsigned char* buf, uint32_t len, CallbackContext& c)
 {
-  if (!buf || !ctx || !gpfnExtIOCallbackPtr || terminate_RX_Thread.load() || len != buffer_len.load())
-    return;
-  CallbackContext& c = *((CallbackContext*)ctx);
 
   const int n_samples_per_block = len / 2;
 
+  // share the raw stream with rtl_tcp clients, UDP receivers and local processes
+  tcp_server_feed(buf, len);
+  udp_sender_feed(buf, len);
+  shm_export_feed(buf, len);
+  // in-process taps run on their own thread pool
+  sample_taps_feed(buf, len);
+  spectrum_feed(buf, len);
+  sweep_feed(buf, len);
+
+  if (ds_hilbert_active())
+  {
+    // direct sampling: complex from the real branch - a host block every 2nd call
+    const void* converted = ds_hilbert_feed(buf, len, SampleFormat(host_format.load()));
+    if (converted)
+      host_callback(n_samples_per_block, (void*)converted);
+    return;
+  }
+
+  if (resample_active())
+  {
+    // arbitrary output rate: host blocks at the output rate
+    const void* resampled = resample_feed(buf, len, SampleFormat(host_format.load()));
+    if (resampled)
+      host_callback(n_samples_per_block, (void*)resampled);
+    return;
+  }
+
+  if (zoom_active())
+  {
+    // decimated: a complete host block only every zoom_decimation calls
+    const void* zoomed = zoom_feed(buf, len, SampleFormat(host_format.load()));
+    if (zoomed)
+      host_callback(n_samples_per_block, (void*)zoomed);
+    return;
+  }
+
   if (extHWtype == exthwUSBdata16)
   {
     int16_t* short_ptr = pcm16_buf[c.receiveBufferIdx];
@@ -1407,15 +2311,20 @@ static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
     ++c.receiveBufferIdx;
     if (c.receiveBufferIdx >= NUM_BUFFERS_BEFORE_CALLBACK + 1)
       c.receiveBufferIdx = 0;
-    for (uint32_t i = 0; i < len; i++)
-      short_ptr[i] = int16_t(char_ptr[i]) - int16_t(128);
+    if (dc_avoid_active())
+      dc_avoid_convert(buf, len, short_ptr, true);
+    else
+    {
+      for (uint32_t i = 0; i < len; i++)
+        short_ptr[i] = int16_t(char_ptr[i]) - int16_t(128);
+    }
     if (c.printCallbackLen)
     {
       c.printCallbackLen = false;
       snprintf(c.acMsg, 255, "Callback() with %d raw 16 bit I/Q pairs", n_samples_per_block);
       SDRLOG(extHw_MSG_DEBUG, c.acMsg);
     }
-    gpfnExtIOCallbackPtr(n_samples_per_block, 0, 0, short_ptr);
+    host_callback(n_samples_per_block, short_ptr);
   }
   else // if (extHWtype == exthwUSBdataU8)
   {
@@ -1424,22 +2333,85 @@ static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
     ++c.receiveBufferIdx;
     if (c.receiveBufferIdx >= NUM_BUFFERS_BEFORE_CALLBACK + 1)
       c.receiveBufferIdx = 0;
-    memcpy(pcm8_buf, buf, len);
+    if (dc_avoid_active())
+      dc_avoid_convert(buf, len, pcm8_buf, false);
+    else
+      memcpy(pcm8_buf, buf, len);
     if (c.printCallbackLen)
     {
       c.printCallbackLen = false;
       snprintf(c.acMsg, 255, "Callback() with %d raw 8 Bit I/Q pairs", n_samples_per_block);
       SDRLOG(extHw_MSG_DEBUG, c.acMsg);
     }
-    gpfnExtIOCallbackPtr(n_samples_per_block, 0, 0, pcm8_buf);
+    host_callback(n_samples_per_block, pcm8_buf);
+  }
+}
+
+static uint64_t now_ns()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// one host block - timed for the adaptive buffer size, which sets the host block size
+static void process_host_block(unsigned char* buf, uint32_t len, CallbackContext& c)
+{
+  const uint64_t t0 = now_ns();
+  host_callback_ns = 0;
+  process_block(buf, len, c);
+  buffer_auto_block(len, t0, host_callback_ns, now_ns());
+}
+
+static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
+{
+  if (!buf || !ctx || !gpfnExtIOCallbackPtr || terminate_RX_Thread.load() || !len || !host_block_len)
+    return;
+  CallbackContext& c = *((CallbackContext*)ctx);
+  const uint64_t t_begin = now_ns();
+
+  // samplerate switch: transfers with samples of the old rate - and the partial block - are dropped
+  if (srate_switch_drop(len, t_begin))
+  {
+    reblock_fill = 0;
+    return;
+  }
+
+  // reblock USB transfers of any length - also short or odd ones - into the host's blocks
+  const uint32_t usb_len = len;
+  const uint32_t B = host_block_len;
+  while (len)
+  {
+    if (!reblock_fill && len >= B)
+    {
+      // complete block: without copy
+      process_host_block(buf, B, c);
+      buf += B;
+      len -= B;
+      continue;
+    }
+    const uint32_t n = (len < B - reblock_fill) ? len : (B - reblock_fill);
+    memcpy(reblockBuf + reblock_fill, buf, n);
+    reblock_fill += n;
+    buf += n;
+    len -= n;
+    if (reblock_fill == B)
+    {
+      process_host_block(reblockBuf, B, c);
+      reblock_fill = 0;
+    }
   }
+
+  buffer_auto_transfer(usb_len, now_ns() - t_begin);
+  usb_calib_block(usb_len, t_begin);
 }
 
 int Stop_RX_Thread()
 {
   terminate_RX_Thread = true;
   SDRLOG(extHw_MSG_DEBUG, "Stopping ASYNC receive thread with rtlsdr_cancel_async() ..");
-  rtlsdr_cancel_async(RtlSdrDev);
+  if (RtlSdrDev)
+    rtlsdr_cancel_async(RtlSdrDev);
+  else
+    rtl_tcp_client_cancel_async();
   if (RX_thread_handle == INVALID_HANDLE_VALUE)
     return 0;
   WaitForSingleObject(RX_thread_handle, INFINITE);
@@ -1454,13 +2426,21 @@ void RX_ThreadProc(void* p)
   char acMsg[256];
   SDRLG(extHw_MSG_DEBUG, "RX_ThreadProc() with device handle 0x%p", RtlSdrDev);
   // Blocks until rtlsdr_cancel_async() is called
-  int r = rtlsdr_read_async(
-    RtlSdrDev,
-    (rtlsdr_read_async_cb_t)&RtlSdrCallback,
-    &cb_ctx,
-    0,
-    buffer_len.load()
-  );
+  int r;
+  if (RtlSdrDev)
+    r = rtlsdr_read_async(
+      RtlSdrDev,
+      (rtlsdr_read_async_cb_t)&RtlSdrCallback,
+      &cb_ctx,
+      usb_buffer_num.load(),
+      usb_buffer_len.load()
+    );
+  else
+    r = rtl_tcp_client_read_async(
+      (rtlsdr_read_async_cb_t)&RtlSdrCallback,
+      &cb_ctx,
+      usb_buffer_len.load()
+    );
 
   RX_thread_handle = INVALID_HANDLE_VALUE;
 
@@ -1521,7 +2501,7 @@ void ConnCheck_ThreadProc(void* param)
   SDRLG(extHw_MSG_DEBUG, "ConnCheck_ThreadProc() with device handle 0x%p", RtlSdrDev);
   int counter = 0;
 
-  while (RtlSdrDev && !terminate_ConnCheck_Thread.load())
+  while (is_device_open() && !terminate_ConnCheck_Thread.load())
   {
     Sleep(100);
     if (terminate_ConnCheck_Thread.load())
@@ -1530,6 +2510,8 @@ void ConnCheck_ThreadProc(void* param)
       continue;
 
     counter = 0;
+    if (rate_qual_running())
+      continue;   // the qualification streams from the device
     if (!is_device_handle_valid())
     {
       SDRLOG(extHw_MSG_ERROR, "ConnCheck_ThreadProc(): device handle got invalid!");
@@ -1542,3 +2524,86 @@ void ConnCheck_ThreadProc(void* param)
   _endthread();
 }
 
+
+int Start_Supervise_Thread()
+{
+  //If already running, exit
+  if (Supervise_thread_handle != INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Supervise_Thread(): Error thread still running!");
+    return 0;   // all fine
+  }
+
+  terminate_Supervise_Thread = false;
+
+  SDRLOG(extHw_MSG_DEBUG, "Starting stream supervision thread ..");
+  Supervise_thread_handle = (HANDLE)_beginthread(Supervise_ThreadProc, 0, NULL);
+  if (Supervise_thread_handle == INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Supervise_Thread(): Error at _beginthread()");
+    return -1;  // ERROR
+  }
+
+  return 0;
+}
+
+
+int Stop_Supervise_Thread()
+{
+  terminate_Supervise_Thread = true;
+  SDRLOG(extHw_MSG_DEBUG, "Stopping stream supervision thread  ..");
+  if (Supervise_thread_handle == INVALID_HANDLE_VALUE)
+    return 0;
+  WaitForSingleObject(Supervise_thread_handle, INFINITE);
+  SDRLOG(extHw_MSG_DEBUG, "Stop_Supervise_Thread(): thread() stopped successfully");
+  Supervise_thread_handle = INVALID_HANDLE_VALUE;
+  return 0;
+}
+
+// runs while streaming - ConnCheck_ThreadProc() does not
+void Supervise_ThreadProc(void* param)
+{
+  char acMsg[256];
+  int counter = 0;
+
+  while (ThreadStreamToSDR && !terminate_Supervise_Thread.load())
+  {
+    Sleep(100);
+    if (terminate_Supervise_Thread.load())
+      break;
+    if (++counter < 5)
+      continue;
+
+    // the host's entry points hold hw_mtx - StopHW() also while waiting for this thread:
+    //   don't block, retry with the next period
+    std::unique_lock<std::recursive_mutex> lock(hw_mtx, std::try_to_lock);
+    if (!lock.owns_lock())
+      continue;
+    counter = 0;
+    const int srate = rates::tab[last.srate_idx].valueInt;
+    int buf_num, buf_len;
+    if (usb_calib_step(srate, buf_num, buf_len))
+    {
+      // USB transfers only: the host's block size is kept - no restart of the host
+      SDRLG(extHw_MSG_DEBUG, "Supervise_ThreadProc(): restarting stream with %d USB transfers of %d bytes", buf_num, buf_len);
+      Stop_RX_Thread();
+      usb_buffer_num = buf_num;
+      usb_buffer_len = buf_len;
+      reblock_fill = 0;
+      if (Start_RX_Thread() < 0)
+        SDRLOG(extHw_MSG_ERROR, "Supervise_ThreadProc(): Error to restart streaming thread");
+    }
+    else if (!usb_calib_running() && buffer_auto_evaluate(srate, usb_buffer_num.load() ? usb_buffer_num.load() : USB_DEFAULT_BUF_NUM))
+    {
+      // the new buffer size is used with the host's restart
+      lock.unlock();
+      SDRLOG(extHw_MSG_DEBUG, "Supervise_ThreadProc(): adaptive buffer size changed");
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+    }
+  }
+
+  Supervise_thread_handle = INVALID_HANDLE_VALUE;
+  SDRLOG(extHw_MSG_DEBUG, "Supervise_ThreadProc() finished. Finishing thread.");
+  _endthread();
+}
+
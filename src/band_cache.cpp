@@ -0,0 +1,302 @@
+
+#include "band_cache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <filesystem>
+#include <system_error>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+static_assert(sizeof(BandCacheHeader) == 64, "cache header layout");
+static_assert(sizeof(BandCacheRecord) == 80, "cache record layout");
+
+static const char* cache_ext = ".cache";
+
+
+// read only mapping of the whole file
+class BandCacheMapping
+{
+public:
+  ~BandCacheMapping() { close(); }
+
+  const uint8_t* open(const char* path)
+  {
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+      return nullptr;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(file, &sz) || !sz.QuadPart)
+      return nullptr;
+    size = uint64_t(sz.QuadPart);
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+      return nullptr;
+    view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+      return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !st.st_size)
+      return nullptr;
+    size = uint64_t(st.st_size);
+    void* p = mmap(nullptr, size_t(size), PROT_READ, MAP_SHARED, fd, 0);
+    view = (p == MAP_FAILED) ? nullptr : (const uint8_t*)p;
+#endif
+    return view;
+  }
+
+  void close()
+  {
+#ifdef _WIN32
+    if (view)
+      UnmapViewOfFile(view);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (view)
+      munmap((void*)view, size_t(size));
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+#endif
+    view = nullptr;
+  }
+
+  uint64_t size = 0;
+
+private:
+  const uint8_t* view = nullptr;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#else
+  int fd = -1;
+#endif
+};
+
+
+// size, modification time and FNV-1a 64 of the .cfg file
+static bool cfg_identity(const char* cfg_fn, uint64_t& size, int64_t& mtime, uint64_t& fnv)
+{
+  std::error_code ec;
+  const std::filesystem::path path(cfg_fn);
+  size = uint64_t(std::filesystem::file_size(path, ec));
+  if (ec)
+    return false;
+  mtime = int64_t(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+  if (ec)
+    return false;
+
+  FILE* f = fopen(cfg_fn, "rb");
+  if (!f)
+    return false;
+  uint64_t h = 14695981039346656037ULL;
+  uint8_t buf[16384];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+  {
+    for (size_t k = 0; k < n; ++k)
+      h = (h ^ buf[k]) * 1099511628211ULL;
+  }
+  fclose(f);
+  fnv = h;
+  return true;
+}
+
+
+bool band_cache_load(const char* cfg_fn, std::vector<BandAction>& bands, BandCacheInfo& info)
+{
+  uint64_t size, fnv;
+  int64_t mtime;
+  if (!cfg_identity(cfg_fn, size, mtime, fnv))
+    return false;
+
+  BandCacheMapping m;
+  const uint8_t* p = m.open((std::string(cfg_fn) + cache_ext).c_str());
+  if (!p || m.size < sizeof(BandCacheHeader))
+    return false;
+  const BandCacheHeader* h = (const BandCacheHeader*)p;
+  if (memcmp(h->magic, "RTLBANDC", 8) || h->version != 1
+    || h->cfg_size != size || h->cfg_mtime != mtime || h->cfg_fnv != fnv
+    || m.size != sizeof(BandCacheHeader) + uint64_t(h->num_records) * sizeof(BandCacheRecord) + h->strings_size
+    || (h->strings_size && p[m.size - 1] != 0))
+    return false;
+
+  const BandCacheRecord* r = (const BandCacheRecord*)(p + sizeof(BandCacheHeader));
+  const char* strings = (const char*)(r + h->num_records);
+  bands.clear();
+  bands.reserve(h->num_records);
+  for (uint32_t k = 0; k < h->num_records; ++k, ++r)
+  {
+    if (r->id_offset >= h->strings_size || ((r->has & BandCacheRecord::NAME) && r->name_offset >= h->strings_size))
+      return false;
+    BandAction ba;
+    ba.id = strings + r->id_offset;
+    ba.freq_from = r->freq_from;
+    ba.freq_to = r->freq_to;
+    if (r->has & BandCacheRecord::NAME)
+      ba.name = std::string(strings + r->name_offset);
+    if (r->has & BandCacheRecord::SAMPLING_MODE)
+      ba.sampling_mode = r->sampling_mode;
+    if (r->has & BandCacheRecord::SAMPLERATE)
+      ba.samplerate = r->samplerate;
+    if (r->has & BandCacheRecord::TUNER_BANDWIDTH)
+      ba.tuner_bandwidth = r->tuner_bandwidth;
+    if (r->has & BandCacheRecord::BAND_CENTER)
+      ba.r820t_tuner_band_center = r->r820t_tuner_band_center;
+    if (r->has & BandCacheRecord::TUNING_SIDEBAND)
+      ba.tuning_sideband = r->tuning_sideband;
+    if (r->has & BandCacheRecord::RF_AGC)
+      ba.tuner_rf_agc = (r->bools & BandCacheRecord::RF_AGC) != 0;
+    if (r->has & BandCacheRecord::RF_GAIN)
+      ba.tuner_rf_gain_db = r->tuner_rf_gain_db;
+    if (r->has & BandCacheRecord::IF_AGC)
+      ba.tuner_if_agc = (r->bools & BandCacheRecord::IF_AGC) != 0;
+    if (r->has & BandCacheRecord::IF_GAIN)
+      ba.tuner_if_gain_db = r->tuner_if_gain_db;
+    if (r->has & BandCacheRecord::RTL_AGC)
+      ba.rtl_digital_agc = (r->bools & BandCacheRecord::RTL_AGC) != 0;
+    std::optional<bool>* gpio[5] = { &ba.gpio_button0, &ba.gpio_button1, &ba.gpio_button2, &ba.gpio_button3, &ba.gpio_button4 };
+    for (unsigned b = 0; b < 5; ++b)
+    {
+      if (r->has & (BandCacheRecord::GPIO0 << b))
+        *gpio[b] = (r->bools & (BandCacheRecord::GPIO0 << b)) != 0;
+    }
+    bands.push_back(std::move(ba));
+  }
+
+  info.status = BandAction::Band_Info(h->band_status);
+  if (h->usb_buf_num >= 0)
+    info.usb_buf_num = h->usb_buf_num;
+  else
+    info.usb_buf_num.reset();
+  info.log = (h->flags & 1) != 0;
+  info.parse_ms = h->parse_ms;
+  return true;
+}
+
+
+static uint32_t add_string(std::string& strings, const std::string& s)
+{
+  const uint32_t off = uint32_t(strings.size());
+  strings.append(s);
+  strings.push_back(0);
+  return off;
+}
+
+bool band_cache_store(const char* cfg_fn, const std::vector<BandAction>& bands, const BandCacheInfo& info)
+{
+  BandCacheHeader h;
+  memset(&h, 0, sizeof(h));
+  if (!cfg_identity(cfg_fn, h.cfg_size, h.cfg_mtime, h.cfg_fnv))
+    return false;
+
+  std::vector<BandCacheRecord> records(bands.size());
+  std::string strings;
+  for (size_t k = 0; k < bands.size(); ++k)
+  {
+    const BandAction& ba = bands[k];
+    BandCacheRecord& r = records[k];
+    memset(&r, 0, sizeof(r));
+    r.freq_from = ba.freq_from;
+    r.freq_to = ba.freq_to;
+    r.id_offset = add_string(strings, ba.id);
+    if (ba.name)
+    {
+      r.has |= BandCacheRecord::NAME;
+      r.name_offset = add_string(strings, *ba.name);
+    }
+    if (ba.sampling_mode)
+    {
+      r.has |= BandCacheRecord::SAMPLING_MODE;
+      r.sampling_mode = *ba.sampling_mode;
+    }
+    if (ba.samplerate)
+    {
+      r.has |= BandCacheRecord::SAMPLERATE;
+      r.samplerate = *ba.samplerate;
+    }
+    if (ba.tuner_bandwidth)
+    {
+      r.has |= BandCacheRecord::TUNER_BANDWIDTH;
+      r.tuner_bandwidth = *ba.tuner_bandwidth;
+    }
+    if (ba.r820t_tuner_band_center)
+    {
+      r.has |= BandCacheRecord::BAND_CENTER;
+      r.r820t_tuner_band_center = *ba.r820t_tuner_band_center;
+    }
+    if (ba.tuning_sideband)
+    {
+      r.has |= BandCacheRecord::TUNING_SIDEBAND;
+      r.tuning_sideband = *ba.tuning_sideband;
+    }
+    if (ba.tuner_rf_gain_db)
+    {
+      r.has |= BandCacheRecord::RF_GAIN;
+      r.tuner_rf_gain_db = *ba.tuner_rf_gain_db;
+    }
+    if (ba.tuner_if_gain_db)
+    {
+      r.has |= BandCacheRecord::IF_GAIN;
+      r.tuner_if_gain_db = *ba.tuner_if_gain_db;
+    }
+    const std::optional<bool>* flags[8] = { &ba.tuner_rf_agc, &ba.tuner_if_agc, &ba.rtl_digital_agc,
+      &ba.gpio_button0, &ba.gpio_button1, &ba.gpio_button2, &ba.gpio_button3, &ba.gpio_button4 };
+    const uint32_t bits[8] = { BandCacheRecord::RF_AGC, BandCacheRecord::IF_AGC, BandCacheRecord::RTL_AGC,
+      BandCacheRecord::GPIO0, BandCacheRecord::GPIO0 << 1, BandCacheRecord::GPIO0 << 2,
+      BandCacheRecord::GPIO0 << 3, BandCacheRecord::GPIO0 << 4 };
+    for (unsigned b = 0; b < 8; ++b)
+    {
+      if (*flags[b])
+      {
+        r.has |= bits[b];
+        if (**flags[b])
+          r.bools |= bits[b];
+      }
+    }
+  }
+
+  memcpy(h.magic, "RTLBANDC", 8);
+  h.version = 1;
+  h.num_records = uint32_t(records.size());
+  h.strings_size = uint32_t(strings.size());
+  h.band_status = uint32_t(info.status);
+  h.usb_buf_num = info.usb_buf_num ? *info.usb_buf_num : -1;
+  h.flags = info.log ? 1 : 0;
+  h.parse_ms = info.parse_ms;
+
+  const std::string fn = std::string(cfg_fn) + cache_ext;
+  FILE* f = fopen(fn.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  if (ok && records.size())
+    ok = fwrite(records.data(), sizeof(BandCacheRecord), records.size(), f) == records.size();
+  if (ok && strings.size())
+    ok = fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+  ok = (fclose(f) == 0) && ok;
+  if (!ok)
+    remove(fn.c_str());   // a partial file fails the size check anyway
+  return ok;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "config_file.h"
+
+#include <stdint.h>
+#include <optional>
+#include <vector>
+
+// compiled band plan: the resolved band actions of the .cfg file - in a flat
+//   binary file next to it ('.cfg.cache'), memory mapped for loading.
+//   parsing a big .cfg with toml++ takes much longer than loading the records.
+// the cache is valid for the .cfg file with the same size, modification time
+//   and FNV-1a hash of its content. it is rebuilt after parsing a changed .cfg.
+//
+// file layout, little endian:
+//   header, 64 bytes:
+//     char magic[8] "RTLBANDC", uint32 version (1), uint32 num_records,
+//     uint64 cfg_size, int64 cfg_mtime, uint64 cfg_fnv,
+//     uint32 strings_size, uint32 band_status, int32 usb_buf_num (-1: not set),
+//     uint32 flags (1: log), float64 parse_ms
+//   num_records records of BandCacheRecord, sorted by freq_from
+//   strings_size bytes of 0 terminated strings: ids and names
+
+struct BandCacheHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t num_records;
+  uint64_t cfg_size;
+  int64_t cfg_mtime;
+  uint64_t cfg_fnv;
+  uint32_t strings_size;
+  uint32_t band_status;
+  int32_t usb_buf_num;
+  uint32_t flags;
+  double parse_ms;
+};
+
+struct BandCacheRecord
+{
+  // bits in 'has' for the set optionals - and in 'bools' for their values
+  static constexpr uint32_t NAME = 1 << 0;
+  static constexpr uint32_t SAMPLING_MODE = 1 << 1;
+  static constexpr uint32_t SAMPLERATE = 1 << 2;
+  static constexpr uint32_t TUNER_BANDWIDTH = 1 << 3;
+  static constexpr uint32_t BAND_CENTER = 1 << 4;
+  static constexpr uint32_t TUNING_SIDEBAND = 1 << 5;
+  static constexpr uint32_t RF_AGC = 1 << 6;
+  static constexpr uint32_t RF_GAIN = 1 << 7;
+  static constexpr uint32_t IF_AGC = 1 << 8;
+  static constexpr uint32_t IF_GAIN = 1 << 9;
+  static constexpr uint32_t RTL_AGC = 1 << 10;
+  static constexpr uint32_t GPIO0 = 1 << 11;    // .. GPIO4 = 1 << 15
+
+  double freq_from;
+  double freq_to;
+  double samplerate;
+  double tuner_bandwidth;
+  double r820t_tuner_band_center;
+  double tuner_rf_gain_db;
+  double tuner_if_gain_db;
+  uint32_t id_offset;     // into the strings
+  uint32_t name_offset;
+  uint32_t has;
+  uint32_t bools;
+  char sampling_mode;
+  char tuning_sideband;
+  char pad[6];
+};
+
+struct BandCacheInfo
+{
+  BandAction::Band_Info status = BandAction::info_not_loaded;
+  std::optional<int> usb_buf_num;
+  bool log = false;
+  double parse_ms = 0.0;    // of the parse, which built the cache
+};
+
+// true, when the cache of cfg_fn is valid: then bands and info are filled
+bool band_cache_load(const char* cfg_fn, std::vector<BandAction>& bands, BandCacheInfo& info);
+// writes the cache of cfg_fn. bands have to be sorted by freq_from
+bool band_cache_store(const char* cfg_fn, const std::vector<BandAction>& bands, const BandCacheInfo& info);
@@ -0,0 +1,231 @@
+
+#include "band_switch.h"
+#include "tuners.h"
+#include "rates.h"
+#include "rate_qual.h"
+#include "resampler.h"
+
+#include <stdio.h>
+#include <cmath>
+#include <string.h>
+#include <vector>
+#include <mutex>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+
+// a band, resolved for the tuner. -1: not set by the band
+struct BandSwitchPlan
+{
+  int sampling_mode;
+  int rtl_agc;
+  int tuner_rf_agc;
+  int rf_gain;          // tenth dB - one of the tuner's gains
+  int tuner_if_agc;
+  int if_gain_idx;
+  int if_gain_val;
+  int USB_sideband;
+  int srate_idx;
+  int tuner_bw;         // kHz - one of the tuner's bandwidths. 0: automatic
+  int band_center_sel;  // 0: center, 1: +fs/4, 2: -fs/4
+  int GPIO[ControlVars::NUM_GPIO_BUTTONS];
+};
+
+static std::vector<BandSwitchPlan> plans;
+static const BandAction* plans_of = nullptr;    // band_actions, the plans were compiled from
+static uint32_t plans_tuner = RTLSDR_TUNER_UNKNOWN;
+
+static std::mutex mtx;    // stats
+static uint64_t n_switches = 0, sum_ns = 0, max_ns = 0, last_ns = 0;
+static unsigned last_changes = 0;
+
+
+static int opt_bool(const std::optional<bool>& v)
+{
+  return v ? (*v ? 1 : 0) : -1;
+}
+
+static int nearest_srate_idx(double srate)
+{
+  int idx = 0;
+  for (int k = 1; k < int(rates::N); ++k)
+  {
+    if (std::abs(rates::tab[k].value - srate) < std::abs(rates::tab[idx].value - srate))
+      idx = k;
+  }
+  return idx;
+}
+
+static int nearest_bw(double bw_hz, uint32_t tuner_type)
+{
+  const int n = (tuner_type < tuners::N) ? tuners::bws[tuner_type].num : 0;
+  if (n <= 1)
+    return -1;
+  const int* bws = tuners::bws[tuner_type].bw;
+  const int bw = int(bw_hz / 1000.0 + 0.5);
+  if (bw <= 0)
+    return 0;   // automatic
+  int idx = 1;
+  for (int k = 2; k < n; ++k)
+  {
+    if (std::abs(bw - bws[k]) < std::abs(bw - bws[idx]))
+      idx = k;
+  }
+  return bws[idx];
+}
+
+static BandSwitchPlan compile(const BandAction& ba, uint32_t tuner_type)
+{
+  BandSwitchPlan p;
+  p.sampling_mode = -1;
+  if (ba.sampling_mode)
+  {
+    if (*ba.sampling_mode == 'I')
+      p.sampling_mode = 1;
+    else if (*ba.sampling_mode == 'Q')
+      p.sampling_mode = 2;
+    else if (*ba.sampling_mode == 'C')
+      p.sampling_mode = 0;
+  }
+  p.rtl_agc = opt_bool(ba.rtl_digital_agc);
+  p.tuner_rf_agc = opt_bool(ba.tuner_rf_agc);
+  p.tuner_if_agc = opt_bool(ba.tuner_if_agc);
+  p.USB_sideband = -1;
+  if (ba.tuning_sideband)
+  {
+    if (*ba.tuning_sideband == 'L')
+      p.USB_sideband = 0;
+    else if (*ba.tuning_sideband == 'U')
+      p.USB_sideband = 1;
+  }
+  p.srate_idx = ba.samplerate ? nearest_srate_idx(*ba.samplerate) : -1;
+  p.tuner_bw = ba.tuner_bandwidth ? nearest_bw(*ba.tuner_bandwidth, tuner_type) : -1;
+  // the sign selects the band center - as in the GUI
+  p.band_center_sel = -1;
+  if (ba.r820t_tuner_band_center)
+    p.band_center_sel = (*ba.r820t_tuner_band_center > 0.0) ? 1 : (*ba.r820t_tuner_band_center < 0.0) ? 2 : 0;
+  const std::optional<bool>* gpio[ControlVars::NUM_GPIO_BUTTONS] = {
+    &ba.gpio_button0, &ba.gpio_button1, &ba.gpio_button2, &ba.gpio_button3, &ba.gpio_button4 };
+  for (unsigned k = 0; k < ControlVars::NUM_GPIO_BUTTONS; ++k)
+    p.GPIO[k] = opt_bool(*gpio[k]);
+
+  // a manual gain also deactivates the AGC
+  p.rf_gain = -1;
+  if (ba.tuner_rf_gain_db)
+  {
+    p.tuner_rf_agc = 0;
+    const int n = (tuner_type < tuners::N) ? tuners::rf_gains[tuner_type].num : 0;
+    if (n)
+    {
+      const int idx = nearestGainIdx(int(*ba.tuner_rf_gain_db * 10.0), tuners::rf_gains[tuner_type].gain, n);
+      p.rf_gain = tuners::rf_gains[tuner_type].gain[idx];
+    }
+  }
+  p.if_gain_idx = p.if_gain_val = -1;
+  if (ba.tuner_if_gain_db)
+  {
+    p.tuner_if_agc = 0;
+    const int n = (tuner_type < tuners::N) ? tuners::if_gains[tuner_type].num : 0;
+    if (n)
+    {
+      p.if_gain_idx = nearestGainIdx(int(*ba.tuner_if_gain_db * 10.0), tuners::if_gains[tuner_type].gain, n);
+      p.if_gain_val = tuners::if_gains[tuner_type].gain[p.if_gain_idx];
+    }
+  }
+  return p;
+}
+
+void band_switch_compile(uint32_t tuner_type)
+{
+  const std::vector<BandAction>& bands = get_band_actions();
+  plans.clear();
+  plans.reserve(bands.size());
+  for (const BandAction& ba : bands)
+    plans.push_back(compile(ba, tuner_type));
+  plans_of = bands.data();
+  plans_tuner = tuner_type;
+}
+
+
+// sets nxt to v - when the band sets it. true, when v differs from the live state
+static bool set_var(std::atomic_int& n, const std::atomic_int& l, int v)
+{
+  if (v < 0)
+    return false;
+  n = v;
+  return l.load() != v;
+}
+
+CtrlFlagT band_switch_apply(const BandAction& ba, unsigned& n_changes)
+{
+  const std::vector<BandAction>& bands = get_band_actions();
+  if (plans_of != bands.data() || plans.size() != bands.size() || plans_tuner != tunerNo.load())
+    band_switch_compile(tunerNo.load());   // band plan or tuner changed since
+
+  const size_t idx = size_t(&ba - bands.data());
+  n_changes = 0;
+  if (idx >= plans.size())
+    return 0;
+  const BandSwitchPlan& p = plans[idx];
+
+  CtrlFlagT flags = 0;
+  auto upd = [&](std::atomic_int& n, const std::atomic_int& l, int v, CtrlFlagT f) {
+    if (set_var(n, l, v))
+    {
+      flags |= f;
+      ++n_changes;
+    }
+  };
+  upd(nxt.sampling_mode, last.sampling_mode, p.sampling_mode, CtrlFlags::sampling_mode);
+  upd(nxt.rtl_agc, last.rtl_agc, p.rtl_agc, CtrlFlags::rtl_agc);
+  upd(nxt.tuner_rf_agc, last.tuner_rf_agc, p.tuner_rf_agc, CtrlFlags::rf_agc);
+  upd(nxt.rf_gain, last.rf_gain, p.rf_gain, CtrlFlags::rf_gain);
+  upd(nxt.tuner_if_agc, last.tuner_if_agc, p.tuner_if_agc, CtrlFlags::if_agc_gain);
+  upd(nxt.if_gain_idx, last.if_gain_idx, p.if_gain_idx, CtrlFlags::if_agc_gain);
+  set_var(nxt.if_gain_val, last.if_gain_val, p.if_gain_val);   // follows if_gain_idx
+  upd(nxt.USB_sideband, last.USB_sideband, p.USB_sideband, CtrlFlags::tuner_sideband);
+  for (unsigned k = 0; k < ControlVars::NUM_GPIO_BUTTONS; ++k)
+    upd(nxt.GPIO[k], last.GPIO[k], p.GPIO[k], CtrlFlags::gpio);
+
+  // the resampler's plan selects the ADC rate. rates above the qualified max are lowered
+  int srate_idx = resample_active() ? -1 : p.srate_idx;
+  while (srate_idx > 0 && !rate_qual_stable(rates::tab[srate_idx].valueInt))
+    --srate_idx;
+  upd(nxt.srate_idx, last.srate_idx, srate_idx, CtrlFlags::srate);
+  upd(nxt.tuner_bw, last.tuner_bw, p.tuner_bw, CtrlFlags::tuner_bandwidth);
+  upd(nxt.band_center_sel, last.band_center_sel, p.band_center_sel, CtrlFlags::tuner_band_center);
+  if (p.band_center_sel >= 0)
+  {
+    const int fs = rates::tab[nxt.srate_idx].valueInt;
+    nxt.band_center_LO_delta = (p.band_center_sel == 1) ? fs / 4 : (p.band_center_sel == 2) ? -fs / 4 : 0;
+  }
+  return flags;
+}
+
+
+void band_switch_record(uint64_t ns, unsigned n_changes)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  ++n_switches;
+  sum_ns += ns;
+  if (ns > max_ns)
+    max_ns = ns;
+  last_ns = ns;
+  last_changes = n_changes;
+}
+
+void band_switch_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!n_switches)
+    snprintf(s, len - 1, "no band switch");
+  else
+    snprintf(s, len - 1, "%llu switches: last %.3f ms with %u changes, avg %.3f ms, max %.3f ms",
+      (unsigned long long)n_switches, last_ns / 1E6, last_changes,
+      (sum_ns / double(n_switches)) / 1E6, max_ns / 1E6);
+  s[len - 1] = 0;
+}
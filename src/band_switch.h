@@ -0,0 +1,26 @@
+#pragma once
+
+#include "control.h"
+#include "config_file.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// band transition plans: each band of the band plan, resolved once for the open
+//   device's tuner - gains in dB to the tuner's gain values and indices, letters
+//   of sampling mode and sideband to the values of ControlVars.
+// on a band crossing, only the values, which differ from the live state ('last'),
+//   set their CtrlFlags - and Control_Changes() commands only these.
+
+// open_selected_rtl_device(): resolves all bands for the tuner type
+void band_switch_compile(uint32_t tuner_type);
+
+// moving into the band ba: sets nxt from the band's plan.
+//   returns the CtrlFlags of the changes - and their number in n_changes
+CtrlFlagT band_switch_apply(const BandAction& ba, unsigned& n_changes);
+
+// SetHWLO(): duration of a band switch, including Control_Changes(), in ns
+void band_switch_record(uint64_t ns, unsigned n_changes);
+
+// "n switches: last x ms with k changes, avg y ms, max z ms"
+void band_switch_format_stats(char* s, size_t len);
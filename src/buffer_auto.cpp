@@ -0,0 +1,187 @@
+
+#include "buffer_auto.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <mutex>
+#include <string>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define EVAL_PERIOD_NS    3000000000ULL   // measurement window
+#define MAX_DROP_RATIO    0.005           // tolerance of the sample count against samplerate
+#define SHRINK_DUTY_DIV   4               // try a smaller size below target / 4
+
+
+std::atomic_int buffer_auto = 0;
+std::atomic_int buffer_auto_duty = 50;
+
+static std::mutex mtx;    // the window is written from the callback, evaluated from another thread
+
+static int n_sizes = 0;
+static int cur_idx = -1;
+static int next_idx = -1;
+static int failed_idx = -1;       // largest size, which failed - with sel_device and sel_srate
+static std::string sel_device;
+static int sel_srate = 0;
+static char reason[128] = "not measured";
+
+// measurement window
+static uint64_t w_first = 0, w_prev = 0, w_last_end = 0;
+static uint64_t w_blocks = 0, w_bytes = 0;
+static uint64_t w_busy = 0, w_host = 0, w_max_busy = 0;
+static double w_dt_sum = 0.0, w_dt_sum2 = 0.0;
+static uint32_t w_len = 0;
+static uint64_t w_max_xfer_busy = 0;
+static uint32_t w_xfer_len = 0;
+
+// results of the last window
+static double r_duty = 0.0, r_host = 0.0, r_jitter_ms = 0.0, r_drops = 0.0;
+static uint32_t r_len = 0;
+
+
+static void reset_window()
+{
+  w_first = w_prev = w_last_end = 0;
+  w_blocks = w_bytes = 0;
+  w_busy = w_host = w_max_busy = 0;
+  w_dt_sum = w_dt_sum2 = 0.0;
+  w_max_xfer_busy = 0;
+}
+
+// sizes, which failed, may work with another device or samplerate
+static void restart_search(int srate)
+{
+  failed_idx = -1;
+  next_idx = -1;
+  sel_srate = srate;
+}
+
+int buffer_auto_select(int manual_idx, int sizes, const char* device, int srate)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  n_sizes = sizes;
+  if (sel_device != device || sel_srate != srate)
+  {
+    sel_device = device;
+    restart_search(srate);
+  }
+  if (next_idx < 0 || next_idx >= sizes)
+    next_idx = manual_idx;
+  cur_idx = next_idx;
+  reset_window();
+  return cur_idx;
+}
+
+void buffer_auto_block(uint32_t len, uint64_t t_begin, uint64_t host_ns, uint64_t t_end)
+{
+  if (!buffer_auto.load(std::memory_order_relaxed))
+    return;
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!w_blocks)
+    w_first = t_begin;
+  else
+  {
+    const double dt = double(t_begin - w_prev);
+    w_dt_sum += dt;
+    w_dt_sum2 += dt * dt;
+  }
+  w_prev = t_begin;
+  w_last_end = t_end;
+  ++w_blocks;
+  w_bytes += len;
+  w_len = len;
+  const uint64_t busy = t_end - t_begin;
+  w_busy += busy;
+  w_host += host_ns;
+  if (busy > w_max_busy)
+    w_max_busy = busy;
+}
+
+void buffer_auto_transfer(uint32_t usb_len, uint64_t busy_ns)
+{
+  if (!buffer_auto.load(std::memory_order_relaxed))
+    return;
+  std::lock_guard<std::mutex> lock(mtx);
+  w_xfer_len = usb_len;
+  if (busy_ns > w_max_xfer_busy)
+    w_max_xfer_busy = busy_ns;
+}
+
+bool buffer_auto_evaluate(int srate, int buf_num)
+{
+  if (!buffer_auto.load() || srate <= 0)
+    return false;
+  std::lock_guard<std::mutex> lock(mtx);
+  if (srate != sel_srate)
+  {
+    // samplerate switch while streaming, e.g. by a band: measure anew
+    restart_search(srate);
+    next_idx = cur_idx;
+    reset_window();
+    return false;
+  }
+  if (cur_idx < 0 || w_blocks < 3 || w_last_end - w_first < EVAL_PERIOD_NS)
+    return false;
+
+  // samples between the first and the last block's arrival
+  const double span = double(w_prev - w_first) * 1E-9;
+  const double expected = span * srate;
+  const double received = double(w_bytes - w_len) / 2.0;
+  const double n_dt = double(w_blocks - 1);
+  const double mean_dt = w_dt_sum / n_dt;
+  const double xfer_period_ns = 1E9 * (w_xfer_len / 2) / srate;
+  r_len = w_len;
+  r_duty = double(w_busy) / double(w_last_end - w_first);
+  r_host = double(w_host) / double(w_last_end - w_first);
+  r_jitter_ms = 1E-6 * sqrt(std::fmax(0.0, w_dt_sum2 / n_dt - mean_dt * mean_dt));
+  r_drops = (expected > 0.0) ? std::fmax(0.0, 1.0 - received / expected) : 0.0;
+  const double target = buffer_auto_duty.load() / 100.0;
+  const bool stall = double(w_max_xfer_busy) > 0.5 * buf_num * xfer_period_ns;
+  reset_window();
+
+  const char* why = nullptr;
+  int idx = cur_idx;
+  if (r_drops > MAX_DROP_RATIO || r_duty > target || stall)
+  {
+    why = (r_drops > MAX_DROP_RATIO) ? "drops" : (r_duty > target) ? "duty above target" : "single callback stalls transfers";
+    if (cur_idx > failed_idx)
+      failed_idx = cur_idx;
+    if (cur_idx + 1 < n_sizes)
+      idx = cur_idx + 1;
+  }
+  else if (r_duty < target / SHRINK_DUTY_DIV && cur_idx > 0 && cur_idx - 1 > failed_idx)
+  {
+    why = "duty far below target: trying smaller";
+    idx = cur_idx - 1;
+  }
+
+  if (!why)
+  {
+    snprintf(reason, sizeof(reason) - 1, "within target%s", (cur_idx - 1 == failed_idx) ? " - smaller size failed" : "");
+    reason[sizeof(reason) - 1] = 0;
+    return false;
+  }
+  snprintf(reason, sizeof(reason) - 1, "%s: %s", why, (idx > cur_idx) ? "larger" : (idx < cur_idx) ? "smaller" : "already largest");
+  reason[sizeof(reason) - 1] = 0;
+  if (idx == cur_idx)
+    return false;
+  next_idx = idx;
+  return true;
+}
+
+void buffer_auto_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!buffer_auto.load())
+    snprintf(s, len - 1, "off");
+  else
+    snprintf(s, len - 1, "%u kB: duty %.1f %% (host %.1f %%), jitter %.2f ms, drops %.2f %% - %s",
+      unsigned(r_len / 1024), 100.0 * r_duty, 100.0 * r_host, r_jitter_ms, 100.0 * r_drops, reason);
+  s[len - 1] = 0;
+}
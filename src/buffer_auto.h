@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// adaptive buffer size: measures the duty cycle - own processing and host - per host block,
+//   the arrival of the host blocks and dropped samples. picks the smallest buffer size,
+//   which keeps drops at zero and the duty cycle below buffer_auto_duty.
+//   the host blocks are what the size changes - the USB transfers may have a fixed size.
+// a new size is used with the next StartHW(): the host is asked to restart,
+//   as after a buffer size change in the GUI. sizes which failed are not retried -
+//   until the samplerate or the device change.
+
+extern std::atomic_int buffer_auto;         // 0: manual buffer size, 1: auto
+extern std::atomic_int buffer_auto_duty;    // target duty cycle in %: 10 .. 90
+
+// StartHW(): buffer size index to use - starting from the manual selection
+//   with another device or samplerate
+int buffer_auto_select(int manual_idx, int n_sizes, const char* device, int srate);
+// RtlSdrCallback(): timing of one host block - steady clock in ns
+void buffer_auto_block(uint32_t len, uint64_t t_begin, uint64_t host_ns, uint64_t t_end);
+// RtlSdrCallback(): processing time of one USB transfer, with all its host blocks:
+//   a long one stalls the transfers
+void buffer_auto_transfer(uint32_t usb_len, uint64_t busy_ns);
+// periodically from another thread than the callback - with the number of USB transfers:
+//   true, when another size is needed - then the host has to restart
+bool buffer_auto_evaluate(int srate, int buf_num);
+
+// "64 kB: duty x % (host y %), jitter z ms, drops d % - reason"
+void buffer_auto_format_stats(char* s, size_t len);
@@ -0,0 +1,418 @@
+
+#include "channelizer.h"
+#include "fft.h"
+#include "dsp.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHANNELIZER_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define TAPS_PER_BRANCH   8       // filter bank: prototype length = channels * TAPS_PER_BRANCH
+#define TAPS_PER_DECIM    8       // selected channels: filter length = decimation * TAPS_PER_DECIM
+#define CHUNK_SAMPLES     16384   // blocks are processed in chunks of this size
+#define MAX_CHANNELS      64      // selected channels
+
+
+std::atomic_int channelizer_mode = 0;
+std::atomic_int channelizer_channels = 32;
+std::atomic_int channelizer_decimation = 32;
+char channelizer_freqs[1024] = "0";
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+class ChannelizerTap : public SampleTap
+{
+public:
+  ChannelizerTap(int mode_, unsigned channels, unsigned decimation, const std::vector<double>& offsets_)
+    : mode(mode_), N(channels), D(decimation), offsets(offsets_)
+  {
+    if (mode == 1)
+    {
+      offsets.resize(N);
+      for (unsigned k = 0; k < N; ++k)
+        offsets[k] = double((k < N / 2) ? int(k) : int(k) - int(N));   // in units of srate / N
+    }
+    const unsigned nch = unsigned(offsets.size());
+    levels.reset(new std::atomic<float>[nch]);
+    for (unsigned c = 0; c < nch; ++c)
+      levels[c] = -200.0F;
+    lvl_avg.assign(nch, 0.0);
+    out_re.resize(nch);
+    out_im.resize(nch);
+  }
+
+  const char* name() const override { return "channelizer"; }
+
+  void process(const SampleBlockPtr& blk) override
+  {
+    const auto t0 = std::chrono::steady_clock::now();
+    if (blk->srate != srate)
+      configure(blk->srate);
+
+    const unsigned nch = num_channels();
+    const unsigned n_total = blk->len / 2;
+    for (unsigned c = 0; c < nch; ++c)
+    {
+      out_re[c].clear();
+      out_im[c].clear();
+    }
+    for (unsigned off = 0; off < n_total; off += CHUNK_SAMPLES)
+    {
+      const unsigned n = (n_total - off < CHUNK_SAMPLES) ? (n_total - off) : CHUNK_SAMPLES;
+      const uint8_t* p = blk->data + 2 * size_t(off);
+      for (unsigned k = 0; k < n; ++k)
+      {
+        in_re[k] = (float(p[2 * k]) - 127.5F) * (1.0F / 127.5F);
+        in_im[k] = (float(p[2 * k + 1]) - 127.5F) * (1.0F / 127.5F);
+      }
+      if (mode == 1)
+        run_filter_bank(n);
+      else
+        run_selected(n);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    cpu_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    in_samples += n_total;
+
+    std::shared_ptr<ChannelSink> s;
+    {
+      std::lock_guard<std::mutex> lk(sink_mtx);
+      s = sink;
+    }
+    for (unsigned c = 0; c < nch; ++c)
+    {
+      const unsigned n = unsigned(out_re[c].size());
+      if (!n)
+        continue;
+      double sum = 0.0;
+      for (unsigned k = 0; k < n; ++k)
+        sum += double(out_re[c][k]) * out_re[c][k] + double(out_im[c][k]) * out_im[c][k];
+      lvl_avg[c] = (lvl_avg[c] <= 0.0) ? (sum / n) : (0.9 * lvl_avg[c] + 0.1 * sum / n);
+      levels[c] = float(10.0 * log10(lvl_avg[c] + 1E-20));
+      if (s)
+        s->channel_data(channel_info(c), *blk, out_re[c].data(), out_im[c].data(), n);
+    }
+  }
+
+  unsigned num_channels() const { return unsigned(offsets.size()); }
+
+  ChannelInfo channel_info(unsigned c) const
+  {
+    ChannelInfo ci;
+    ci.index = c;
+    ci.offset = (mode == 1) ? offsets[c] * srate / N : offsets[c];
+    ci.srate = double(srate) / ((mode == 1) ? N : D);
+    return ci;
+  }
+
+  void set_sink(const std::shared_ptr<ChannelSink>& s)
+  {
+    std::lock_guard<std::mutex> lk(sink_mtx);
+    sink = s;
+  }
+
+  std::unique_ptr<std::atomic<float>[]> levels;
+  std::atomic_int srate{ 0 };
+  std::atomic_uint64_t cpu_ns{ 0 };
+  std::atomic_uint64_t in_samples{ 0 };
+
+private:
+  void configure(int new_srate)
+  {
+    srate = new_srate;
+    in_re.resize(CHUNK_SAMPLES);
+    in_im.resize(CHUNK_SAMPLES);
+    std::vector<float> h;
+    if (mode == 1)
+    {
+      L = N * TAPS_PER_BRANCH;
+      dsp_design_lowpass(h, L, 0.5 / N);
+      // per branch reversed: g[p * N + j] = h[p * N + N - 1 - j]
+      g.resize(L);
+      for (unsigned p = 0; p < TAPS_PER_BRANCH; ++p)
+        for (unsigned j = 0; j < N; ++j)
+          g[p * N + j] = h[p * N + N - 1 - j];
+      fft.init(N);
+      fre.resize(N);
+      fim.resize(N);
+      acc_re.resize(N);
+      acc_im.resize(N);
+      hist_re.assign(L + CHUNK_SAMPLES, 0.0F);
+      hist_im.assign(L + CHUNK_SAMPLES, 0.0F);
+      hist_w = L;
+      phase = 0;
+    }
+    else
+    {
+      L = D * TAPS_PER_DECIM;
+      dsp_design_lowpass(h, L, 0.4 / D);
+      // reversed: y[t] = sum hr[l] * x[t - L + 1 + l]
+      g.resize(L);
+      for (unsigned l = 0; l < L; ++l)
+        g[l] = h[L - 1 - l];
+      const unsigned nch = num_channels();
+      ch_re.assign(nch, std::vector<float>(L + CHUNK_SAMPLES, 0.0F));
+      ch_im.assign(nch, std::vector<float>(L + CHUNK_SAMPLES, 0.0F));
+      nco.assign(nch, NCO());
+      for (unsigned c = 0; c < nch; ++c)
+        nco[c].set_freq(-offsets[c] / srate);
+      phase = 0;
+    }
+  }
+
+  // critically sampled polyphase analysis filter bank
+  void run_filter_bank(unsigned n)
+  {
+    const unsigned P = TAPS_PER_BRANCH;
+    for (unsigned k = 0; k < n; ++k)
+    {
+      if (hist_w == hist_re.size())
+      {
+        // keep the last L samples
+        memmove(hist_re.data(), hist_re.data() + hist_w - L, L * sizeof(float));
+        memmove(hist_im.data(), hist_im.data() + hist_w - L, L * sizeof(float));
+        hist_w = L;
+      }
+      hist_re[hist_w] = in_re[k];
+      hist_im[hist_w] = in_im[k];
+      ++hist_w;
+      if (++phase < N)
+        continue;
+      phase = 0;
+
+      // acc[j] = sum_p g[p * N + j] * x[w - (p + 1) * N + j]
+      for (unsigned j = 0; j < N; j += 4)
+      {
+#ifdef CHANNELIZER_USE_SSE2
+        __m128 ar = _mm_setzero_ps();
+        __m128 ai = _mm_setzero_ps();
+        for (unsigned p = 0; p < P; ++p)
+        {
+          const __m128 c = _mm_load_ps(&g[p * N + j]);
+          const size_t x = hist_w - (p + 1) * N + j;
+          ar = _mm_add_ps(ar, _mm_mul_ps(c, _mm_loadu_ps(&hist_re[x])));
+          ai = _mm_add_ps(ai, _mm_mul_ps(c, _mm_loadu_ps(&hist_im[x])));
+        }
+        _mm_store_ps(&acc_re[j], ar);
+        _mm_store_ps(&acc_im[j], ai);
+#else
+        for (unsigned q = j; q < j + 4; ++q)
+        {
+          float ar = 0.0F, ai = 0.0F;
+          for (unsigned p = 0; p < P; ++p)
+          {
+            const size_t x = hist_w - (p + 1) * N + q;
+            ar += g[p * N + q] * hist_re[x];
+            ai += g[p * N + q] * hist_im[x];
+          }
+          acc_re[q] = ar;
+          acc_im[q] = ai;
+        }
+#endif
+      }
+      // inverse DFT of v[n] = acc[N - 1 - n] with the forward FFT: fre[n] = acc[(n + N - 1) % N]
+      fre[0] = acc_re[N - 1];
+      fim[0] = acc_im[N - 1];
+      memcpy(fre.data() + 1, acc_re.data(), (N - 1) * sizeof(float));
+      memcpy(fim.data() + 1, acc_im.data(), (N - 1) * sizeof(float));
+      fft.forward(fre.data(), fim.data());
+      for (unsigned c = 0; c < N; ++c)
+      {
+        out_re[c].push_back(fre[c]);
+        out_im[c].push_back(fim[c]);
+      }
+    }
+  }
+
+  // per channel: mix down with NCO, then decimating FIR
+  void run_selected(unsigned n)
+  {
+    const unsigned nch = num_channels();
+    unsigned start_phase = phase;
+    for (unsigned c = 0; c < nch; ++c)
+    {
+      nco[c].mix(in_re.data(), in_im.data(), ch_re[c].data() + L, ch_im[c].data() + L, n);
+
+      // decimate: outputs at every D-th sample
+      unsigned ph_d = start_phase;
+      for (unsigned k = 0; k < n; ++k)
+      {
+        if (++ph_d < D)
+          continue;
+        ph_d = 0;
+        const size_t t = L + k;    // index of newest sample in ch_re[c]
+        out_re[c].push_back(dsp_dot(g.data(), &ch_re[c][t - L + 1], L));
+        out_im[c].push_back(dsp_dot(g.data(), &ch_im[c][t - L + 1], L));
+      }
+      if (c + 1 == nch)
+        phase = ph_d;
+      // keep the last L samples as history
+      memmove(ch_re[c].data(), ch_re[c].data() + n, L * sizeof(float));
+      memmove(ch_im[c].data(), ch_im[c].data() + n, L * sizeof(float));
+    }
+  }
+
+  const int mode;
+  const unsigned N;
+  const unsigned D;
+  std::vector<double> offsets;    // filter bank: in units of srate / N
+  unsigned L = 0;
+  unsigned phase = 0;
+
+  AlignedFloats g;
+  std::vector<float> in_re, in_im;
+  // filter bank
+  FFT fft;
+  AlignedFloats fre, fim, acc_re, acc_im;
+  std::vector<float> hist_re, hist_im;
+  size_t hist_w = 0;
+  // selected channels
+  std::vector<std::vector<float>> ch_re, ch_im;
+  std::vector<NCO> nco;
+
+  std::vector<std::vector<float>> out_re, out_im;
+  std::vector<double> lvl_avg;
+
+  std::mutex sink_mtx;
+  std::shared_ptr<ChannelSink> sink;
+};
+
+
+static std::mutex chan_mtx;
+static std::shared_ptr<ChannelizerTap> chan_tap;
+static std::shared_ptr<ChannelSink> chan_sink;
+static int chan_tap_id = 0;
+
+
+void channelizer_start()
+{
+  char acMsg[256];
+  const int mode = channelizer_mode.load();
+  if (mode < 1 || mode > 2)
+    return;
+  std::lock_guard<std::mutex> lk(chan_mtx);
+  if (chan_tap_id)
+    return;
+
+  const int N = channelizer_channels.load();
+  const int D = channelizer_decimation.load();
+  std::vector<double> offsets;
+  if (mode == 1 && (N < 16 || N > 1024 || (N & (N - 1))))
+  {
+    SDRLG(extHw_MSG_ERROR, "channelizer: invalid number of channels %d", N);
+    return;
+  }
+  if (mode == 2)
+  {
+    const char* p = channelizer_freqs;
+    while (*p && offsets.size() < MAX_CHANNELS)
+    {
+      char* end = nullptr;
+      const double f = strtod(p, &end);
+      if (end == p)
+        break;
+      offsets.push_back(f);
+      p = end;
+      while (*p == ',' || *p == ';' || *p == ' ')
+        ++p;
+    }
+    if (offsets.empty() || D < 2 || D > 256)
+    {
+      SDRLOG(extHw_MSG_ERROR, "channelizer: no channel frequencies or invalid decimation");
+      return;
+    }
+  }
+
+  chan_tap = std::make_shared<ChannelizerTap>(mode, unsigned(N), unsigned(D), offsets);
+  chan_tap->set_sink(chan_sink);
+  chan_tap_id = sample_taps_register(chan_tap, 16);
+  SDRLG(extHw_MSG_LOG, "channelizer: %s with %u channels", (mode == 1) ? "filter bank" : "selected channels",
+    chan_tap->num_channels());
+}
+
+void channelizer_stop()
+{
+  std::lock_guard<std::mutex> lk(chan_mtx);
+  if (!chan_tap_id)
+    return;
+  sample_taps_unregister(chan_tap_id);
+  chan_tap_id = 0;
+}
+
+void channelizer_set_sink(const std::shared_ptr<ChannelSink>& sink)
+{
+  std::lock_guard<std::mutex> lk(chan_mtx);
+  chan_sink = sink;
+  if (chan_tap)
+    chan_tap->set_sink(sink);
+}
+
+void channelizer_format_levels(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lk(chan_mtx);
+  s[0] = 0;
+  if (!chan_tap)
+    return;
+  size_t pos = 0;
+  for (unsigned c = 0; c < chan_tap->num_channels() && pos + 1 < len; ++c)
+  {
+    const int r = snprintf(s + pos, len - pos - 1, "%s%+.0f Hz: %.1f dB", c ? "; " : "",
+      chan_tap->channel_info(c).offset, chan_tap->levels[c].load());
+    if (r < 0)
+      break;
+    pos += size_t(r);
+  }
+  s[len - 1] = 0;
+}
+
+void channelizer_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lk(chan_mtx);
+  if (!chan_tap || !chan_tap->srate.load())
+  {
+    snprintf(s, len - 1, "%s", "not running");
+    s[len - 1] = 0;
+    return;
+  }
+  const unsigned nch = chan_tap->num_channels();
+  const double srate = chan_tap->srate.load();
+  const double out_rate = chan_tap->channel_info(0).srate;
+  const double cpu_s = chan_tap->cpu_ns.load() * 1E-9;
+  const double stream_s = chan_tap->in_samples.load() / srate;
+  const double load = (stream_s > 0.0) ? cpu_s / stream_s : 0.0;
+  snprintf(s, len - 1, "%u channels at %.1f kSps, input %.2f MSps: %.1f %% of one core => %.1f MSps channels x rate per core",
+    nch, out_rate / 1E3, srate / 1E6, 100.0 * load, (load > 0.0) ? nch * out_rate / load / 1E6 : 0.0);
+  s[len - 1] = 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sample_taps.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+// channelizer: many narrowband channels from one stream - running as sample tap.
+// mode 1: polyphase filter bank. N equally spaced channels at k * srate / N,
+//   each decimated by N. one FFT of size N per N input samples serves all channels.
+//   channel k >= N/2 is at (k - N) * srate / N
+// mode 2: selected channels at arbitrary offsets from the LO,
+//   each with an own NCO and decimating FIR filter
+// the filters run on SSE2, when available.
+// output is delivered to a ChannelSink - registered in-process.
+// the built-in sink measures the power per channel.
+
+extern std::atomic_int channelizer_mode;         // 0: off, 1: filter bank, 2: selected channels
+extern std::atomic_int channelizer_channels;     // filter bank: power of 2: 16 .. 1024
+extern std::atomic_int channelizer_decimation;   // selected channels: 2 .. 256
+extern char channelizer_freqs[1024];             // selected channels: offsets in Hz, comma separated
+
+
+struct ChannelInfo
+{
+  unsigned index;
+  double offset;        // in Hz from the LO
+  double srate;         // output samplerate in Hz
+};
+
+class ChannelSink
+{
+public:
+  virtual ~ChannelSink() {}
+  // called from a sample tap's pool thread, for each channel per USB block.
+  // complex samples in split arrays, full scale is 1.0
+  virtual void channel_data(const ChannelInfo& ch, const SampleBlock& blk,
+    const float* re, const float* im, unsigned n) = 0;
+};
+
+void channelizer_start();
+void channelizer_stop();
+// additional in-process consumer - beside the level meter. nullptr to remove
+void channelizer_set_sink(const std::shared_ptr<ChannelSink>& sink);
+
+// "+0 Hz: -52.1 dB; +75000 Hz: -80.3 dB; .."
+void channelizer_format_levels(char* s, size_t len);
+// "n channels at x kSps, input y MSps: z % of one core => c MSps channels x rate per core"
+void channelizer_format_stats(char* s, size_t len);
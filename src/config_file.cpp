@@ -1,13 +1,17 @@
 
 #include "config_file.h"
+#include "band_cache.h"
 
 #include <toml++/toml.h>
 
 #include <shlobj_core.h>
 
+#include <stdio.h>
 #include <vector>
 #include <fstream>
 #include <cstring>
+#include <algorithm>
+#include <chrono>
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4996)
@@ -20,6 +24,7 @@ static char confFile[MAX_PATH + MAX_PATH];
 // keys (strings) in .cfg file
 static const std::string key_enable("enable");
 static const std::string key_log("log");
+static const std::string key_usb_buf_num("usb_buf_num");
 
 static const std::string key_band_name("name");
 static const std::string key_freq_from("freq_from");
@@ -51,6 +56,13 @@ static const BandAction initial_band_action{ "_init_", {}, -1.0, -1.0 };
 
 static const BandAction* current_band_action = &initial_band_action;
 
+static std::optional<int> usb_buf_num;
+
+// timings of the band plan
+static bool from_cache = false;
+static double parse_ms = 0.0;
+static double load_ms = 0.0;
+
 
 static bool is_expected_value_type(
   const std::string& id, const std::string& key, const std::string& expected_key,
@@ -284,6 +296,7 @@ static bool write_default_config(const char* fn)
       { "# comment2", "this file is automatically created as example/template, showing possible keys" },
       { "# enable", "thus, set enable to 'true' to activate; keep 'false' to deactivate" },
       { "# log", "log parsing to the file 'parsed_infos.txt'" },
+      { "# usb_buf_num", "optional: number of USB transfers: 0 for librtlsdr's default - overrides the setting" },
       { key_enable, false },        // have it deactivated by default!
       { key_log, false },
       { "bands", toml::table{{
@@ -291,9 +304,9 @@ static bool write_default_config(const char* fn)
           { "# freq_from", "mandatory: low band edge: frequency in Hz" },
           { "# freq_to", "mandatory: high band edge: frequency in Hz" },
           { "# sampling_mode", "optional: 'I', 'Q' or 'C' for complex/both lines" },
-          { "# samplerate", "optional: samplerate" },
-          { "# tuner_bandwidth", "optional" },
-          { "# r820t_tuner_band_center", "optional" },
+          { "# samplerate", "optional: samplerate in Hz - the nearest of the list. switched while streaming" },
+          { "# tuner_bandwidth", "optional: in Hz - the nearest of the tuner. 0 for automatic" },
+          { "# r820t_tuner_band_center", "optional: > 0 for +samplerate/4, < 0 for -samplerate/4, 0 for the center" },
           { "# tuning_sideband", "optional: tuning_sideband" },     // @todo
           { "# tuner_rf_agc", "optional: " },
           { "# tuner_rf_gain_db", "optional" },
@@ -395,18 +408,45 @@ const char* init_toml_config()
     //if (!write_ok)
     //    ;
   }
+  else
+    fclose(f);
 
   std::ofstream parsed_infos;
 
+  // compiled band plan - when the .cfg is unchanged
+  const auto t0 = std::chrono::steady_clock::now();
+  BandCacheInfo cache_info;
+  if (band_cache_load(fn, band_actions, cache_info))
+  {
+    band_status = cache_info.status;
+    usb_buf_num = cache_info.usb_buf_num;
+    from_cache = true;
+    parse_ms = cache_info.parse_ms;
+    load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (cache_info.log)
+    {
+      parsed_infos.open("parsed_infos.txt");
+      parsed_infos << "info: loaded " << band_actions.size() << " bands from the cache in " << load_ms
+        << " ms. parsing took " << parse_ms << " ms\n";
+      parsed_infos.close();
+    }
+    return fn;
+  }
+
+  band_actions.clear();     // from an invalid cache
   toml::table tbl;
   bool parse_cfg = false;
+  bool log_enabled = false;
   try
   {
     tbl = toml::parse_file(fn);
     auto it_log = tbl.find(key_log);
     if (it_log != tbl.end() && it_log->second.is_boolean())
       if (it_log->second.as_boolean()->get())
+      {
+        log_enabled = true;
         parsed_infos.open("parsed_infos.txt");
+      }
 
     auto it_enable = tbl.find(key_enable);
     if (it_enable != tbl.end() && it_enable->second.is_boolean())
@@ -416,6 +456,15 @@ const char* init_toml_config()
     {
       print_toml_tables(0, tbl, parsed_infos);
 
+      auto it_buf_num = tbl.find(key_usb_buf_num);
+      if (it_buf_num != tbl.end())
+      {
+        if (it_buf_num->second.is_integer())
+          usb_buf_num = int(it_buf_num->second.as_integer()->get());
+        else
+          parsed_infos << "error: '" << key_usb_buf_num << "' is no integer!\n";
+      }
+
       if (!band_actions.size())
         band_status = BandAction::Band_Info::info_no_bands;
       else
@@ -430,6 +479,23 @@ const char* init_toml_config()
     parsed_infos << "Parsing failed : \n" << err << "\n";
   }
 
+  // the cache's order: overlapping bands match in order of freq_from
+  std::stable_sort(band_actions.begin(), band_actions.end(),
+    [](const BandAction& a, const BandAction& b) { return a.freq_from < b.freq_from; });
+  parse_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  parsed_infos << "info: parsed " << band_actions.size() << " bands in " << parse_ms << " ms\n";
+
+  // a parse error is reported with every start - not cached
+  if (band_status != BandAction::Band_Info::info_parse_error)
+  {
+    cache_info.status = band_status;
+    cache_info.usb_buf_num = usb_buf_num;
+    cache_info.log = log_enabled;
+    cache_info.parse_ms = parse_ms;
+    if (!band_cache_store(fn, band_actions, cache_info))
+      parsed_infos << "warning: could not write the band plan cache\n";
+  }
+
   parsed_infos.close();
   return fn;
 }
@@ -439,9 +505,39 @@ BandAction::Band_Info get_band_info()
   return band_status;
 }
 
+std::optional<int> get_config_usb_buf_num()
+{
+  return usb_buf_num;
+}
+
+void format_band_plan_stats(char* s, size_t len)
+{
+  if (from_cache)
+    snprintf(s, len - 1, "%u bands: loaded from cache in %.2f ms - parsing took %.2f ms",
+      unsigned(band_actions.size()), load_ms, parse_ms);
+  else
+    snprintf(s, len - 1, "%u bands: parsed in %.2f ms - cache written for the next start",
+      unsigned(band_actions.size()), parse_ms);
+  s[len - 1] = 0;
+}
+
+std::string get_user_profile_path(const char* fn)
+{
+  char path[MAX_PATH + MAX_PATH];
+  if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_PROFILE, NULL, 0, path)))
+    return std::string(path) + "\\" + fn;
+  return std::string(fn);
+}
 
-const BandAction* update_band_action(double new_frequency)
+
+const std::vector<BandAction>& get_band_actions()
 {
+  return band_actions;
+}
+
+const BandAction* update_band_action(double new_frequency, bool& entered)
+{
+  entered = false;
   if (!band_actions.size())
     return nullptr;
 
@@ -451,7 +547,7 @@ const BandAction* update_band_action(double new_frequency)
     )
   {
     // still in last band
-    return nullptr;
+    return (current_band_action != &initial_band_action) ? current_band_action : nullptr;
   }
 
   // else: moved out of last band => no action
@@ -463,6 +559,7 @@ const BandAction* update_band_action(double new_frequency)
     {
       // moved into new band => action
       current_band_action = &band;
+      entered = true;
       return current_band_action;
     }
   }
@@ -51,4 +51,18 @@ const char* init_toml_config();
 
 BandAction::Band_Info get_band_info();
 
-const BandAction* update_band_action(double new_frequency);
+// "n bands: loaded from cache in x ms - parsing took y ms"
+void format_band_plan_stats(char* s, size_t len);
+
+// optional 'usb_buf_num' - number of USB transfers
+std::optional<int> get_config_usb_buf_num();
+
+// fn in the user's profile directory - where the .cfg file is
+std::string get_user_profile_path(const char* fn);
+
+// all bands - sorted by freq_from
+const std::vector<BandAction>& get_band_actions();
+
+// the band of new_frequency - or nullptr, when it is in none.
+//   entered is true, when it's another band than with the previous frequency
+const BandAction* update_band_action(double new_frequency, bool& entered);
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <cstring>
 #include <atomic>
+#include <mutex>
 
 using CtrlFlagT = uint32_t;
 
@@ -130,11 +131,21 @@ extern uint32_t RtlSelectedDeviceIdx;  // index into RtlDeviceList[]
 extern rtlsdr_dev_t* RtlSdrDev;
 
 uint32_t retrieve_devices();
+bool is_device_open();   // local USB handle or connected rtl_tcp server
 bool is_device_handle_valid();
 void close_rtl_device();
 bool open_selected_rtl_device();
 
+// serialized: callable from any thread
 bool Control_Changes();
+// held by Control_Changes() - and by others commanding the device, e.g. the rate qualification
+extern std::mutex control_mtx;
+
+// 1: one pass in dependency order, skipping values in effect - with one log line.
+//   0: each call with its log line - for comparison
+extern std::atomic_int control_batched;
+// "open: batched x ms / n calls, single .. - changes: batched .., single .."
+void control_format_stats(char* s, size_t len);
 
 extern std::atomic_uint32_t tunerNo;
 extern std::atomic_bool GotTunerInfo;
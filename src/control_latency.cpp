@@ -0,0 +1,177 @@
+
+#include "control_latency.h"
+#include "config_file.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <string>
+#include <mutex>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+
+static const char* latency_fn = "rtl_sdr_extio_control_latency.txt";
+
+static constexpr int BUCKETS_PER_OCTAVE = 4;
+static constexpr int NUM_BUCKETS = 25 * BUCKETS_PER_OCTAVE;   // 1 us .. 33 s
+static constexpr int MAX_OPS = 24;
+
+struct OpLatency
+{
+  char name[48];
+  uint64_t n;
+  uint64_t failures;
+  uint64_t sum_ns;
+  uint64_t max_ns;
+  uint32_t hist[NUM_BUCKETS];
+};
+
+static std::mutex mtx;
+static OpLatency ops[MAX_OPS];
+static int n_ops = 0;
+static uint64_t n_passes = 0, n_all_start = 0, n_all_flag = 0;
+
+
+static int bucket_of(uint64_t ns)
+{
+  const double us = ns / 1E3;
+  if (us <= 1.0)
+    return 0;
+  const int b = int(std::ceil(std::log2(us) * BUCKETS_PER_OCTAVE));
+  return (b < NUM_BUCKETS) ? b : (NUM_BUCKETS - 1);
+}
+
+// upper bound of the bucket in us
+static double bucket_us(int b)
+{
+  return std::exp2(double(b) / BUCKETS_PER_OCTAVE);
+}
+
+// op's name up to '(' - without the common "rtlsdr_"
+static OpLatency* find_op(const char* op)
+{
+  if (!strncmp(op, "rtlsdr_", 7))
+    op += 7;
+  const size_t l = strcspn(op, "(");
+  for (int k = 0; k < n_ops; ++k)
+  {
+    if (strlen(ops[k].name) == l && !strncmp(ops[k].name, op, l))
+      return &ops[k];
+  }
+  if (n_ops >= MAX_OPS || l >= sizeof(ops[0].name))
+    return nullptr;
+  OpLatency* o = &ops[n_ops++];
+  memset(o, 0, sizeof(*o));
+  memcpy(o->name, op, l);
+  o->name[l] = 0;
+  return o;
+}
+
+static double percentile_us(const OpLatency& o, double q)
+{
+  const uint64_t rank = uint64_t(std::ceil(q * double(o.n)));
+  uint64_t cum = 0;
+  for (int b = 0; b < NUM_BUCKETS; ++b)
+  {
+    cum += o.hist[b];
+    if (cum >= rank)
+      return std::fmin(bucket_us(b), o.max_ns / 1E3);
+  }
+  return o.max_ns / 1E3;
+}
+
+
+void control_latency_record(const char* op, uint64_t ns, bool failed)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  OpLatency* o = find_op(op);
+  if (!o)
+    return;
+  ++o->n;
+  if (failed)
+    ++o->failures;
+  o->sum_ns += ns;
+  if (ns > o->max_ns)
+    o->max_ns = ns;
+  ++o->hist[bucket_of(ns)];
+}
+
+void control_latency_pass(bool command_all, bool at_start)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  ++n_passes;
+  if (command_all && at_start)
+    ++n_all_start;
+  else if (command_all)
+    ++n_all_flag;
+}
+
+void control_latency_reset()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  n_ops = 0;
+  n_passes = n_all_start = n_all_flag = 0;
+}
+
+
+void control_latency_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t o = 0;
+  int r = snprintf(s, len, "%llu passes, %llu command all (open/start %llu, flag %llu)",
+    (unsigned long long)n_passes, (unsigned long long)(n_all_start + n_all_flag),
+    (unsigned long long)n_all_start, (unsigned long long)n_all_flag);
+  o += (r > 0 && size_t(r) < len - o) ? size_t(r) : 0;
+  for (int k = 0; k < n_ops; ++k)
+  {
+    const OpLatency& op = ops[k];
+    r = snprintf(s + o, len - o, "%s%s: %llu %.0f/%.0f/%.0f us", k ? ", " : " - ", op.name,
+      (unsigned long long)op.n, percentile_us(op, 0.5), percentile_us(op, 0.99), op.max_ns / 1E3);
+    o += (r > 0 && size_t(r) < len - o) ? size_t(r) : 0;
+    if (op.failures)
+    {
+      r = snprintf(s + o, len - o, " %llu failed", (unsigned long long)op.failures);
+      o += (r > 0 && size_t(r) < len - o) ? size_t(r) : 0;
+    }
+  }
+  s[len - 1] = 0;
+}
+
+bool control_latency_write_file()
+{
+  const std::string fn = get_user_profile_path(latency_fn);
+  FILE* f = fopen(fn.c_str(), "w");
+  if (!f)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mtx);
+  fprintf(f, "# Control_Changes(): %llu passes, %llu command all - from open/start %llu, from flag %llu\n",
+    (unsigned long long)n_passes, (unsigned long long)(n_all_start + n_all_flag),
+    (unsigned long long)n_all_start, (unsigned long long)n_all_flag);
+  fprintf(f, "# op\tcount\tfailed\tavg_us\tp50_us\tp99_us\tmax_us\n");
+  for (int k = 0; k < n_ops; ++k)
+  {
+    const OpLatency& op = ops[k];
+    fprintf(f, "%s\t%llu\t%llu\t%.1f\t%.1f\t%.1f\t%.1f\n", op.name,
+      (unsigned long long)op.n, (unsigned long long)op.failures,
+      op.n ? (op.sum_ns / double(op.n)) / 1E3 : 0.0,
+      percentile_us(op, 0.5), percentile_us(op, 0.99), op.max_ns / 1E3);
+  }
+  // histograms: upper bound of the bucket in us, count - non-empty buckets only
+  for (int k = 0; k < n_ops; ++k)
+  {
+    const OpLatency& op = ops[k];
+    fprintf(f, "\n# %s\n", op.name);
+    for (int b = 0; b < NUM_BUCKETS; ++b)
+    {
+      if (op.hist[b])
+        fprintf(f, "%.1f\t%u\n", bucket_us(b), unsigned(op.hist[b]));
+    }
+  }
+  return (fclose(f) == 0);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// latency of the single rtlsdr_*() calls in Control_Changes():
+//   one histogram per operation - keyed by the function's name up to '(' -
+//   with 4 buckets per octave from 1 us. percentiles are the bucket's upper bound.
+// also counts the passes of Control_Changes(), which command everything:
+//   from device open or StartHW() - or from CtrlFlags::everything.
+
+// Control_Changes(): duration of one call in ns. failed: return code < 0
+void control_latency_record(const char* op, uint64_t ns, bool failed);
+// Control_Changes() and Control_Changes_remote(): every pass
+void control_latency_pass(bool command_all, bool at_start);
+
+void control_latency_reset();
+
+// "n passes, k command all (open/start a, flag b) - op: count p50/p99/max us, .."
+void control_latency_format_stats(char* s, size_t len);
+// full table into 'rtl_sdr_extio_control_latency.txt' in the user's profile directory
+bool control_latency_write_file();
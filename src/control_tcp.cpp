@@ -2,12 +2,21 @@
 #include "control.h"
 #include "rates.h"
 #include "tuners.h"
+#include "rtl_tcp_client.h"
+#include "rtl_tcp_proto.h"
+#include "rate_qual.h"
+#include "device_profile.h"
+#include "band_switch.h"
+#include "control_latency.h"
+#include "dc_avoid.h"
 
 #include "LC_ExtIO_Types.h"
 
 #include <stdio.h>
 #include <assert.h>
 #include <cmath>
+#include <chrono>
+#include <mutex>
 
 
 #ifdef _MSC_VER
@@ -91,6 +100,112 @@ static inline void clear_flag(CtrlFlagT& flags, CtrlFlagT f)
 }
 
 
+std::atomic_int control_batched = 1;
+
+// the rtlsdr_*() calls or rtl_tcp commands of one Control_Changes():
+//   logged one by one - or, batched, collected into one log line at the end.
+//   done() takes the call's return code: its latency goes to control_latency
+class ControlCalls
+{
+public:
+  explicit ControlCalls(bool batched_) : batched(batched_) { names[0] = 0; }
+
+  void add(const char* name)
+  {
+    ++n;
+    const size_t used = strlen(names);
+    if (batched && used + strlen(name) + 3 < sizeof(names))
+      snprintf(names + used, sizeof(names) - used, "%s%s", used ? ", " : "", name);
+    op = name;
+    t_op = std::chrono::steady_clock::now();
+  }
+
+  void log(const char* name)
+  {
+    add(name);
+    if (!batched)
+    {
+      char acMsg[256];
+      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): %s", name);
+      t_op = std::chrono::steady_clock::now();
+    }
+  }
+
+  int done(int r)
+  {
+    const auto t = std::chrono::steady_clock::now();
+    if (op)
+      control_latency_record(op, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t - t_op).count()), r < 0);
+    t_op = t;   // retries
+    return r;
+  }
+
+  void flush(const char* fn, bool command_all)
+  {
+    if (!batched || !n)
+      return;
+    char msg[640];
+    snprintf(msg, sizeof(msg) - 1, "%s(): %s%u calls: %s", fn, command_all ? "ALL - " : "", n, names);
+    msg[sizeof(msg) - 1] = 0;
+    SDRLOG(extHw_MSG_DEBUG, msg);
+  }
+
+  const bool batched;
+  unsigned n = 0;
+
+private:
+  char names[512];
+  const char* op = nullptr;
+  std::chrono::steady_clock::time_point t_op;
+};
+
+// time to configured: [batched][command_all]
+struct ControlTiming
+{
+  uint64_t n = 0;
+  uint64_t sum_ns = 0;
+  uint64_t last_ns = 0;
+  unsigned last_calls = 0;
+};
+
+static std::mutex timing_mtx;
+static ControlTiming timings[2][2];
+
+static void record_timing(const ControlCalls& calls, bool command_all, std::chrono::steady_clock::time_point t0)
+{
+  const uint64_t ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+  std::lock_guard<std::mutex> lock(timing_mtx);
+  ControlTiming& t = timings[calls.batched ? 1 : 0][command_all ? 1 : 0];
+  ++t.n;
+  t.sum_ns += ns;
+  t.last_ns = ns;
+  t.last_calls = calls.n;
+}
+
+static int format_timing(char* s, size_t len, const char* mode, const ControlTiming& t)
+{
+  if (!t.n)
+    return snprintf(s, len, "%s -", mode);
+  return snprintf(s, len, "%s %.2f ms / %u calls", mode, (t.sum_ns / double(t.n)) / 1E6, t.last_calls);
+}
+
+void control_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(timing_mtx);
+  size_t o = 0;
+  for (int all = 1; all >= 0; --all)
+  {
+    int r = snprintf(s + o, len - o, "%s", all ? "open: " : " - changes: ");
+    o += (r > 0 && size_t(r) < len - o) ? size_t(r) : 0;
+    r = format_timing(s + o, len - o, "batched", timings[1][all]);
+    o += (r > 0 && size_t(r) < len - o) ? size_t(r) : 0;
+    r = format_timing(s + o, len - o, ", single", timings[0][all]);
+    o += (r > 0 && size_t(r) < len - o) ? size_t(r) : 0;
+  }
+  s[len - 1] = 0;
+}
+
+
 static inline bool isR82XX()
 {
   const int t = tunerNo;
@@ -149,6 +264,20 @@ uint32_t retrieve_devices()
   // const uint32_t prevRtlNumDevices = RtlNumDevices;
   RtlNumDevices = 0;
   bool replaced_open_dev = false;
+
+  if (rtl_tcp_client_is_configured())
+  {
+    // remote rtl_tcp server replaces the local USB devices
+    RtlDeviceInfo& dev_info = RtlDeviceList[RtlNumDevices];
+    dev_info.clear();
+    dev_info.dev_idx = 0;
+    snprintf(dev_info.product, 255, "%s", "rtl_tcp");
+    snprintf(dev_info.serial, 255, "%s:%d", rtl_tcp_client_host, rtl_tcp_client_port.load());
+    snprintf(dev_info.name, 255, "rtl_tcp: %s:%d", rtl_tcp_client_host, rtl_tcp_client_port.load());
+    ++RtlNumDevices;
+    RtlSelectedDeviceIdx = 0;
+    return RtlNumDevices;
+  }
   uint32_t N = rtlsdr_get_device_count();
   if (N > MAX_RTL_DEVICES)
     N = MAX_RTL_DEVICES;
@@ -213,9 +342,22 @@ uint32_t retrieve_devices()
   return RtlNumDevices;
 }
 
+bool is_device_open()
+{
+  return RtlSdrDev || rtl_tcp_client_is_connected();
+}
+
 bool is_device_handle_valid()
 {
   char acMsg[256];
+  if (rtl_tcp_client_is_configured())
+  {
+    if (rtl_tcp_client_is_connected())
+      return true;
+    SDRLOG(extHw_MSG_WARNING, "is_device_handle_valid(): rtl_tcp connection lost!");
+    return false;
+  }
+
   if (!RtlSdrDev)
   {
     SDRLOG(extHw_MSG_WARNING, "is_device_handle_valid(): invalid handle!");
@@ -235,13 +377,56 @@ bool is_device_handle_valid()
 void close_rtl_device()
 {
   char acMsg[256];
+  rate_qual_stop();   // the qualification streams from the device
   if (RtlSdrDev)
     SDRLG(extHw_MSG_DEBUG, "close_rtl_device(handle 0x%p)", RtlSdrDev);
   rtlsdr_close(RtlSdrDev);
   RtlSdrDev = 0;
+  rtl_tcp_client_disconnect();
+  device_profile_flush();
   tunerNo = RTLSDR_TUNER_UNKNOWN;
   GotTunerInfo = false;
   RtlOpenDevice.clear();
+  rate_qual_max = 0;
+}
+
+// the open device's profile: applied before Control_Changes() commands everything
+static void apply_device_profile(uint32_t tuner_type)
+{
+  char acMsg[256];
+  DeviceProfile p;
+  const bool found = device_profile_get(RtlOpenDevice.serial, p);
+  if (found && p.tuner_type >= 0 && uint32_t(p.tuner_type) != tuner_type)
+  {
+    SDRLG(extHw_MSG_WARNING, "profile of serial '%s' is for another tuner type: ignored. serials should be unique!", RtlOpenDevice.serial);
+    rate_qual_max = 0;
+    return;
+  }
+
+  if (p.freq_corr_ppm)
+    nxt.freq_corr_ppm = *p.freq_corr_ppm;
+  rate_qual_load(p);
+  bool created = false;
+  if (p.tuner_type < 0)
+  {
+    p.tuner_type = int(tuner_type);
+    created = device_profile_set(RtlOpenDevice.serial, p);
+  }
+  if (found || created)
+    SDRLG(extHw_MSG_DEBUG, "profile of serial '%s': %s", RtlOpenDevice.serial, found ? "applied" : "created");
+}
+
+// the frequency correction, applied to the device, into its profile.
+//   written at StopHW(), CloseHW() or closing the device - not per step of the ppm control
+static void store_device_ppm(int ppm)
+{
+  DeviceProfile p;
+  if (!device_profile_get(RtlOpenDevice.serial, p) || p.tuner_type != int(tunerNo.load()))
+    return;
+  if (p.freq_corr_ppm.value_or(0) == ppm)
+    return;
+  p.freq_corr_ppm = ppm;
+  device_profile_update(RtlOpenDevice.serial, p);
 }
 
 bool open_selected_rtl_device()
@@ -256,16 +441,31 @@ bool open_selected_rtl_device()
   RtlOpenDevice = RtlDeviceList[RtlSelectedDeviceIdx];
   SDRLG(extHw_MSG_DEBUG, "opening RTL device %u idx %u: %s",
     unsigned(RtlOpenDevice.dev_idx), unsigned(RtlSelectedDeviceIdx), RtlOpenDevice.name);
-  int r = rtlsdr_open(&RtlSdrDev, RtlOpenDevice.dev_idx);
-  if (r < 0)
+
+  rtlsdr_tuner t = RTLSDR_TUNER_UNKNOWN;
+  if (rtl_tcp_client_is_configured())
   {
-    SDRLG(extHw_MSG_ERROR, "opening RTL device failed: %d", r);
-    RtlOpenDevice.clear();
-    return false;
+    uint32_t tuner_type = 0, gain_count = 0;
+    if (!rtl_tcp_client_connect(tuner_type, gain_count))
+    {
+      RtlOpenDevice.clear();
+      return false;
+    }
+    t = (tuner_type < tuners::N) ? rtlsdr_tuner(tuner_type) : RTLSDR_TUNER_UNKNOWN;
+  }
+  else
+  {
+    int r = rtlsdr_open(&RtlSdrDev, RtlOpenDevice.dev_idx);
+    if (r < 0)
+    {
+      SDRLG(extHw_MSG_ERROR, "opening RTL device failed: %d", r);
+      RtlOpenDevice.clear();
+      return false;
+    }
+    SDRLG(extHw_MSG_DEBUG, "open_selected_rtl_device() -> handle 0x%p", RtlSdrDev);
+    t = rtlsdr_get_tuner_type(RtlSdrDev);
   }
-  SDRLG(extHw_MSG_DEBUG, "open_selected_rtl_device() -> handle 0x%p", RtlSdrDev);
 
-  rtlsdr_tuner t = rtlsdr_get_tuner_type(RtlSdrDev);
   if (tunerNo < tuners::N)
     SDRLG(extHw_MSG_DEBUG, "opened RTL device has tuner type %s", tuners::names[unsigned(t)]);
   else
@@ -273,6 +473,7 @@ bool open_selected_rtl_device()
 
   tunerNo = uint32_t(t);
   GotTunerInfo = true;
+  apply_device_profile(uint32_t(t));
 
   // update bandwidths
   bandwidths = tuners::bws[tunerNo].bw;
@@ -305,30 +506,214 @@ bool open_selected_rtl_device()
     last.if_gain_idx = nxt.if_gain_idx + 1;
   }
 
+  // the bands' gains resolve to this tuner's gains
+  band_switch_compile(tunerNo);
+
   commandEverything.store(true);
   Control_Changes();
   return GotTunerInfo;
 }
 
 
+static bool Control_Changes_remote()
+{
+  // same change detection as for USB - mapped onto rtl_tcp commands.
+  // the server applies them in order; there is no response
+  const auto t0 = std::chrono::steady_clock::now();
+  char acMsg[256];
+  CtrlFlagT changed = somewhat_changed.exchange(0);
+  const bool at_start = commandEverything.exchange(false);
+  const bool command_all = at_start || (changed & CtrlFlags::everything);
+  control_latency_pass(command_all, at_start);
+
+  SDRLG(extHw_MSG_DEBUG, "Control_Changes_remote(): %s changes 0x%x", command_all ? "ALL" : "", unsigned(changed));
+
+  // batched: the commands go out together - in one send
+  ControlCalls calls(control_batched.load() != 0);
+  auto send_cmd = [&calls](const char* name, uint8_t cmd, uint32_t param) {
+    calls.add(name);
+    return rtl_tcp_client_send_cmd(cmd, param);
+  };
+  if (calls.batched)
+    rtl_tcp_client_batch_begin();
+
+  if (last.sampling_mode != nxt.sampling_mode || command_all)
+  {
+    int tmp = nxt.sampling_mode;
+    if (send_cmd("SET_DIRECT_SAMPLING", rtl_tcp::SET_DIRECT_SAMPLING, uint32_t(tmp)))
+      last.sampling_mode = tmp;
+  }
+  if ((last.offset_tuning != nxt.offset_tuning || command_all) && !isR82XX())
+  {
+    int tmp = nxt.offset_tuning;
+    if (send_cmd("SET_OFFSET_TUNING", rtl_tcp::SET_OFFSET_TUNING, uint32_t(tmp)))
+      last.offset_tuning = tmp;
+  }
+  if (last.USB_sideband != nxt.USB_sideband || command_all)
+  {
+    int tmp = nxt.USB_sideband.load() ? 1 : 0;
+    if (send_cmd("SET_SIDEBAND", rtl_tcp::SET_SIDEBAND, uint32_t(tmp)))
+      last.USB_sideband = tmp;
+  }
+  for (int btnNo = 0; btnNo < int(NUM_GPIO_BUTTONS); ++btnNo)
+  {
+    if (GPIO_en[btnNo] && (last.GPIO[btnNo] != nxt.GPIO[btnNo] || command_all))
+    {
+      int tmp = nxt.GPIO[btnNo];
+      const int GPIOpin = GPIO_pin[btnNo];
+      const int GPIOval = tmp ^ GPIO_inv[btnNo];
+      bool ok;
+      if (GPIOpin < 0)
+        ok = send_cmd("SET_BIAS_TEE", rtl_tcp::SET_BIAS_TEE, uint32_t(GPIOval));
+      else
+      {
+        ok = send_cmd("GPIO_SET_OUTPUT_MODE", rtl_tcp::GPIO_SET_OUTPUT_MODE, uint32_t(GPIOpin));
+        ok = ok && send_cmd("GPIO_WRITE_PIN", rtl_tcp::GPIO_WRITE_PIN, (uint32_t(GPIOpin) << 16) | uint32_t(GPIOval));
+      }
+      if (ok)
+        last.GPIO[btnNo] = tmp;
+    }
+  }
+  if (last.freq_corr_ppm != nxt.freq_corr_ppm || command_all)
+  {
+    int tmp = nxt.freq_corr_ppm;
+    if (send_cmd("SET_FREQUENCY_CORRECTION", rtl_tcp::SET_FREQUENCY_CORRECTION, uint32_t(tmp)))
+    {
+      last.freq_corr_ppm = tmp;
+      store_device_ppm(tmp);
+    }
+  }
+  if (last.srate_idx != nxt.srate_idx || command_all)
+  {
+    int tmp = nxt.srate_idx;
+    if (send_cmd("SET_SAMPLE_RATE", rtl_tcp::SET_SAMPLE_RATE, uint32_t(rates::tab[tmp].valueInt)))
+      last.srate_idx = tmp;
+  }
+  if (last.band_center_sel != nxt.band_center_sel || last.srate_idx != nxt.srate_idx || command_all)
+  {
+    int fs = rates::tab[nxt.srate_idx].valueInt;
+    int tmp = nxt.band_center_sel;
+    int band_center = 0;
+    if (tmp == 1)
+      band_center = fs / 4;
+    else if (tmp == 2)
+      band_center = -fs / 4;
+    if (send_cmd("SET_TUNER_BW_IF_CENTER", rtl_tcp::SET_TUNER_BW_IF_CENTER, uint32_t(band_center)))
+    {
+      last.band_center_sel = tmp;
+      last.band_center_LO_delta.store(nxt.band_center_LO_delta.load());
+    }
+    changed |= CtrlFlags::freq;
+  }
+  const uint64_t f64 = uint64_t(nxt.LO_freq.load());
+  if (uint64_t(last.LO_freq.load()) != f64 || (changed & CtrlFlags::freq) || command_all)
+  {
+    bool ok = true;
+    if ((f64 >> 32) || command_all)
+      ok = send_cmd("SET_FREQ_HI32", rtl_tcp::SET_FREQ_HI32, uint32_t(f64 >> 32));
+    ok = ok && send_cmd("SET_FREQUENCY", rtl_tcp::SET_FREQUENCY, uint32_t(f64));
+    if (ok)
+    {
+      last.LO_freq.store(f64);
+      dc_avoid_LO_applied(int64_t(f64));
+    }
+  }
+  if ((last.tuner_bw != nxt.tuner_bw || command_all) && n_bandwidths)
+  {
+    int tmp = nxt.tuner_bw;
+    if (send_cmd("SET_TUNER_BANDWIDTH", rtl_tcp::SET_TUNER_BANDWIDTH, uint32_t(tmp * 1000)))
+      last.tuner_bw = tmp;
+  }
+  if (last.tuner_rf_agc != nxt.tuner_rf_agc || command_all)
+  {
+    int tmp = nxt.tuner_rf_agc;
+    if (send_cmd("SET_GAIN_MODE", rtl_tcp::SET_GAIN_MODE, uint32_t(1 - tmp)))
+    {
+      last.tuner_rf_agc = tmp;
+      if (tmp == 0)
+        last.rf_gain = nxt.rf_gain + 1;
+    }
+  }
+  if (last.rtl_agc != nxt.rtl_agc || command_all)
+  {
+    int tmp = nxt.rtl_agc;
+    if (send_cmd("SET_AGC_MODE", rtl_tcp::SET_AGC_MODE, uint32_t(tmp)))
+      last.rtl_agc = tmp;
+  }
+  if ((last.rf_gain != nxt.rf_gain || command_all) && nxt.tuner_rf_agc == 0)
+  {
+    int tmp = nxt.rf_gain;
+    if (send_cmd("SET_GAIN", rtl_tcp::SET_GAIN, uint32_t(tmp)))
+      last.rf_gain = tmp;
+  }
+  if ((last.tuner_if_agc != nxt.tuner_if_agc || last.if_gain_idx != nxt.if_gain_idx || command_all)
+    && isR82XX())
+  {
+    int tmp_agc = nxt.tuner_if_agc;
+    int tmp_gain = nxt.if_gain_idx;
+    if (send_cmd("SET_TUNER_IF_MODE", rtl_tcp::SET_TUNER_IF_MODE, tmp_agc ? 0U : uint32_t(10000 + tmp_gain)))
+    {
+      last.tuner_if_agc = tmp_agc;
+      last.if_gain_idx = tmp_gain;
+    }
+  }
+
+  // rtl_tcp has no commands for impulse noise cancellation and the aagc parameters
+  last.rtl_impulse_noise_cancellation = nxt.rtl_impulse_noise_cancellation.load();
+  // 'last' was updated for commands, which the server did not receive: send all again next time
+  const bool sent = !calls.batched || rtl_tcp_client_batch_end();
+  if (!sent)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Control_Changes_remote(): error sending the batch of commands");
+    commandEverything.store(true);
+  }
+  calls.flush("Control_Changes_remote", command_all);
+  record_timing(calls, command_all, t0);
+  return sent;
+}
+
+
+// Control_Changes() runs on the host's, GUI, sweep and rtl_tcp server threads:
+//   one at a time - for 'last' and the device
+std::mutex control_mtx;
+
 bool Control_Changes()
 {
+  std::lock_guard<std::mutex> lock(control_mtx);
+  static uint32_t gpio_output_pins = 0;   // pins in output mode - since the last command_all
   char acMsg[256];
+  // the samplerate qualification owns the device: changes stay queued in somewhat_changed
+  if (rate_qual_running())
+    return false;
   rtlsdr_dev_t* dev = RtlSdrDev;
+  if (!dev && rtl_tcp_client_is_connected())
+    return Control_Changes_remote();
   if (!dev)
     return false;
 
+  const auto t0 = std::chrono::steady_clock::now();
   CtrlFlagT changed = somewhat_changed.exchange(0);
-  const bool command_all = commandEverything.exchange(false) || (changed & CtrlFlags::everything);
+  const bool at_start = commandEverything.exchange(false);
+  const bool command_all = at_start || (changed & CtrlFlags::everything);
+  control_latency_pass(command_all, at_start);
 
   SDRLG(extHw_MSG_DEBUG, "Control_Changes(): %s changes 0x%x", command_all ? "ALL" : "", unsigned(changed));
 
+  // batched: one pass in dependency order - sampling mode, ppm, samplerate with the
+  //   rate dependent bandwidth and band center, then the frequency once.
+  //   values in effect are skipped, as are the reads only done for the debug log.
+  //   gain mode, gain and IF mode are re-applied after every samplerate change
+  ControlCalls calls(control_batched.load() != 0);
+  const bool srate_pending = (last.srate_idx != nxt.srate_idx || command_all);
+  if (command_all)
+    gpio_output_pins = 0;
+
   if (last.sampling_mode != nxt.sampling_mode || command_all)
   {
     int tmp = nxt.sampling_mode;
     // printf("set direct sampling %u (=%s)\n", tmp, (!tmp) ? "disabled" : (tmp == 1) ? "pin I-ADC" : (tmp == 2) ? "pin Q-ADC" : "unknown!");
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_direct_sampling()");
-    int r = rtlsdr_set_direct_sampling(dev, tmp);
+    calls.log("rtlsdr_set_direct_sampling()");
+    int r = calls.done(rtlsdr_set_direct_sampling(dev, tmp));
     if (r < 0)
       SDRLG(extHw_MSG_WARNING, "Error setting rtlsdr_set_direct_sampling(): %d", r);
     last.sampling_mode = tmp;
@@ -343,8 +728,8 @@ bool Control_Changes()
     }
     else
     {
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_offset_tuning()");
-      int r = rtlsdr_set_offset_tuning(dev, tmp);
+      calls.log("rtlsdr_set_offset_tuning()");
+      int r = calls.done(rtlsdr_set_offset_tuning(dev, tmp));
       if (r < 0)
         SDRLG(extHw_MSG_WARNING, "Error setting rtlsdr_set_offset_tuning(): %d", r);
     }
@@ -355,17 +740,17 @@ bool Control_Changes()
   {
     int tmp = nxt.USB_sideband.load() ? 1 : 0;
     // printf("set tuner sideband %d: %s sideband\n", tmp, (tmp ? "upper" : "lower"));
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_sideband()");
+    calls.log("rtlsdr_set_tuner_sideband()");
     int r = -1;
     for (int retry = 0; r < 0 && retry < N_TUNER_RETRIES; ++retry)  // retry!?!?!
-      r = rtlsdr_set_tuner_sideband(dev, tmp);
+      r = calls.done(rtlsdr_set_tuner_sideband(dev, tmp));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_sideband(): %d", r);
     else
       last.USB_sideband = tmp;
     clear_flag(changed, CtrlFlags::tuner_sideband);
   }
-  for (int btnNo = 0; btnNo < NUM_GPIO_BUTTONS; ++btnNo)
+  for (int btnNo = 0; btnNo < int(NUM_GPIO_BUTTONS); ++btnNo)
   {
     if (GPIO_en[btnNo] && (last.GPIO[btnNo] != nxt.GPIO[btnNo] || command_all))
     {
@@ -375,16 +760,22 @@ bool Control_Changes()
       if (GPIOpin < 0)
       {
         // printf("set bias T %u (%s)\n", tmp, tmp ? "on" : "off");
-        SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_bias_tee()");
-        r = rtlsdr_set_bias_tee(dev, GPIOval);  // SET_BIAS_TEE
+        calls.log("rtlsdr_set_bias_tee()");
+        r = calls.done(rtlsdr_set_bias_tee(dev, GPIOval));  // SET_BIAS_TEE
       }
       else
       {
         // transmitTcpCmd(conn, GPIO_WRITE_PIN, (GPIOpin << 16) | GPIOval); // GPIO_WRITE_PIN
         // printf("write %d to gpio %d\n", itmp & 0xffff, (itmp >> 16) & 0xffff);
-        SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_gpio_output() / rtlsdr_set_gpio_bit()");
-        r = rtlsdr_set_gpio_output(dev, uint8_t(GPIOpin));
-        r = rtlsdr_set_gpio_bit(dev, uint8_t(GPIOpin), GPIOval);
+        if (!calls.batched || !(gpio_output_pins & (1U << GPIOpin)))
+        {
+          calls.log("rtlsdr_set_gpio_output()");
+          r = calls.done(rtlsdr_set_gpio_output(dev, uint8_t(GPIOpin)));
+          if (r >= 0)
+            gpio_output_pins |= (1U << GPIOpin);
+        }
+        calls.log("rtlsdr_set_gpio_bit()");
+        r = calls.done(rtlsdr_set_gpio_bit(dev, uint8_t(GPIOpin), GPIOval));
       }
       last.GPIO[btnNo] = tmp;
     }
@@ -394,19 +785,22 @@ bool Control_Changes()
   {
     int tmp = nxt.freq_corr_ppm;
     // printf("set freq correction %d ppm\n", itmp);
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_freq_correction()");
+    calls.log("rtlsdr_set_freq_correction()");
     int r = 0;
-    int curr_ppm = rtlsdr_get_freq_correction(dev);
-    if (curr_ppm != tmp)
+    // batched: no query - librtlsdr returns -2 for an unchanged correction
+    if (calls.batched || rtlsdr_get_freq_correction(dev) != tmp)
     {
       r = rtlsdr_set_freq_correction(dev, tmp);
+      r = calls.done((r == -2) ? 0 : r);
       if (r < 0)
         SDRLG(extHw_MSG_WARNING, "Error setting rtlsdr_set_freq_correction(): %d", r);
     }
     last.freq_corr_ppm = tmp;
+    if (r >= 0)
+      store_device_ppm(tmp);
     clear_flag(changed, CtrlFlags::ppm_correction);
   }
-  if (last.band_center_sel != nxt.band_center_sel || command_all)
+  if ((last.band_center_sel != nxt.band_center_sel || command_all) && !(calls.batched && srate_pending))
   {
     int fs = rates::tab[nxt.srate_idx].valueInt;
     int tmp = nxt.band_center_sel;
@@ -417,8 +811,8 @@ bool Control_Changes()
       band_center = -fs / 4;
 
     // printf("set tuner band to IF frequency %i Hz from center\n", if_band_center_freq);
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_band_center()");
-    int r = rtlsdr_set_tuner_band_center(dev, band_center);
+    calls.log("rtlsdr_set_tuner_band_center()");
+    int r = calls.done(rtlsdr_set_tuner_band_center(dev, band_center));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_band_center(): %d", r);
     else
@@ -429,21 +823,31 @@ bool Control_Changes()
     clear_flag(changed, CtrlFlags::tuner_band_center);
     changed |= CtrlFlags::freq;
   }
-  const uint64_t f64 = uint64_t(nxt.LO_freq.load());
-  if (last.LO_freq.load() != f64 || (changed & CtrlFlags::freq) || command_all)
-  {
-    int prev_on, prev_counter;
-    rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter);
-    SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d)", prev_on, prev_counter);
+  auto command_freq = [&]() {
+    const uint64_t f64 = uint64_t(nxt.LO_freq.load());
+    if (uint64_t(last.LO_freq.load()) != f64 || (changed & CtrlFlags::freq) || command_all)
+    {
+      if (!calls.batched)
+      {
+        int prev_on, prev_counter;
+        rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter);
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d)", prev_on, prev_counter);
+      }
 
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_center_freq64()");
-    int r = rtlsdr_set_center_freq64(dev, f64);
-    if (r < 0)
-      SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_center_freq64(): %d", r);
-    else
-      last.LO_freq.store(f64);
-    clear_flag(changed, CtrlFlags::freq);
-  }
+      calls.log("rtlsdr_set_center_freq64()");
+      int r = calls.done(rtlsdr_set_center_freq64(dev, f64));
+      if (r < 0)
+        SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_center_freq64(): %d", r);
+      else
+      {
+        last.LO_freq.store(f64);
+        dc_avoid_LO_applied(int64_t(f64));
+      }
+      clear_flag(changed, CtrlFlags::freq);
+    }
+  };
+  if (!calls.batched)
+    command_freq();
   if (last.srate_idx != nxt.srate_idx || command_all)
   {
     // re-parametrize Tuner RF AGC
@@ -451,8 +855,8 @@ bool Control_Changes()
       int tmp = nxt.tuner_rf_agc;
       // transmitTcpCmd(conn, SET_GAIN_MODE, 1 - tmp);
       // printf("set gain mode %u (=%s)\n", tmp, tmp ? "manual" : "automatic");
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain_mode()");
-      int r = rtlsdr_set_tuner_gain_mode(dev, 1 - tmp);
+      calls.log("rtlsdr_set_tuner_gain_mode()");
+      int r = calls.done(rtlsdr_set_tuner_gain_mode(dev, 1 - tmp));
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain_mode(): %d", r);
       else
@@ -465,8 +869,8 @@ bool Control_Changes()
     {
       int tmp = nxt.rf_gain;
       // printf("set manual tuner gain %.1f dB\n", tmp / 10.0);
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain()");
-      int r = rtlsdr_set_tuner_gain(dev, tmp);  // SET_GAIN
+      calls.log("rtlsdr_set_tuner_gain()");
+      int r = calls.done(rtlsdr_set_tuner_gain(dev, tmp));  // SET_GAIN
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain(): %d", r);
       else
@@ -480,8 +884,8 @@ bool Control_Changes()
     }
     else if (nxt.tuner_if_agc)
     {
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode(0)");
-      int r = rtlsdr_set_tuner_if_mode(dev, 0);  // SET_TUNER_IF_MODE; 0 activates AGC
+      calls.log("rtlsdr_set_tuner_if_mode(0)");
+      int r = calls.done(rtlsdr_set_tuner_if_mode(dev, 0));  // SET_TUNER_IF_MODE; 0 activates AGC
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
@@ -494,8 +898,8 @@ bool Control_Changes()
     else
     {
       int tmp = nxt.if_gain_idx.load();
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode(10000+)");
-      int r = rtlsdr_set_tuner_if_mode(dev, 10000 + tmp);  // SET_TUNER_IF_MODE
+      calls.log("rtlsdr_set_tuner_if_mode(10000+)");
+      int r = calls.done(rtlsdr_set_tuner_if_mode(dev, 10000 + tmp));  // SET_TUNER_IF_MODE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
@@ -513,8 +917,8 @@ bool Control_Changes()
       if (n_bandwidths)
       {
         // SET_TUNER_BANDWIDTH
-        SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_and_get_tuner_bandwidth()");
-        rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */);
+        calls.log("rtlsdr_set_and_get_tuner_bandwidth()");
+        calls.done(rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */));
       }
       last.tuner_bw = tmp;
       clear_flag(changed, CtrlFlags::tuner_bandwidth);
@@ -523,8 +927,8 @@ bool Control_Changes()
     // re-parametrize samplerate
     {
       int tmp = nxt.srate_idx;
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_sample_rate()");
-      int r = rtlsdr_set_sample_rate(dev, rates::tab[tmp].valueInt);  // SET_SAMPLE_RATE
+      calls.log("rtlsdr_set_sample_rate()");
+      int r = calls.done(rtlsdr_set_sample_rate(dev, rates::tab[tmp].valueInt));  // SET_SAMPLE_RATE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_sample_rate(): %d", r);
       else
@@ -532,7 +936,8 @@ bool Control_Changes()
       clear_flag(changed, CtrlFlags::srate);
     }
 
-    if (last.band_center_sel != nxt.band_center_sel || command_all)
+    // the band center is fs/4: it follows the samplerate
+    if (last.band_center_sel != nxt.band_center_sel || command_all || (calls.batched && nxt.band_center_sel != 0))
     {
       int tmp_srate_idx = nxt.srate_idx;
       int tmp_bcsel = nxt.band_center_sel;
@@ -543,15 +948,21 @@ bool Control_Changes()
       else if (tmp_bcsel == 2)
         band_center = -fs / 4;
 
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_band_center()");
-      int r = rtlsdr_set_tuner_band_center(dev, band_center);  // SET_TUNER_BW_IF_CENTER
+      calls.log("rtlsdr_set_tuner_band_center()");
+      int r = calls.done(rtlsdr_set_tuner_band_center(dev, band_center));  // SET_TUNER_BW_IF_CENTER
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_band_center(): %d", r);
       else
+      {
         last.band_center_sel = tmp_bcsel;
+        last.band_center_LO_delta.store(nxt.band_center_LO_delta.load());
+      }
       clear_flag(changed, CtrlFlags::tuner_band_center);
+      changed |= CtrlFlags::freq;
     }
   }
+  if (calls.batched)
+    command_freq();
 
   if (last.tuner_bw != nxt.tuner_bw)
   {
@@ -559,10 +970,10 @@ bool Control_Changes()
     //  return false;
     int tmp = nxt.tuner_bw;
     uint32_t applied_bw = 0;  // SET_TUNER_BANDWIDTH
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_and_get_tuner_bandwidth()");
+    calls.log("rtlsdr_set_and_get_tuner_bandwidth()");
     int r = 1;
     for (int retry = 0; r && retry < N_TUNER_RETRIES; ++retry )  // retry!?!?!
-      r = rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */);
+      r = calls.done(rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */));
     SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_and_get_tuner_bandwidth(%d) -> bw %u, rc %d",
       tmp * 1000, unsigned(applied_bw), r);
     last.tuner_bw = tmp;
@@ -573,8 +984,8 @@ bool Control_Changes()
   {
     int tmp = nxt.tuner_rf_agc;
     int tmp_gain = nxt.rf_gain;
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain_mode()");
-    int r = rtlsdr_set_tuner_gain_mode(dev, 1 - tmp);
+    calls.log("rtlsdr_set_tuner_gain_mode()");
+    int r = calls.done(rtlsdr_set_tuner_gain_mode(dev, 1 - tmp));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain_mode(): %d", r);
     else
@@ -590,8 +1001,8 @@ bool Control_Changes()
   {
     int tmp = nxt.rtl_agc;
     // printf("set rtl2832's digital agc mode %d (=%s)\n", tmp, tmp ? "enabled" : "disabled");
-    SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_agc_mode()");
-    int r = rtlsdr_set_agc_mode(dev, tmp);  // SET_AGC_MODE
+    calls.log("rtlsdr_set_agc_mode()");
+    int r = calls.done(rtlsdr_set_agc_mode(dev, tmp));  // SET_AGC_MODE
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_agc_mode(): %d", r);
     else
@@ -606,8 +1017,8 @@ bool Control_Changes()
     {
       // transmit manual gain only when TunerAGC is off
       // printf("set manual tuner gain %.1f dB\n", tmp / 10.0);
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain()");
-      int r = rtlsdr_set_tuner_gain(dev, tmp);  // SET_GAIN
+      calls.log("rtlsdr_set_tuner_gain()");
+      int r = calls.done(rtlsdr_set_tuner_gain(dev, tmp));  // SET_GAIN
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain(): %d", r);
       else
@@ -626,8 +1037,8 @@ bool Control_Changes()
     }
     else if (tmp_agc)
     {
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode()");
-      int r = rtlsdr_set_tuner_if_mode(dev, 0);  // SET_TUNER_IF_MODE
+      calls.log("rtlsdr_set_tuner_if_mode()");
+      int r = calls.done(rtlsdr_set_tuner_if_mode(dev, 0));  // SET_TUNER_IF_MODE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
@@ -639,8 +1050,8 @@ bool Control_Changes()
     }
     else
     {
-      SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode()");
-      int r = rtlsdr_set_tuner_if_mode(dev, 10000 + tmp_gain);  // SET_TUNER_IF_MODE
+      calls.log("rtlsdr_set_tuner_if_mode()");
+      int r = calls.done(rtlsdr_set_tuner_if_mode(dev, 10000 + tmp_gain));  // SET_TUNER_IF_MODE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
@@ -658,12 +1069,15 @@ bool Control_Changes()
     int tmp = nxt.rtl_impulse_noise_cancellation;
     if (tmp == 0 || tmp == 1)
     {
-      int prev_on, prev_counter;
-      rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter);
-      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d", prev_on, prev_counter);
-
-      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_impulse_nc(%d)", tmp);
-      int r = rtlsdr_set_impulse_nc(dev, tmp, tmp);
+      if (!calls.batched)
+      {
+        int prev_on, prev_counter;
+        rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter);
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d", prev_on, prev_counter);
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_impulse_nc(%d)", tmp);
+      }
+      calls.add("rtlsdr_set_impulse_nc()");
+      int r = calls.done(rtlsdr_set_impulse_nc(dev, tmp, tmp));
       if (r)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_impulse_nc(): %d", r);
     }
@@ -696,47 +1110,63 @@ bool Control_Changes()
     unsigned tLGLck = nxt.rtl_aagc_lg_lock;
     unsigned tLGUck = nxt.rtl_aagc_lg_unlock;
     unsigned tLGIfr = nxt.rtl_aagc_lg_ifr;
+    // all unset: the device's defaults are in effect - commanded once, when they were set before
+    const bool any_set = tRfEn < 2 || tRfInv < 2 || tRfMin < 256U || tRfMax < 256U
+      || tIfEn < 2 || tIfInv < 2 || tIfMin < 256U || tIfMax < 256U
+      || tLGLck < 32U || tLGUck < 32U || tLGIfr < 32U;
+    const bool last_any_set = unsigned(last.rtl_aagc_rf_en) < 2 || unsigned(last.rtl_aagc_rf_inv) < 2
+      || unsigned(last.rtl_aagc_rf_min) < 256U || unsigned(last.rtl_aagc_rf_max) < 256U
+      || unsigned(last.rtl_aagc_if_en) < 2 || unsigned(last.rtl_aagc_if_inv) < 2
+      || unsigned(last.rtl_aagc_if_min) < 256U || unsigned(last.rtl_aagc_if_max) < 256U
+      || unsigned(last.rtl_aagc_lg_lock) < 32U || unsigned(last.rtl_aagc_lg_unlock) < 32U
+      || unsigned(last.rtl_aagc_lg_ifr) < 32U;
+    if (!calls.batched || any_set || last_any_set)
     {
-      int prev_en_rf, prev_inv_rf, prev_rf_min, prev_rf_max;
-      int prev_en_if, prev_inv_if, prev_if_min, prev_if_max;
-      int prev_gain_lock, prev_gain_unlock, prev_gain_interference;
-      rtlsdr_get_aagc(dev,
-        &prev_en_rf, &prev_inv_rf, &prev_rf_min, &prev_rf_max,
-        &prev_en_if, &prev_inv_if, &prev_if_min, &prev_if_max,
-        &prev_gain_lock, &prev_gain_unlock, &prev_gain_interference);
-      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_aagc()\n"
-        "  -> RF: en %d, inv %d, %d - %d\n"
-        "  -> IF: en %d, inv %d, %d - %d\n"
-        "  -> loop: lock %d, unlock %d, interference %d",
-        prev_en_rf, prev_inv_rf, prev_rf_min, prev_rf_max,
-        prev_en_if, prev_inv_if, prev_if_min, prev_if_max,
-        prev_gain_lock, prev_gain_unlock, prev_gain_interference);
-
-      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_aagc(\n"
-        "  RF: en %d, inv %d, %d - %d,\n"
-        "  IF: en %d, inv %d, %d - %d,\n"
-        "  loop gain: lock %d, unlock %d, interference %d )",
-        tRfEn, tRfInv, tRfMin, tRfMax,
-        tIfEn, tIfInv, tIfMin, tIfMax,
-        tLGLck, tLGUck, tLGIfr);
-      int r = rtlsdr_set_aagc(dev,
+      if (!calls.batched)
+      {
+        int prev_en_rf, prev_inv_rf, prev_rf_min, prev_rf_max;
+        int prev_en_if, prev_inv_if, prev_if_min, prev_if_max;
+        int prev_gain_lock, prev_gain_unlock, prev_gain_interference;
+        rtlsdr_get_aagc(dev,
+          &prev_en_rf, &prev_inv_rf, &prev_rf_min, &prev_rf_max,
+          &prev_en_if, &prev_inv_if, &prev_if_min, &prev_if_max,
+          &prev_gain_lock, &prev_gain_unlock, &prev_gain_interference);
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_aagc()\n"
+          "  -> RF: en %d, inv %d, %d - %d\n"
+          "  -> IF: en %d, inv %d, %d - %d\n"
+          "  -> loop: lock %d, unlock %d, interference %d",
+          prev_en_rf, prev_inv_rf, prev_rf_min, prev_rf_max,
+          prev_en_if, prev_inv_if, prev_if_min, prev_if_max,
+          prev_gain_lock, prev_gain_unlock, prev_gain_interference);
+
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_aagc(\n"
+          "  RF: en %d, inv %d, %d - %d,\n"
+          "  IF: en %d, inv %d, %d - %d,\n"
+          "  loop gain: lock %d, unlock %d, interference %d )",
+          tRfEn, tRfInv, tRfMin, tRfMax,
+          tIfEn, tIfInv, tIfMin, tIfMax,
+          tLGLck, tLGUck, tLGIfr);
+      }
+      calls.add("rtlsdr_set_aagc()");
+      int r = calls.done(rtlsdr_set_aagc(dev,
         tRfEn, tRfInv, tRfMin, tRfMax,
         tIfEn, tIfInv, tIfMin, tIfMax,
-        tLGLck, tLGUck, tLGIfr);
+        tLGLck, tLGUck, tLGIfr));
       if (r)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_aagc(): %d", r);
     }
-    if (tRfEn < 2)      last.rtl_aagc_rf_en = tRfEn;
-    if (tRfInv < 2)     last.rtl_aagc_rf_inv = tRfInv;
-    if (tRfMin < 256U)  last.rtl_aagc_rf_min = tRfMin;
-    if (tRfMax < 256U)  last.rtl_aagc_rf_max = tRfMax;
-    if (tIfEn < 2)      last.rtl_aagc_if_en = tIfEn;
-    if (tIfInv < 2)     last.rtl_aagc_if_inv = tIfInv;
-    if (tIfMin < 256U)  last.rtl_aagc_if_min = tIfMin;
-    if (tIfMax < 256U)  last.rtl_aagc_if_max = tIfMax;
-    if (tLGLck < 32U)   last.rtl_aagc_lg_lock = tLGLck;
-    if (tLGUck < 32U)   last.rtl_aagc_lg_unlock = tLGUck;
-    if (tLGIfr < 32U)   last.rtl_aagc_lg_ifr  = tLGIfr;
+    // unset values, too: else the comparison above never converges
+    last.rtl_aagc_rf_en = int(tRfEn);
+    last.rtl_aagc_rf_inv = int(tRfInv);
+    last.rtl_aagc_rf_min = int(tRfMin);
+    last.rtl_aagc_rf_max = int(tRfMax);
+    last.rtl_aagc_if_en = int(tIfEn);
+    last.rtl_aagc_if_inv = int(tIfInv);
+    last.rtl_aagc_if_min = int(tIfMin);
+    last.rtl_aagc_if_max = int(tIfMax);
+    last.rtl_aagc_lg_lock = int(tLGLck);
+    last.rtl_aagc_lg_unlock = int(tLGUck);
+    last.rtl_aagc_lg_ifr = int(tLGIfr);
   }
 
   if (last.rtl_aagc_vtop[0] != nxt.rtl_aagc_vtop[0]
@@ -750,19 +1180,30 @@ bool Control_Changes()
   {
     int vtop[3] = { nxt.rtl_aagc_vtop[0], nxt.rtl_aagc_vtop[1], nxt.rtl_aagc_vtop[2] };
     int krf[4] = { nxt.rtl_aagc_krf[0], nxt.rtl_aagc_krf[1], nxt.rtl_aagc_krf[2], nxt.rtl_aagc_krf[3] };
+    const bool any_set = vtop[0] >= 0 || vtop[1] >= 0 || vtop[2] >= 0
+      || krf[0] >= 0 || krf[1] >= 0 || krf[2] >= 0 || krf[3] >= 0;
+    const bool last_any_set = last.rtl_aagc_vtop[0] >= 0 || last.rtl_aagc_vtop[1] >= 0 || last.rtl_aagc_vtop[2] >= 0
+      || last.rtl_aagc_krf[0] >= 0 || last.rtl_aagc_krf[1] >= 0 || last.rtl_aagc_krf[2] >= 0 || last.rtl_aagc_krf[3] >= 0;
 
-    int prev_vtop[3], prev_krf[4];
-    rtlsdr_get_aagc_gain_distrib(dev, prev_vtop, prev_krf);
-    SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_agc_gain_distrib() -> vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d",
-      prev_vtop[0], prev_vtop[1], prev_vtop[2],
-      prev_krf[0], prev_krf[1], prev_krf[2], prev_krf[3]);
-
-    SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_agc_gain_distrib(vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d)",
-      vtop[0], vtop[1], vtop[2],
-      krf[0], krf[1], krf[2], krf[3]);
-      int r = rtlsdr_set_aagc_gain_distrib(dev, vtop, krf);
+    if (!calls.batched)
+    {
+      int prev_vtop[3], prev_krf[4];
+      rtlsdr_get_aagc_gain_distrib(dev, prev_vtop, prev_krf);
+      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_agc_gain_distrib() -> vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d",
+        prev_vtop[0], prev_vtop[1], prev_vtop[2],
+        prev_krf[0], prev_krf[1], prev_krf[2], prev_krf[3]);
+
+      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_agc_gain_distrib(vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d)",
+        vtop[0], vtop[1], vtop[2],
+        krf[0], krf[1], krf[2], krf[3]);
+    }
+    if (!calls.batched || any_set || last_any_set)
+    {
+      calls.add("rtlsdr_set_aagc_gain_distrib()");
+      int r = calls.done(rtlsdr_set_aagc_gain_distrib(dev, vtop, krf));
       if (r)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_agc_gain_distrib(): %d", r);
+    }
 
     last.rtl_aagc_vtop[0] = vtop[0];
     last.rtl_aagc_vtop[1] = vtop[1];
@@ -773,5 +1214,8 @@ bool Control_Changes()
     last.rtl_aagc_krf[3] = krf[3];
   }
 
+
+  calls.flush("Control_Changes", command_all);
+  record_timing(calls, command_all, t0);
   return true;
 }
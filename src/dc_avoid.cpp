@@ -0,0 +1,142 @@
+
+#include "dc_avoid.h"
+#include "lo_chain.h"
+#include "zoom_ddc.h"
+#include "resampler.h"
+#include "dsp.h"
+#include "control.h"
+#include "rates.h"
+
+#include <cmath>
+#include <mutex>
+
+
+#define CONVERT_CHUNK   256     // samples per fused conversion step
+
+
+std::atomic_int dc_avoid_enabled = 0;
+std::atomic_int dc_avoid_offset = 150000;
+
+static std::atomic_int64_t base_LO = 0;     // host's LO
+static std::atomic_int64_t cur_offset = 0;  // tuner's LO - host's LO
+
+// the last LO for the tuner - with its offset: commanded later by Control_Changes()
+static std::mutex pair_mtx;
+static int64_t pair_hw_LO = 0, pair_offset = 0;
+static std::atomic_int64_t tuned_offset = 0;  // offset of last.LO_freq
+
+// only accessed from RtlSdrCallback()
+static NCO nco;
+
+
+static int64_t keep_pair(int64_t host_LO, int64_t d)
+{
+  std::lock_guard<std::mutex> lock(pair_mtx);
+  pair_hw_LO = host_LO + d;
+  pair_offset = d;
+  return host_LO + d;
+}
+
+int64_t dc_avoid_LO(int64_t host_LO, int64_t tune_freq)
+{
+  base_LO = host_LO;
+  if (!dc_avoid_enabled.load() || nxt.sampling_mode.load())
+  {
+    // direct sampling: no tuner, no spur to avoid
+    cur_offset = 0;
+    return keep_pair(host_LO, 0);
+  }
+
+  // keep the spur at host_LO + offset at least offset / 2 away from the signal
+  const int64_t off = dc_avoid_offset.load();
+  int64_t d = cur_offset.load();
+  if (d != off && d != -off)
+    d = off;
+  const int64_t sig = tune_freq ? tune_freq : host_LO;
+  const int64_t dist = sig - (host_LO + d);
+  if (dist > -off / 2 && dist < off / 2)
+    d = -d;
+  cur_offset = d;
+  return keep_pair(host_LO, d);
+}
+
+int64_t dc_avoid_host_LO(int64_t hw_LO)
+{
+  return cur_offset.load() ? base_LO.load() : hw_LO;
+}
+
+void dc_avoid_tune_changed(int64_t tune_freq)
+{
+  if (!dc_avoid_enabled.load())
+    return;
+  if (set_hw_LO_from_host(host_LO_from_hw(nxt.LO_freq.load()), tune_freq))
+    trigger_control(CtrlFlags::freq);
+}
+
+void dc_avoid_configure(int enabled, int offset)
+{
+  const int64_t host_LO = host_LO_from_hw(nxt.LO_freq.load());
+  dc_avoid_enabled = enabled;
+  dc_avoid_offset = offset;
+  if (set_hw_LO_from_host(host_LO, nxt.tune_freq.load()))
+    trigger_control(CtrlFlags::freq);
+}
+
+
+void dc_avoid_LO_applied(int64_t hw_LO)
+{
+  // an LO from elsewhere - e.g. a client of the rtl_tcp server - has no offset
+  std::lock_guard<std::mutex> lock(pair_mtx);
+  tuned_offset = (hw_LO == pair_hw_LO) ? pair_offset : 0;
+}
+
+int64_t dc_avoid_tuned_offset()
+{
+  return tuned_offset.load(std::memory_order_relaxed);
+}
+
+bool dc_avoid_active()
+{
+  return cur_offset.load(std::memory_order_relaxed) != 0 && !zoom_active() && !resample_active();
+}
+
+void dc_avoid_convert(const uint8_t* buf, uint32_t len, void* out, bool pcm16)
+{
+  // shift up by the offset, which is really tuned
+  const int srate = rates::tab[last.srate_idx].valueInt;
+  nco.set_freq(double(dc_avoid_tuned_offset()) / srate);
+
+  float re[CONVERT_CHUNK], im[CONVERT_CHUNK];
+  const uint32_t n_pairs = len / 2;
+  for (uint32_t k0 = 0; k0 < n_pairs; k0 += CONVERT_CHUNK)
+  {
+    const unsigned m = (n_pairs - k0 < CONVERT_CHUNK) ? unsigned(n_pairs - k0) : CONVERT_CHUNK;
+    const uint8_t* p = buf + 2 * size_t(k0);
+    for (unsigned k = 0; k < m; ++k)
+    {
+      re[k] = float(p[2 * k]) - 127.5F;
+      im[k] = float(p[2 * k + 1]) - 127.5F;
+    }
+    nco.mix(re, im, re, im, m);
+    if (pcm16)
+    {
+      // same scale as the unshifted 16 bit samples
+      int16_t* o = (int16_t*)out + 2 * size_t(k0);
+      for (unsigned k = 0; k < m; ++k)
+      {
+        o[2 * k] = int16_t(std::lrint(re[k]));
+        o[2 * k + 1] = int16_t(std::lrint(im[k]));
+      }
+    }
+    else
+    {
+      uint8_t* o = (uint8_t*)out + 2 * size_t(k0);
+      for (unsigned k = 0; k < m; ++k)
+      {
+        const float vr = re[k] + 127.5F, vi = im[k] + 127.5F;
+        o[2 * k] = uint8_t(std::lrint(vr < 0.0F ? 0.0F : vr > 255.0F ? 255.0F : vr));
+        o[2 * k + 1] = uint8_t(std::lrint(vi < 0.0F ? 0.0F : vi > 255.0F ? 255.0F : vi));
+      }
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// software DC avoidance - for every tuner type:
+//   the tuner's LO is placed at an offset from the host's LO, away from the
+//   tune frequency. an NCO, fused into the conversion of the samples for the host,
+//   shifts the spectrum back. so the host's spectrum is centered at its LO,
+//   but the DC spur is offset by dc_avoid_offset - to the side away from the signal.
+// with zoom or resampler active, their NCO compensates the offset.
+
+extern std::atomic_int dc_avoid_enabled;
+extern std::atomic_int dc_avoid_offset;     // in Hz: 10000 .. 1000000
+
+// LO for the tuner from the host's LO - keeping the DC spur away from tune_freq
+int64_t dc_avoid_LO(int64_t host_LO, int64_t tune_freq);
+// host's LO from the tuner's LO
+int64_t dc_avoid_host_LO(int64_t hw_LO);
+// TuneChanged(): moves the DC spur to the other side, when it would hit the signal
+void dc_avoid_tune_changed(int64_t tune_freq);
+// setting changes: retunes with the new offset
+void dc_avoid_configure(int enabled, int offset);
+
+// Control_Changes(): hw_LO is tuned - its offset becomes the tuned offset
+void dc_avoid_LO_applied(int64_t hw_LO);
+// offset of the tuned LO from the host's LO - for the NCO of a decimating stream
+int64_t dc_avoid_tuned_offset();
+
+// called from RtlSdrCallback() - without zoom or resampler: true when the samples need the back-shift
+bool dc_avoid_active();
+// convert len bytes of 8 bit I/Q into out - 8 bit or 16 bit -
+//   shifting the spectrum back by the LO offset
+void dc_avoid_convert(const uint8_t* buf, uint32_t len, void* out, bool pcm16);
@@ -0,0 +1,155 @@
+
+#include "device_profile.h"
+#include "config_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+
+static const char* profiles_fn = "rtl_sdr_extio_devices.txt";
+
+static std::mutex mtx;
+static bool loaded = false;
+static bool dirty = false;    // changes, not yet written
+static std::map<std::string, DeviceProfile> profiles;
+
+
+static void parse_pair(DeviceProfile& p, const char* key, const char* value)
+{
+  const int v = atoi(value);
+  if (!strcmp(key, "tuner_type"))
+    p.tuner_type = v;
+  else if (!strcmp(key, "freq_corr_ppm"))
+    p.freq_corr_ppm = v;
+  else if (!strcmp(key, "usb_srate"))
+    p.usb_srate = v;
+  else if (!strcmp(key, "usb_buf_num"))
+    p.usb_buf_num = v;
+  else if (!strcmp(key, "usb_buf_len"))
+    p.usb_buf_len = v;
+  else if (!strcmp(key, "max_srate"))
+    p.max_srate = v;
+  else if (!strcmp(key, "max_srate_host"))
+    p.max_srate_host = value;
+  // unknown keys: from a newer version - ignored
+}
+
+static void load()
+{
+  loaded = true;
+  const std::string fn = get_user_profile_path(profiles_fn);
+  FILE* f = fopen(fn.c_str(), "r");
+  if (!f)
+    return;
+
+  char line[1024];
+  while (fgets(line, sizeof(line), f))
+  {
+    line[strcspn(line, "\r\n")] = 0;
+    char* tab = strchr(line, '\t');
+    if (!tab || tab == line)
+      continue;
+    *tab = 0;
+    DeviceProfile& p = profiles[line];
+    for (char* kv = tab + 1; kv && *kv; )
+    {
+      char* next = strchr(kv, '\t');
+      if (next)
+        *next++ = 0;
+      char* eq = strchr(kv, '=');
+      if (eq)
+      {
+        *eq = 0;
+        parse_pair(p, kv, eq + 1);
+      }
+      kv = next;
+    }
+  }
+  fclose(f);
+}
+
+static void save()
+{
+  const std::string fn = get_user_profile_path(profiles_fn);
+  FILE* f = fopen(fn.c_str(), "w");
+  if (!f)
+    return;
+  for (const auto& [serial, p] : profiles)
+  {
+    fprintf(f, "%s", serial.c_str());
+    if (p.tuner_type >= 0)
+      fprintf(f, "\ttuner_type=%d", p.tuner_type);
+    if (p.freq_corr_ppm)
+      fprintf(f, "\tfreq_corr_ppm=%d", *p.freq_corr_ppm);
+    if (p.usb_srate)
+      fprintf(f, "\tusb_srate=%d\tusb_buf_num=%d\tusb_buf_len=%d", p.usb_srate, p.usb_buf_num, p.usb_buf_len);
+    if (p.max_srate)
+      fprintf(f, "\tmax_srate=%d\tmax_srate_host=%s", p.max_srate, p.max_srate_host.c_str());
+    fprintf(f, "\n");
+  }
+  fclose(f);
+}
+
+
+bool device_profile_get(const char* serial, DeviceProfile& p)
+{
+  if (!serial || !serial[0])
+    return false;
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!loaded)
+    load();
+  const auto it = profiles.find(serial);
+  if (it == profiles.end())
+    return false;
+  p = it->second;
+  return true;
+}
+
+static bool store(const char* serial, const DeviceProfile& p)
+{
+  // serials with tabs or line breaks would break the file format
+  if (!serial || !serial[0] || strpbrk(serial, "\t\r\n"))
+    return false;
+  if (!loaded)
+    load();
+  profiles[serial] = p;
+  return true;
+}
+
+bool device_profile_set(const char* serial, const DeviceProfile& p)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!store(serial, p))
+    return false;
+  save();
+  dirty = false;
+  return true;
+}
+
+bool device_profile_update(const char* serial, const DeviceProfile& p)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!store(serial, p))
+    return false;
+  dirty = true;
+  return true;
+}
+
+void device_profile_flush()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!dirty)
+    return;
+  save();
+  dirty = false;
+}
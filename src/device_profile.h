@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <optional>
+
+// per-device profiles: measured or calibrated data of a dongle - keyed by its USB serial.
+// kept in the file 'rtl_sdr_extio_devices.txt' in the user's profile directory,
+//   one line per device: the serial, followed by tab separated key=value pairs
+//   - only for the known values. the file is read with the first access.
+// open_selected_rtl_device() applies a profile in one batch with the other
+//   settings. the tuner type guards against dongles sharing a serial - as
+//   the default '00000001': give them unique serials, e.g. with rtl_eeprom.
+
+struct DeviceProfile
+{
+  // tuner type: selects the gain and bandwidth tables in tuners::
+  int tuner_type = -1;    // -1: unknown
+  // last frequency correction applied to the device
+  std::optional<int> freq_corr_ppm;
+
+  // USB transfers - from usb_calib
+  int usb_srate = 0;      // samplerate of the calibration. 0: not calibrated
+  int usb_buf_num = 0;    // number of transfers
+  int usb_buf_len = 0;    // transfer size in bytes
+
+  // samplerate qualification - from rate_qual
+  int max_srate = 0;      // highest loss-free samplerate. 0: not qualified
+  std::string max_srate_host;   // computer's name of the qualification
+};
+
+// false, when there is no profile for serial
+bool device_profile_get(const char* serial, DeviceProfile& p);
+// stores the profile for serial and writes the file.
+//   false for an empty serial or one with tabs or line breaks: not stored
+bool device_profile_set(const char* serial, const DeviceProfile& p);
+// stores the profile for serial - the file is written with device_profile_flush().
+//   for frequent changes, e.g. the ppm from Control_Changes()
+bool device_profile_update(const char* serial, const DeviceProfile& p);
+// writes the file, when there are updates: StopHW(), CloseHW() and closing the device
+void device_profile_flush();
@@ -0,0 +1,92 @@
+
+#include "ds_hilbert.h"
+#include "dsp.h"
+#include "control.h"
+#include "rates.h"
+
+#include <vector>
+
+
+
+std::atomic_int ds_hilbert_enabled = 0;
+
+// only accessed from RtlSdrCallback()
+static HilbertDecimator hilbert;
+static bool need_reset = true;
+static SampleFormat cur_fmt = SAMPLE_U8;
+static std::vector<float> work_x, work_re, work_im;
+static std::vector<uint8_t> out_buf[2];
+static unsigned out_idx = 0;
+static unsigned out_fill = 0;   // I/Q pairs
+
+
+bool ds_hilbert_active()
+{
+  return ds_hilbert_enabled.load() && nxt.sampling_mode.load() != 0;
+}
+
+int ds_hilbert_decimation()
+{
+  return ds_hilbert_active() ? 2 : 1;
+}
+
+int64_t ds_hilbert_host_LO(int64_t hw_LO)
+{
+  return ds_hilbert_active() ? hw_LO + rates::tab[nxt.srate_idx].valueInt / 4 : hw_LO;
+}
+
+int64_t ds_hilbert_hw_LO(int64_t host_LO)
+{
+  return ds_hilbert_active() ? host_LO - rates::tab[nxt.srate_idx].valueInt / 4 : host_LO;
+}
+
+
+void ds_hilbert_reset()
+{
+  need_reset = true;
+}
+
+const void* ds_hilbert_feed(const uint8_t* buf, uint32_t len, SampleFormat fmt)
+{
+  const unsigned n_pairs = len / 2;
+  if (need_reset || fmt != cur_fmt || work_x.size() != n_pairs)
+  {
+    need_reset = false;
+    cur_fmt = fmt;
+    hilbert.reset();
+    work_x.resize(n_pairs);
+    work_re.resize(n_pairs / 2);
+    work_im.resize(n_pairs / 2);
+    out_buf[0].resize(size_t(n_pairs) * dsp_sample_pair_size(fmt));
+    out_buf[1].resize(size_t(n_pairs) * dsp_sample_pair_size(fmt));
+    out_idx = 0;
+    out_fill = 0;
+  }
+
+  // the active branch: I in mode 1, Q in mode 2
+  const uint8_t* p = buf + ((last.sampling_mode.load() == 2) ? 1 : 0);
+  float* x = work_x.data();
+  for (unsigned k = 0; k < n_pairs; ++k)
+    x[k] = (float(p[2 * k]) - 127.5F) * (1.0F / 127.5F);
+  float* re = work_re.data();
+  float* im = work_im.data();
+  const unsigned n = hilbert.process(x, n_pairs & ~1U, re, im);
+
+  // collect into host blocks of n_pairs
+  const void* complete = nullptr;
+  const float pcm16_scale = dsp_pcm16_scale(2);
+  for (unsigned k = 0; k < n; )
+  {
+    const unsigned c = (n - k < n_pairs - out_fill) ? (n - k) : (n_pairs - out_fill);
+    dsp_store_samples(re + k, im + k, c, out_buf[out_idx].data(), out_fill, fmt, pcm16_scale);
+    k += c;
+    out_fill += c;
+    if (out_fill == n_pairs)
+    {
+      complete = out_buf[out_idx].data();
+      out_idx ^= 1;
+      out_fill = 0;
+    }
+  }
+  return complete;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "dsp.h"
+
+// direct sampling: real-to-complex conversion of the active ADC branch.
+// in direct sampling modes 1 (I) and 2 (Q), only one byte of each I/Q pair carries signal.
+// this branch is mixed by -samplerate/4, filtered with a half-band Hilbert filter
+//   and decimated by 2: the host gets complex baseband at samplerate / 2 - without mirror.
+//   the host's LO is the tuner's LO + samplerate / 4.
+// the host's block size is kept: one host block over 2 USB blocks.
+// zoom and DC avoidance are not applied to this stream.
+
+extern std::atomic_int ds_hilbert_enabled;    // 0: pass I/Q unchanged, 1: convert in direct sampling modes
+
+// direct sampling mode with conversion selected
+bool ds_hilbert_active();
+// 2 when active, else 1
+int ds_hilbert_decimation();
+
+// host's LO from the tuner's LO - and back
+int64_t ds_hilbert_host_LO(int64_t hw_LO);
+int64_t ds_hilbert_hw_LO(int64_t host_LO);
+
+// called from RtlSdrCallback(): returns a complete host block of len / 2 I/Q pairs
+//   in format fmt - or nullptr, while collecting
+const void* ds_hilbert_feed(const uint8_t* buf, uint32_t len, SampleFormat fmt);
+void ds_hilbert_reset();
@@ -0,0 +1,331 @@
+
+#include "dsp.h"
+
+#include <string.h>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSP_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define NCO_RESYNC        256     // samples between exact NCO phasors
+#define HALFBAND_LEN      47      // 4 K + 3 taps
+
+static const double PI = 3.14159265358979323846;
+
+
+void NCO::set_freq(double f)
+{
+  f_norm = f;
+  w = 2.0 * PI * f;
+}
+
+void NCO::mix(const float* in_re, const float* in_im, float* out_re, float* out_im, unsigned n)
+{
+  for (unsigned k0 = 0; k0 < n; k0 += NCO_RESYNC)
+  {
+    const unsigned m = (n - k0 < NCO_RESYNC) ? (n - k0) : NCO_RESYNC;
+    // exact phasors for 4 consecutive samples, then rotate by 4 samples
+    float pr[4], pi[4];
+    for (unsigned q = 0; q < 4; ++q)
+    {
+      pr[q] = float(cos(phase + w * q));
+      pi[q] = float(sin(phase + w * q));
+    }
+    const float sr = float(cos(4.0 * w)), si = float(sin(4.0 * w));
+    const float* a = in_re + k0;
+    const float* b = in_im + k0;
+    float* yr = out_re + k0;
+    float* yi = out_im + k0;
+    unsigned k = 0;
+#ifdef DSP_USE_SSE2
+    __m128 vpr = _mm_loadu_ps(pr), vpi = _mm_loadu_ps(pi);
+    const __m128 vsr = _mm_set1_ps(sr), vsi = _mm_set1_ps(si);
+    for (; k + 4 <= m; k += 4)
+    {
+      const __m128 xa = _mm_loadu_ps(a + k);
+      const __m128 xb = _mm_loadu_ps(b + k);
+      _mm_storeu_ps(yr + k, _mm_sub_ps(_mm_mul_ps(xa, vpr), _mm_mul_ps(xb, vpi)));
+      _mm_storeu_ps(yi + k, _mm_add_ps(_mm_mul_ps(xa, vpi), _mm_mul_ps(xb, vpr)));
+      const __m128 t = _mm_sub_ps(_mm_mul_ps(vpr, vsr), _mm_mul_ps(vpi, vsi));
+      vpi = _mm_add_ps(_mm_mul_ps(vpr, vsi), _mm_mul_ps(vpi, vsr));
+      vpr = t;
+    }
+    _mm_storeu_ps(pr, vpr);
+    _mm_storeu_ps(pi, vpi);
+#endif
+    for (; k < m; ++k)
+    {
+      const unsigned q = k & 3;
+      const float xa = a[k], xb = b[k];
+      yr[k] = xa * pr[q] - xb * pi[q];
+      yi[k] = xa * pi[q] + xb * pr[q];
+      if (q == 3)
+      {
+        for (unsigned r = 0; r < 4; ++r)
+        {
+          const float t = pr[r] * sr - pi[r] * si;
+          pi[r] = pr[r] * si + pi[r] * sr;
+          pr[r] = t;
+        }
+      }
+    }
+    phase = fmod(phase + w * m, 2.0 * PI);
+  }
+}
+
+
+HalfbandDecimator::HalfbandDecimator()
+{
+  std::vector<float> full;
+  dsp_design_lowpass(full, HALFBAND_LEN, 0.25);
+  const unsigned C = (HALFBAND_LEN - 1) / 2;
+  h_center = full[C];
+  for (unsigned k = 0; k < C; k += 2)
+    h.push_back(full[k]);
+  reset();
+}
+
+void HalfbandDecimator::reset()
+{
+  buf_re.assign(HALFBAND_LEN - 1, 0.0F);
+  buf_im.assign(HALFBAND_LEN - 1, 0.0F);
+  pos = 0;
+}
+
+unsigned HalfbandDecimator::process(float* re, float* im, unsigned n)
+{
+  const size_t L = HALFBAND_LEN;
+  const size_t C = (L - 1) / 2;
+  const unsigned nh = unsigned(h.size());
+  buf_re.insert(buf_re.end(), re, re + n);
+  buf_im.insert(buf_im.end(), im, im + n);
+
+  unsigned n_out = 0;
+  const size_t size = buf_re.size();
+  for (; pos + L <= size; pos += 2)
+  {
+    // symmetric taps: fold both halves
+    const float* br = buf_re.data() + pos;
+    const float* bi = buf_im.data() + pos;
+    float yr = h_center * br[C];
+    float yi = h_center * bi[C];
+    for (unsigned k = 0; k < nh; ++k)
+    {
+      yr += h[k] * (br[2 * k] + br[L - 1 - 2 * k]);
+      yi += h[k] * (bi[2 * k] + bi[L - 1 - 2 * k]);
+    }
+    re[n_out] = yr;
+    im[n_out] = yi;
+    ++n_out;
+  }
+  buf_re.erase(buf_re.begin(), buf_re.begin() + pos);
+  buf_im.erase(buf_im.begin(), buf_im.begin() + pos);
+  pos = 0;
+  return n_out;
+}
+
+
+HilbertDecimator::HilbertDecimator()
+{
+  std::vector<float> full;
+  dsp_design_lowpass(full, HALFBAND_LEN, 0.25);
+  // gain 2: the real input's tone splits into positive and negative frequency
+  for (unsigned j = 0; j < TAPS; ++j)
+    g[j] = 2.0F * full[2 * j];
+  h_center = 2.0F * full[(HALFBAND_LEN - 1) / 2];
+  reset();
+}
+
+void HilbertDecimator::reset()
+{
+  buf_even.assign(TAPS - 1, 0.0F);
+  buf_odd.assign(TAPS / 2, 0.0F);
+  sign = 1.0F;
+}
+
+unsigned HilbertDecimator::process(const float* x, unsigned n, float* re, float* im)
+{
+  const unsigned m = n / 2;
+  const size_t he = buf_even.size();
+  const size_t ho = buf_odd.size();
+  buf_even.resize(he + m);
+  buf_odd.resize(ho + m);
+  // mix: signs 1, -1, -1, 1 per 4 samples
+  float* e = buf_even.data() + he;
+  float* o = buf_odd.data() + ho;
+  for (unsigned k = 0; k < m; ++k)
+  {
+    e[k] = sign * x[2 * k];
+    o[k] = -sign * x[2 * k + 1];
+    sign = -sign;
+  }
+  for (unsigned k = 0; k < m; ++k)
+  {
+    re[k] = dsp_dot(g, buf_even.data() + k, TAPS);
+    im[k] = h_center * buf_odd[k];
+  }
+  buf_even.erase(buf_even.begin(), buf_even.begin() + m);
+  buf_odd.erase(buf_odd.begin(), buf_odd.begin() + m);
+  return m;
+}
+
+
+unsigned FractionalResampler::taps_for(double ratio)
+{
+  const unsigned n = 4 * unsigned(ceil(TAPS * 0.8 / ratio / 4.0));
+  return (n < unsigned(TAPS)) ? unsigned(TAPS) : (n > unsigned(MAX_TAPS)) ? unsigned(MAX_TAPS) : n;
+}
+
+bool FractionalResampler::init(unsigned in_rate, unsigned out_rate)
+{
+  if (!out_rate || out_rate > in_rate)
+    return false;
+  in_step = in_rate;
+  out_step = out_rate;
+
+  // prototype at PHASES * in_rate: -6 dB at 0.4 * out_rate.
+  //   the transition band scales with 1 / n_taps: with n_taps ~ 1 / ratio,
+  //   it keeps its width relative to out_rate - ending near the output's nyquist
+  const double ratio = double(out_rate) / in_rate;
+  n_taps = taps_for(ratio);
+  std::vector<float> h;
+  dsp_design_lowpass(h, PHASES * n_taps + 1, 0.4 * ratio / PHASES);
+  bank.resize((PHASES + 1) * n_taps);
+  for (unsigned p = 0; p <= PHASES; ++p)
+    for (unsigned k = 0; k < n_taps; ++k)
+      bank[p * n_taps + (n_taps - 1 - k)] = PHASES * h[k * PHASES + p];
+  reset();
+  return true;
+}
+
+void FractionalResampler::reset()
+{
+  buf_re.assign(n_taps - 1, 0.0F);
+  buf_im.assign(n_taps - 1, 0.0F);
+  num = 0;
+  pos = n_taps - 1;
+}
+
+unsigned FractionalResampler::process(const float* in_re, const float* in_im, unsigned n, float* out_re, float* out_im)
+{
+  buf_re.insert(buf_re.end(), in_re, in_re + n);
+  buf_im.insert(buf_im.end(), in_im, in_im + n);
+
+  alignas(16) float taps[MAX_TAPS];
+  unsigned n_out = 0;
+  const size_t size = buf_re.size();
+  while (pos < size)
+  {
+    // output at pos + num / out_step: y = sum x[pos - k] * g(k + frac)
+    const double phi = double(num) * PHASES / double(out_step);
+    const unsigned p = unsigned(phi);
+    const float mu = float(phi - p);
+    const float* b0 = bank.data() + p * n_taps;
+    const float* b1 = b0 + n_taps;
+    for (unsigned k = 0; k < n_taps; ++k)
+      taps[k] = b0[k] + mu * (b1[k] - b0[k]);
+    out_re[n_out] = dsp_dot(taps, buf_re.data() + pos - (n_taps - 1), n_taps);
+    out_im[n_out] = dsp_dot(taps, buf_im.data() + pos - (n_taps - 1), n_taps);
+    ++n_out;
+
+    num += in_step;
+    pos += size_t(num / out_step);
+    num %= out_step;
+  }
+  // keep n_taps - 1 samples of history before pos
+  const size_t drop = (pos - (n_taps - 1) < size) ? pos - (n_taps - 1) : size;
+  buf_re.erase(buf_re.begin(), buf_re.begin() + drop);
+  buf_im.erase(buf_im.begin(), buf_im.begin() + drop);
+  pos -= drop;
+  return n_out;
+}
+
+
+double dsp_effective_bits(double decimation)
+{
+  return 8.0 + 0.5 * log2(decimation > 1.0 ? decimation : 1.0);
+}
+
+float dsp_pcm16_scale(double decimation)
+{
+  const double added = ceil(dsp_effective_bits(decimation) - 8.0);
+  return float(127.5 * pow(2.0, added));
+}
+
+void dsp_store_samples(const float* re, const float* im, unsigned n, void* out, unsigned pos, SampleFormat fmt, float pcm16_scale)
+{
+  switch (fmt)
+  {
+  case SAMPLE_FLT32:
+  {
+    float* o = (float*)out + 2 * size_t(pos);
+    for (unsigned k = 0; k < n; ++k)
+    {
+      o[2 * k] = re[k];
+      o[2 * k + 1] = im[k];
+    }
+    break;
+  }
+  case SAMPLE_PCM16:
+  {
+    int16_t* o = (int16_t*)out + 2 * size_t(pos);
+    for (unsigned k = 0; k < n; ++k)
+    {
+      const float vr = re[k] * pcm16_scale, vi = im[k] * pcm16_scale;
+      o[2 * k] = int16_t(lrint(vr < -32768.0F ? -32768.0F : vr > 32767.0F ? 32767.0F : vr));
+      o[2 * k + 1] = int16_t(lrint(vi < -32768.0F ? -32768.0F : vi > 32767.0F ? 32767.0F : vi));
+    }
+    break;
+  }
+  case SAMPLE_U8:
+  default:
+  {
+    uint8_t* o = (uint8_t*)out + 2 * size_t(pos);
+    for (unsigned k = 0; k < n; ++k)
+    {
+      const float vr = 127.5F + re[k] * 127.5F, vi = 127.5F + im[k] * 127.5F;
+      o[2 * k] = uint8_t(lrint(vr < 0.0F ? 0.0F : vr > 255.0F ? 255.0F : vr));
+      o[2 * k + 1] = uint8_t(lrint(vi < 0.0F ? 0.0F : vi > 255.0F ? 255.0F : vi));
+    }
+    break;
+  }
+  }
+}
+
+
+float dsp_dot(const float* a, const float* b, unsigned n)
+{
+#ifdef DSP_USE_SSE2
+  __m128 acc = _mm_setzero_ps();
+  for (unsigned k = 0; k < n; k += 4)
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(a + k), _mm_loadu_ps(b + k)));
+  float r[4];
+  _mm_storeu_ps(r, acc);
+  return (r[0] + r[1]) + (r[2] + r[3]);
+#else
+  float acc = 0.0F;
+  for (unsigned k = 0; k < n; ++k)
+    acc += a[k] * b[k];
+  return acc;
+#endif
+}
+
+void dsp_design_lowpass(std::vector<float>& h, unsigned len, double fc)
+{
+  h.resize(len);
+  double sum = 0.0;
+  std::vector<double> t(len);
+  for (unsigned k = 0; k < len; ++k)
+  {
+    const double x = double(k) - (len - 1) / 2.0;
+    const double s = (x == 0.0) ? 2.0 * fc : sin(2.0 * PI * fc * x) / (PI * x);
+    const double phi = 2.0 * PI * k / (len - 1);
+    const double w = 0.42 - 0.5 * cos(phi) + 0.08 * cos(2.0 * phi);   // Blackman
+    t[k] = s * w;
+    sum += t[k];
+  }
+  for (unsigned k = 0; k < len; ++k)
+    h[k] = float(t[k] / sum);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// small DSP building blocks on split complex float arrays.
+// the inner loops run on SSE2, when available.
+
+// numerically controlled oscillator: multiplies with exp(j 2 pi f n)
+class NCO
+{
+public:
+  // f: frequency in cycles per sample, negative to mix down
+  void set_freq(double f);
+  double freq() const { return f_norm; }
+  void reset() { phase = 0.0; }
+
+  // in and out may be the same arrays
+  void mix(const float* in_re, const float* in_im, float* out_re, float* out_im, unsigned n);
+
+private:
+  double f_norm = 0.0;
+  double w = 0.0;
+  double phase = 0.0;
+};
+
+
+// half-band lowpass, decimating by 2 - keeps its history between calls
+class HalfbandDecimator
+{
+public:
+  HalfbandDecimator();
+  void reset();
+
+  // in place: n input samples => returns number of output samples
+  unsigned process(float* re, float* im, unsigned n);
+
+private:
+  std::vector<float> h;       // taps 0, 2, .. center - 1; zeros between
+  float h_center;
+  std::vector<float> buf_re, buf_im;
+  size_t pos = 0;
+};
+
+
+// real to complex: shifts +samplerate/4 to zero and decimates by 2 - keeps its history.
+// mixing with (-j)^n leaves even samples real and odd samples imaginary:
+//   the half-band's even taps filter the real part, its center tap delays the imaginary part
+class HilbertDecimator
+{
+public:
+  enum { TAPS = 24 };       // nonzero even taps of the half-band
+
+  HilbertDecimator();
+  void reset();
+
+  // n real input samples - n even => n / 2 complex output samples. gain 1 for real tones
+  unsigned process(const float* x, unsigned n, float* re, float* im);
+
+private:
+  alignas(16) float g[TAPS];
+  float h_center;
+  std::vector<float> buf_even, buf_odd;
+  float sign = 1.0F;
+};
+
+
+// polyphase fractional resampler for out_rate <= in_rate - keeps its history.
+// the output time advances by in_rate / out_rate input samples - in exact integer steps.
+// taps for the fractional position are interpolated between adjacent phases
+class FractionalResampler
+{
+public:
+  // TAPS at ratio 0.8 - growing with 1 / ratio up to MAX_TAPS: same response at any ratio
+  enum { PHASES = 128, TAPS = 32, MAX_TAPS = 128 };
+
+  // taps for ratio = out_rate / in_rate: multiple of 4
+  static unsigned taps_for(double ratio);
+
+  // false, when out_rate > in_rate
+  bool init(unsigned in_rate, unsigned out_rate);
+  void reset();
+
+  // n input samples => returns number of output samples - up to n
+  unsigned process(const float* in_re, const float* in_im, unsigned n, float* out_re, float* out_im);
+
+  // multiply-accumulates per output sample
+  static unsigned macs_per_output(double ratio) { return 3 * taps_for(ratio); }
+
+private:
+  std::vector<float> bank;    // (PHASES + 1) rows of n_taps - reversed in time
+  std::vector<float> buf_re, buf_im;
+  unsigned n_taps = TAPS;
+  uint64_t in_step = 1, out_step = 1;
+  uint64_t num = 0;           // fractional position: num / out_step
+  size_t pos = TAPS - 1;
+};
+
+
+// sample formats for the host's stream
+enum SampleFormat { SAMPLE_U8, SAMPLE_PCM16, SAMPLE_FLT32 };
+
+// bytes per I/Q pair
+inline unsigned dsp_sample_pair_size(SampleFormat fmt) { return (fmt == SAMPLE_FLT32) ? 8 : (fmt == SAMPLE_PCM16) ? 4 : 2; }
+
+// decimation by D adds 0.5 * log2(D) bits to the 8 bit input
+double dsp_effective_bits(double decimation);
+// 16 bit full scale for normalized samples: 128 shifted by the added bits - rounded up.
+//   decimation: input rate / output rate - including a fractional ratio
+float dsp_pcm16_scale(double decimation);
+
+// store n normalized I/Q pairs - full scale 1 - at pair index pos of out.
+//   8 bit is re-truncated, float keeps the normalization
+void dsp_store_samples(const float* re, const float* im, unsigned n, void* out, unsigned pos, SampleFormat fmt, float pcm16_scale);
+
+
+// sum of a[k] * b[k] - n multiple of 4. a must be 16 byte aligned
+float dsp_dot(const float* a, const float* b, unsigned n);
+
+// windowed sinc lowpass (Blackman) with DC gain 1. fc: cutoff relative to samplerate
+void dsp_design_lowpass(std::vector<float>& h, unsigned len, double fc);
@@ -0,0 +1,125 @@
+
+#include "fft.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFT_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const double PI = 3.14159265358979323846;
+
+
+bool FFT::init(unsigned n)
+{
+  if (n < 16 || n > 65536 || (n & (n - 1)))
+    return false;
+  if (n == N)
+    return true;
+
+  N = n;
+  log2N = 0;
+  while ((1U << log2N) < n)
+    ++log2N;
+
+  bitrev.resize(N);
+  for (unsigned k = 0; k < N; ++k)
+  {
+    unsigned r = 0;
+    for (unsigned b = 0; b < log2N; ++b)
+      r |= ((k >> b) & 1U) << (log2N - 1 - b);
+    bitrev[k] = r;
+  }
+
+  // double precision twiddles, stored as float
+  tw_re.resize(N);
+  tw_im.resize(N);
+  for (unsigned h = 1; h < N; h *= 2)
+  {
+    for (unsigned k = 0; k < h; ++k)
+    {
+      const double phi = -PI * double(k) / double(h);
+      tw_re[h - 1 + k] = float(cos(phi));
+      tw_im[h - 1 + k] = float(sin(phi));
+    }
+  }
+  return true;
+}
+
+
+void FFT::forward(float* re, float* im) const
+{
+  for (unsigned k = 0; k < N; ++k)
+  {
+    const unsigned r = bitrev[k];
+    if (r > k)
+    {
+      float t = re[k];  re[k] = re[r];  re[r] = t;
+      t = im[k];  im[k] = im[r];  im[r] = t;
+    }
+  }
+
+  // stage h == 1: twiddle is 1
+  for (unsigned j = 0; j < N; j += 2)
+  {
+    const float ar = re[j], ai = im[j];
+    const float br = re[j + 1], bi = im[j + 1];
+    re[j] = ar + br;  im[j] = ai + bi;
+    re[j + 1] = ar - br;  im[j + 1] = ai - bi;
+  }
+
+  // stage h == 2: twiddles 1 and -j
+  for (unsigned j = 0; j < N; j += 4)
+  {
+    float ar = re[j], ai = im[j];
+    float br = re[j + 2], bi = im[j + 2];
+    re[j] = ar + br;  im[j] = ai + bi;
+    re[j + 2] = ar - br;  im[j + 2] = ai - bi;
+
+    ar = re[j + 1];  ai = im[j + 1];
+    br = im[j + 3];  bi = -re[j + 3];   // b * -j
+    re[j + 1] = ar + br;  im[j + 1] = ai + bi;
+    re[j + 3] = ar - br;  im[j + 3] = ai - bi;
+  }
+
+  for (unsigned h = 4; h < N; h *= 2)
+  {
+    const float* wr = tw_re.data() + h - 1;
+    const float* wi = tw_im.data() + h - 1;
+    for (unsigned j = 0; j < N; j += 2 * h)
+    {
+      float* a_re = re + j;
+      float* a_im = im + j;
+      float* b_re = re + j + h;
+      float* b_im = im + j + h;
+#ifdef FFT_USE_SSE2
+      for (unsigned k = 0; k < h; k += 4)
+      {
+        // twiddles at h - 1 are not 16 byte aligned
+        const __m128 w_r = _mm_loadu_ps(wr + k);
+        const __m128 w_i = _mm_loadu_ps(wi + k);
+        const __m128 x_r = _mm_load_ps(b_re + k);
+        const __m128 x_i = _mm_load_ps(b_im + k);
+        const __m128 t_r = _mm_sub_ps(_mm_mul_ps(x_r, w_r), _mm_mul_ps(x_i, w_i));
+        const __m128 t_i = _mm_add_ps(_mm_mul_ps(x_r, w_i), _mm_mul_ps(x_i, w_r));
+        const __m128 u_r = _mm_load_ps(a_re + k);
+        const __m128 u_i = _mm_load_ps(a_im + k);
+        _mm_store_ps(a_re + k, _mm_add_ps(u_r, t_r));
+        _mm_store_ps(a_im + k, _mm_add_ps(u_i, t_i));
+        _mm_store_ps(b_re + k, _mm_sub_ps(u_r, t_r));
+        _mm_store_ps(b_im + k, _mm_sub_ps(u_i, t_i));
+      }
+#else
+      for (unsigned k = 0; k < h; ++k)
+      {
+        const float t_r = b_re[k] * wr[k] - b_im[k] * wi[k];
+        const float t_i = b_re[k] * wi[k] + b_im[k] * wr[k];
+        const float u_r = a_re[k], u_i = a_im[k];
+        a_re[k] = u_r + t_r;  a_im[k] = u_i + t_i;
+        b_re[k] = u_r - t_r;  b_im[k] = u_i - t_i;
+      }
+#endif
+    }
+  }
+}
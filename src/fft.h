@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// complex forward FFT of power of 2 size on split real/imaginary arrays.
+// iterative radix-2 decimation in time. the butterflies of all stages
+// with 4 or more butterflies per group run on SSE2, when available.
+class FFT
+{
+public:
+  // n: power of 2, 16 .. 65536. false on invalid size
+  bool init(unsigned n);
+  unsigned size() const { return N; }
+
+  // in place: re[N], im[N] must be 16 byte aligned
+  void forward(float* re, float* im) const;
+
+private:
+  unsigned N = 0;
+  unsigned log2N = 0;
+  std::vector<unsigned> bitrev;
+  // twiddles of all stages, stage with half size h at offset h - 1
+  std::vector<float> tw_re;
+  std::vector<float> tw_im;
+};
+
+
+// 16 byte aligned float buffer for FFT::forward()
+class AlignedFloats
+{
+public:
+  AlignedFloats() = default;
+  AlignedFloats(const AlignedFloats&) = delete;
+  AlignedFloats& operator=(const AlignedFloats&) = delete;
+  ~AlignedFloats() { delete[] raw; }
+
+  void resize(unsigned n)
+  {
+    delete[] raw;
+    raw = new float[n + 4];
+    p = (float*)((((size_t)raw) + 15) & ~size_t(15));
+    len = n;
+  }
+  float* data() { return p; }
+  const float* data() const { return p; }
+  unsigned size() const { return len; }
+  float& operator[](unsigned k) { return p[k]; }
+
+private:
+  float* raw = nullptr;
+  float* p = nullptr;
+  unsigned len = 0;
+};
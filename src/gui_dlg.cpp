@@ -18,6 +18,7 @@
 #include "tuners.h"
 #include "rates.h"
 #include "control.h"
+#include "rate_qual.h"
 #include "resource.h"
 
 #include "LC_ExtIO_Types.h"
@@ -582,7 +583,12 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
 
     ComboBox_ResetContent(hDlgItmSampRate);
     for (int i = 0; i < rates::N; i++)
-      ComboBox_AddString(hDlgItmSampRate, rates::tab[i].name);
+    {
+      // mark rates above the qualified max
+      TCHAR str[256];
+      _stprintf_s(str, 255, TEXT("%s%s"), rates::tab[i].name, (rate_qual_stable(rates::tab[i].valueInt) ? "" : " - loses samples!"));
+      ComboBox_AddString(hDlgItmSampRate, str);
+    }
     ComboBox_SetCurSel(hDlgItmSampRate, nxt.srate_idx);
 
     {
@@ -629,7 +635,7 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
       BOOL enableBandCenter = (isR82XX()) ? TRUE : FALSE;
       BOOL enableIFGain = (!nxt.tuner_if_agc && isR82XX()) ? TRUE : FALSE;
       BOOL enableTunerBW = (bandwidths && 0 == nxt.sampling_mode) ? TRUE : FALSE;
-      BOOL enableDeviceList = (!RtlSdrDev || !ThreadStreamToSDR.load());
+      BOOL enableDeviceList = (!is_device_open() || !ThreadStreamToSDR.load());
 
       EnableWindow(hDlgItmDevices, enableDeviceList);
       EnableWindow(hDlgItmOffset, enableOffset);
@@ -895,7 +901,7 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
           SDRLG(extHw_MSG_ERROR, "Source ComboBox selected invalid device %u of %u with dev_idx %u",
             RtlSelectedDeviceIdx, RtlNumDevices, RtlDeviceList[RtlSelectedDeviceIdx].dev_idx);
         }
-        else if (RtlSdrDev && !ThreadStreamToSDR.load())
+        else if (is_device_open() && !ThreadStreamToSDR.load())
           // && !RtlDeviceInfo::is_same(RtlOpenDevice, RtlDeviceList[RtlSelectedDeviceIdx]))
         {
           open_selected_rtl_device();
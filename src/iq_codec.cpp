@@ -0,0 +1,375 @@
+
+#include "iq_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define MIN_MATCH       4
+#define LAST_LITERALS   8     // keep the decoder's copies in bounds
+#define HASH_BITS       12
+
+
+static inline void put_le32(uint8_t* p, uint32_t v)
+{
+  p[0] = uint8_t(v);        p[1] = uint8_t(v >> 8);
+  p[2] = uint8_t(v >> 16);  p[3] = uint8_t(v >> 24);
+}
+
+static inline uint32_t get_le32(const uint8_t* p)
+{
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint32_t header_check(const uint8_t* p)
+{
+  // FNV-1a over the first 20 header bytes
+  uint32_t h = 2166136261U;
+  for (int k = 0; k < 20; ++k)
+    h = (h ^ p[k]) * 16777619U;
+  return h;
+}
+
+
+void iq_codec::put_header(uint8_t* p, const Header& h)
+{
+  p[0] = 'R';  p[1] = 'T';  p[2] = 'Z';  p[3] = '1';
+  put_le32(p + 4, h.seq);
+  p[8] = h.mode;
+  p[9] = h.bits;
+  p[10] = p[11] = 0;
+  put_le32(p + 12, h.raw_len);
+  put_le32(p + 16, h.payload_len);
+  put_le32(p + 20, header_check(p));
+}
+
+bool iq_codec::get_header(const uint8_t* p, Header& h)
+{
+  if (p[0] != 'R' || p[1] != 'T' || p[2] != 'Z' || p[3] != '1')
+    return false;
+  if (get_le32(p + 20) != header_check(p))
+    return false;
+  h.seq = get_le32(p + 4);
+  h.mode = p[8];
+  h.bits = p[9];
+  h.raw_len = get_le32(p + 12);
+  h.payload_len = get_le32(p + 16);
+  if (h.raw_len > MAX_RAW_LEN || h.payload_len > max_frame_len(h.raw_len) - HEADER_LEN)
+    return false;
+  if (h.mode > MODE_LOSSY || (h.mode == MODE_LOSSY && (h.bits < 1 || h.bits > 7)))
+    return false;
+  return true;
+}
+
+
+void IQCodecStats::reset()
+{
+  raw_bytes = 0;
+  coded_bytes = 0;
+  cpu_ns = 0;
+  frames = 0;
+  frame_errors = 0;
+}
+
+void IQCodecStats::format(char* s, size_t len) const
+{
+  const uint64_t raw = raw_bytes.load();
+  const uint64_t coded = coded_bytes.load();
+  const double ratio = coded ? double(raw) / double(coded) : 0.0;
+  // ns per sample * 1E6 samples = ns per second at 1 MSps. in % of 1E9 ns
+  const double cpu_per_msps = raw ? (double(cpu_ns.load()) / (raw / 2)) * 1E6 / 1E9 * 100.0 : 0.0;
+  snprintf(s, len - 1, "ratio %.2f, %.2f %% CPU per MSps, %llu frames, %llu errors",
+    ratio, cpu_per_msps, (unsigned long long)frames.load(), (unsigned long long)frame_errors.load());
+  s[len - 1] = 0;
+}
+
+
+// LZ4 style sequences: token (literal length << 4 | match length - 4),
+//   optional length extension bytes, literals, 16 bit offset, optional extension bytes.
+//   the last sequence has literals only
+static uint8_t* put_length(uint8_t* op, size_t len)
+{
+  while (len >= 255)
+  {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = uint8_t(len);
+  return op;
+}
+
+static size_t lz_compress(const uint8_t* src, size_t len, uint8_t* dst, uint32_t* hash_tab)
+{
+  const uint8_t* ip = src;
+  const uint8_t* anchor = src;
+  const uint8_t* const iend = src + len;
+  const uint8_t* const mlimit = (len > LAST_LITERALS + MIN_MATCH) ? iend - LAST_LITERALS : src;
+  uint8_t* op = dst;
+
+  memset(hash_tab, 0xFF, sizeof(uint32_t) << HASH_BITS);
+
+  while (ip + MIN_MATCH <= mlimit)
+  {
+    uint32_t seq;
+    memcpy(&seq, ip, 4);
+    const uint32_t h = (seq * 2654435761U) >> (32 - HASH_BITS);
+    const uint32_t ref_pos = hash_tab[h];
+    hash_tab[h] = uint32_t(ip - src);
+    const uint8_t* ref = src + ref_pos;
+    if (ref_pos == 0xFFFFFFFFU || ip - ref > 65535 || memcmp(ref, ip, 4))
+    {
+      ++ip;
+      continue;
+    }
+
+    // extend the match
+    size_t mlen = MIN_MATCH;
+    while (ip + mlen < mlimit && ref[mlen] == ip[mlen])
+      ++mlen;
+
+    const size_t lit = size_t(ip - anchor);
+    uint8_t* token = op++;
+    *token = uint8_t(((lit >= 15) ? 15 : lit) << 4);
+    if (lit >= 15)
+      op = put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+
+    const uint32_t offset = uint32_t(ip - ref);
+    *op++ = uint8_t(offset);
+    *op++ = uint8_t(offset >> 8);
+    const size_t ml = mlen - MIN_MATCH;
+    *token |= uint8_t((ml >= 15) ? 15 : ml);
+    if (ml >= 15)
+      op = put_length(op, ml - 15);
+
+    ip += mlen;
+    anchor = ip;
+  }
+
+  // last literals
+  const size_t lit = size_t(iend - anchor);
+  *op++ = uint8_t(((lit >= 15) ? 15 : lit) << 4);
+  if (lit >= 15)
+    op = put_length(op, lit - 15);
+  memcpy(op, anchor, lit);
+  op += lit;
+  return size_t(op - dst);
+}
+
+static bool get_length(const uint8_t*& ip, const uint8_t* iend, size_t& len)
+{
+  uint8_t b;
+  do
+  {
+    if (ip >= iend)
+      return false;
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return true;
+}
+
+static bool lz_decompress(const uint8_t* src, size_t len, uint8_t* dst, size_t dst_len)
+{
+  const uint8_t* ip = src;
+  const uint8_t* const iend = src + len;
+  uint8_t* op = dst;
+  uint8_t* const oend = dst + dst_len;
+
+  while (ip < iend)
+  {
+    const uint8_t token = *ip++;
+    size_t lit = token >> 4;
+    if (lit == 15 && !get_length(ip, iend, lit))
+      return false;
+    if (lit > size_t(iend - ip) || lit > size_t(oend - op))
+      return false;
+    memcpy(op, ip, lit);
+    ip += lit;
+    op += lit;
+    if (ip == iend)
+      break;    // last sequence
+
+    if (iend - ip < 2)
+      return false;
+    const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+    ip += 2;
+    size_t mlen = token & 15;
+    if (mlen == 15 && !get_length(ip, iend, mlen))
+      return false;
+    mlen += MIN_MATCH;
+    if (!offset || offset > size_t(op - dst) || mlen > size_t(oend - op))
+      return false;
+    // byte wise: overlapping matches are valid
+    const uint8_t* ref = op - offset;
+    for (size_t k = 0; k < mlen; ++k)
+      op[k] = ref[k];
+    op += mlen;
+  }
+  return op == oend;
+}
+
+
+static size_t pack_bits(const uint8_t* raw, size_t len, unsigned bits, uint8_t* dst)
+{
+  const unsigned shift = 8 - bits;
+  uint8_t* op = dst;
+  uint32_t acc = 0;
+  unsigned nacc = 0;
+  for (size_t k = 0; k < len; ++k)
+  {
+    acc |= uint32_t(raw[k] >> shift) << nacc;
+    nacc += bits;
+    if (nacc >= 8)
+    {
+      *op++ = uint8_t(acc);
+      acc >>= 8;
+      nacc -= 8;
+    }
+  }
+  if (nacc)
+    *op++ = uint8_t(acc);
+  return size_t(op - dst);
+}
+
+static void unpack_bits(const uint8_t* src, size_t len, unsigned bits, uint8_t* raw)
+{
+  const unsigned shift = 8 - bits;
+  const uint8_t mask = uint8_t((1U << bits) - 1U);
+  const uint8_t half = uint8_t(1U << (shift - 1));   // center of quantization step
+  const uint8_t* ip = src;
+  uint32_t acc = 0;
+  unsigned nacc = 0;
+  for (size_t k = 0; k < len; ++k)
+  {
+    if (nacc < bits)
+    {
+      acc |= uint32_t(*ip++) << nacc;
+      nacc += 8;
+    }
+    raw[k] = uint8_t(((acc & mask) << shift) | half);
+    acc >>= bits;
+    nacc -= bits;
+  }
+}
+
+
+size_t IQEncoder::encode(uint8_t mode, uint8_t bits, const uint8_t* raw, size_t raw_len,
+                         std::vector<uint8_t>& frame, IQCodecStats* stats)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  frame.resize(iq_codec::max_frame_len(raw_len));
+  uint8_t* payload = frame.data() + iq_codec::HEADER_LEN;
+
+  iq_codec::Header h;
+  h.seq = seq++;
+  h.mode = mode;
+  h.bits = 0;
+  h.raw_len = uint32_t(raw_len);
+  h.payload_len = 0;
+
+  if (mode == iq_codec::MODE_LOSSY && bits >= 1 && bits <= 7)
+  {
+    h.bits = bits;
+    h.payload_len = uint32_t(pack_bits(raw, raw_len, bits, payload));
+  }
+  else if (mode == iq_codec::MODE_LOSSLESS)
+  {
+    // delta per channel: I to previous I, Q to previous Q
+    delta.resize(raw_len);
+    uint8_t prev[2] = { 0, 0 };
+    for (size_t k = 0; k < raw_len; ++k)
+    {
+      delta[k] = uint8_t(raw[k] - prev[k & 1]);
+      prev[k & 1] = raw[k];
+    }
+    h.payload_len = uint32_t(lz_compress(delta.data(), raw_len, payload, hash_tab));
+    if (h.payload_len >= raw_len)
+      h.mode = iq_codec::MODE_STORED;
+  }
+  else
+    h.mode = iq_codec::MODE_STORED;
+
+  if (h.mode == iq_codec::MODE_STORED)
+  {
+    memcpy(payload, raw, raw_len);
+    h.payload_len = uint32_t(raw_len);
+  }
+
+  iq_codec::put_header(frame.data(), h);
+  const size_t frame_len = iq_codec::HEADER_LEN + h.payload_len;
+  frame.resize(frame_len);
+
+  if (stats)
+  {
+    const auto t1 = std::chrono::steady_clock::now();
+    stats->raw_bytes += raw_len;
+    stats->coded_bytes += frame_len;
+    stats->cpu_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    ++stats->frames;
+  }
+  return frame_len;
+}
+
+
+bool IQDecoder::decode(const iq_codec::Header& h, const uint8_t* payload,
+                       std::vector<uint8_t>& raw, IQCodecStats* stats)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  if (have_seq && h.seq != next_seq)
+    num_lost += uint32_t(h.seq - next_seq);
+  have_seq = true;
+  next_seq = h.seq + 1;
+
+  raw.resize(h.raw_len);
+  bool ok = true;
+  switch (h.mode)
+  {
+  case iq_codec::MODE_STORED:
+    ok = (h.payload_len == h.raw_len);
+    if (ok)
+      memcpy(raw.data(), payload, h.raw_len);
+    break;
+  case iq_codec::MODE_LOSSLESS:
+    ok = lz_decompress(payload, h.payload_len, raw.data(), h.raw_len);
+    if (ok)
+    {
+      uint8_t prev[2] = { 0, 0 };
+      for (size_t k = 0; k < h.raw_len; ++k)
+      {
+        raw[k] = uint8_t(raw[k] + prev[k & 1]);
+        prev[k & 1] = raw[k];
+      }
+    }
+    break;
+  case iq_codec::MODE_LOSSY:
+    ok = (h.payload_len == (size_t(h.raw_len) * h.bits + 7) / 8);
+    if (ok)
+      unpack_bits(payload, h.raw_len, h.bits, raw.data());
+    break;
+  default:
+    ok = false;
+  }
+
+  if (stats)
+  {
+    const auto t1 = std::chrono::steady_clock::now();
+    if (ok)
+    {
+      stats->raw_bytes += h.raw_len;
+      stats->coded_bytes += iq_codec::HEADER_LEN + h.payload_len;
+      ++stats->frames;
+    }
+    else
+      ++stats->frame_errors;
+    stats->cpu_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  }
+  return ok;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+// optional compression of the 8-bit I/Q stream for the network transport.
+// the stream is cut into frames, each decodable on its own:
+//   24 bytes header: magic "RTZ1", sequence number, mode, bits,
+//     raw length, payload length and a check of the header fields
+//   followed by the payload
+// modes:
+//   lossless: byte delta per I and Q channel + LZ4 style block compression.
+//             falls back to 'stored', when the block does not compress
+//   lossy:    requantization to 'bits' bits per sample (1 .. 7), bit packed
+
+struct iq_codec
+{
+  static constexpr uint8_t MODE_STORED = 0;
+  static constexpr uint8_t MODE_LOSSLESS = 1;
+  static constexpr uint8_t MODE_LOSSY = 2;
+
+  static constexpr int HEADER_LEN = 24;
+  static constexpr uint32_t MAX_RAW_LEN = 64 * 1024;
+
+  struct Header
+  {
+    uint32_t seq;
+    uint8_t mode;
+    uint8_t bits;
+    uint32_t raw_len;
+    uint32_t payload_len;
+  };
+
+  static size_t max_frame_len(size_t raw_len)
+  {
+    // worst case of LZ: all literals
+    return HEADER_LEN + raw_len + raw_len / 255 + 16;
+  }
+
+  static void put_header(uint8_t* p, const Header& h);
+  // false, if there is no valid header at p
+  static bool get_header(const uint8_t* p, Header& h);
+};
+
+
+// encoder/decoder statistics for ratio and CPU cost
+struct IQCodecStats
+{
+  std::atomic_uint64_t raw_bytes{ 0 };
+  std::atomic_uint64_t coded_bytes{ 0 };
+  std::atomic_uint64_t cpu_ns{ 0 };
+  std::atomic_uint64_t frames{ 0 };
+  std::atomic_uint64_t frame_errors{ 0 };
+
+  void reset();
+  // "ratio 1.53, 0.8 % CPU per MSps, 1234 frames, 0 errors"
+  void format(char* s, size_t len) const;
+};
+
+
+class IQEncoder
+{
+public:
+  // raw_len <= iq_codec::MAX_RAW_LEN. returns the frame length
+  size_t encode(uint8_t mode, uint8_t bits, const uint8_t* raw, size_t raw_len,
+                std::vector<uint8_t>& frame, IQCodecStats* stats = nullptr);
+
+private:
+  uint32_t seq = 0;
+  std::vector<uint8_t> delta;
+  uint32_t hash_tab[4096];
+};
+
+
+class IQDecoder
+{
+public:
+  // decode payload of a frame with valid header h into raw (resized to h.raw_len).
+  // returns false on corrupt payload
+  bool decode(const iq_codec::Header& h, const uint8_t* payload,
+              std::vector<uint8_t>& raw, IQCodecStats* stats = nullptr);
+
+  // number of sequence gaps
+  uint64_t lost_frames() const { return num_lost; }
+
+private:
+  bool have_seq = false;
+  uint32_t next_seq = 0;
+  uint64_t num_lost = 0;
+};
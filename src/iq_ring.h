@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <new>
+
+
+// single producer / multiple consumer ring of raw I/Q bytes.
+// the producer (RtlSdrCallback) appends each block exactly once.
+// every consumer keeps its own absolute read position (a cursor)
+// and reads directly from the ring's memory. data, which leaves the consumer -
+// e.g. to a socket - is copied out first and checked with is_valid() afterwards.
+// the producer never waits for consumers: a consumer, which falls behind
+// more than lag_limit() bytes, has to resync (skip ahead) or disconnect.
+class IQRing
+{
+public:
+  IQRing() = default;
+  IQRing(const IQRing&) = delete;
+  IQRing& operator=(const IQRing&) = delete;
+
+  ~IQRing()
+  {
+    delete[] buf;
+  }
+
+  // size is rounded up to a power of 2
+  bool alloc(size_t size)
+  {
+    size_t sz = 4096;
+    while (sz < size)
+      sz <<= 1;
+    if (buf && sz == cap)
+    {
+      reset();
+      return true;
+    }
+    delete[] buf;
+    buf = new (std::nothrow) uint8_t[sz];
+    cap = buf ? sz : 0;
+    reset();
+    return buf != nullptr;
+  }
+
+  void reset()
+  {
+    wpos.store(0);
+  }
+
+  size_t capacity() const { return cap; }
+
+  // keep a quarter of the ring as guard area, which the producer overwrites
+  // while a consumer might still read it
+  size_t lag_limit() const { return cap - cap / 4; }
+
+  uint64_t write_pos() const { return wpos.load(std::memory_order_acquire); }
+
+  // producer side: one append per USB block
+  void append(const uint8_t* p, size_t len)
+  {
+    if (!buf || !len)
+      return;
+    if (len > cap)
+    {
+      p += len - cap;
+      len = cap;
+    }
+    const uint64_t w = wpos.load(std::memory_order_relaxed);
+    const size_t off = size_t(w & (cap - 1));
+    const size_t first = (len <= cap - off) ? len : (cap - off);
+    memcpy(buf + off, p, first);
+    if (first < len)
+      memcpy(buf, p + first, len - first);
+    wpos.store(w + len, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+    }
+    cv.notify_all();
+  }
+
+  // consumer side: how many bytes are behind the producer?
+  uint64_t lag(uint64_t rpos) const
+  {
+    return write_pos() - rpos;
+  }
+
+  // consumer side: is data at rpos still (or again) valid after reading?
+  bool is_valid(uint64_t rpos) const
+  {
+    return lag(rpos) <= lag_limit();
+  }
+
+  // consumer side: contiguous readable region starting at rpos.
+  // returns 0 when there is nothing to read
+  size_t peek(uint64_t rpos, const uint8_t*& p, size_t max_len) const
+  {
+    const uint64_t avail = lag(rpos);
+    if (!avail || !buf)
+      return 0;
+    const size_t off = size_t(rpos & (cap - 1));
+    size_t len = (avail < uint64_t(cap - off)) ? size_t(avail) : (cap - off);
+    if (len > max_len)
+      len = max_len;
+    p = buf + off;
+    return len;
+  }
+
+  // consumer side: copy out len bytes - data might be overwritten meanwhile:
+  // check is_valid(rpos) afterwards
+  void copy_out(uint64_t rpos, uint8_t* dest, size_t len) const
+  {
+    const size_t off = size_t(rpos & (cap - 1));
+    const size_t first = (len <= cap - off) ? len : (cap - off);
+    memcpy(dest, buf + off, first);
+    if (first < len)
+      memcpy(dest + first, buf, len - first);
+  }
+
+  // consumer side: wait until data is available behind rpos or timeout
+  bool wait(uint64_t rpos, int timeout_ms)
+  {
+    std::unique_lock<std::mutex> lk(mtx);
+    return cv.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+      [&] { return write_pos() != rpos; });
+  }
+
+  // wake up all waiting consumers, e.g. for termination
+  void wakeup()
+  {
+    cv.notify_all();
+  }
+
+private:
+  uint8_t* buf = nullptr;
+  size_t cap = 0;
+  std::atomic<uint64_t> wpos{ 0 };
+  std::mutex mtx;
+  std::condition_variable cv;
+};
@@ -0,0 +1,26 @@
+
+#include "lo_chain.h"
+#include "dc_avoid.h"
+#include "ds_hilbert.h"
+#include "sweep.h"
+#include "control.h"
+
+
+int64_t host_LO_from_hw(int64_t hw_LO)
+{
+  return dc_avoid_host_LO(ds_hilbert_host_LO(sweep_host_hw_LO(hw_LO)));
+}
+
+int64_t hw_LO_from_host(int64_t host_LO, int64_t tune_freq)
+{
+  return ds_hilbert_hw_LO(dc_avoid_LO(host_LO, tune_freq));
+}
+
+bool set_hw_LO_from_host(int64_t host_LO, int64_t tune_freq)
+{
+  const int64_t hw_LO = hw_LO_from_host(host_LO, tune_freq);
+  if (sweep_hold_hw_LO(hw_LO) || hw_LO == nxt.LO_freq.load())
+    return false;
+  nxt.LO_freq.store(hw_LO);
+  return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+// the tuner's LO against the host's LO - through all stages, which offset the tuner:
+//   a running sweep, the direct sampling conversion and DC avoidance.
+// zoom is not part of it: it has its own virtual LO, the zoom center - see zoom_host_LO().
+
+// host's LO from the tuner's LO - hw_LO usually is nxt.LO_freq
+int64_t host_LO_from_hw(int64_t hw_LO);
+// tuner's LO from the host's LO - keeping the DC spur away from tune_freq
+int64_t hw_LO_from_host(int64_t host_LO, int64_t tune_freq);
+// nxt.LO_freq from the host's LO - kept for the sweep's end, while sweeping.
+//   returns true, when nxt.LO_freq changed: trigger_control(CtrlFlags::freq) is up to the caller
+bool set_hw_LO_from_host(int64_t host_LO, int64_t tune_freq);
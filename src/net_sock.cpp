@@ -0,0 +1,231 @@
+
+#include "net_sock.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+
+
+static std::atomic_int net_init_count = 0;
+
+
+bool net_init()
+{
+#ifdef _WIN32
+  if (net_init_count.fetch_add(1) == 0)
+  {
+    WSADATA wsd;
+    if (WSAStartup(MAKEWORD(2, 2), &wsd) != 0)
+    {
+      net_init_count.fetch_sub(1);
+      return false;
+    }
+  }
+#else
+  net_init_count.fetch_add(1);
+#endif
+  return true;
+}
+
+void net_cleanup()
+{
+  if (net_init_count.fetch_sub(1) == 1)
+  {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+  }
+}
+
+bool net_set_nonblocking(SOCKET s, bool nonblocking)
+{
+#ifdef _WIN32
+  u_long mode = nonblocking ? 1 : 0;
+  return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+  int flags = fcntl(s, F_GETFL, 0);
+  if (flags < 0)
+    return false;
+  flags = nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+  return fcntl(s, F_SETFL, flags) == 0;
+#endif
+}
+
+void net_set_nodelay(SOCKET s)
+{
+  int one = 1;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+}
+
+int net_wait(SOCKET s, bool want_write, int timeout_ms)
+{
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(s, &fds);
+  struct timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  // first parameter is ignored on Windows
+  return select(int(s) + 1, want_write ? nullptr : &fds, want_write ? &fds : nullptr, nullptr, &tv);
+}
+
+bool net_send_all(SOCKET s, const void* data, int len, int timeout_ms)
+{
+  const char* p = (const char*)data;
+  const auto t_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (len > 0)
+  {
+    int r = net_wait(s, true, 50);
+    if (r < 0)
+      return false;
+    if (r == 0)
+    {
+      if (std::chrono::steady_clock::now() >= t_end)
+        return false;
+      continue;
+    }
+    r = send(s, p, len, 0);
+    if (r <= 0)
+    {
+      if (r < 0 && SOCK_LAST_ERROR() == SOCK_ERR_WOULDBLOCK)
+        continue;
+      return false;
+    }
+    p += r;
+    len -= r;
+  }
+  return true;
+}
+
+bool net_recv_all(SOCKET s, void* data, int len, int timeout_ms)
+{
+  char* p = (char*)data;
+  const auto t_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (len > 0)
+  {
+    int r = net_wait(s, false, 50);
+    if (r < 0)
+      return false;
+    if (r == 0)
+    {
+      if (std::chrono::steady_clock::now() >= t_end)
+        return false;
+      continue;
+    }
+    r = recv(s, p, len, 0);
+    if (r <= 0)
+    {
+      if (r < 0 && SOCK_LAST_ERROR() == SOCK_ERR_WOULDBLOCK)
+        continue;
+      return false;
+    }
+    p += r;
+    len -= r;
+  }
+  return true;
+}
+
+SOCKET net_connect(const char* host, int port, int timeout_ms)
+{
+  char port_str[16];
+  snprintf(port_str, 15, "%d", port);
+  port_str[15] = 0;
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  struct addrinfo* res = nullptr;
+  if (getaddrinfo(host, port_str, &hints, &res) != 0 || !res)
+    return INVALID_SOCKET;
+
+  SOCKET s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (s == INVALID_SOCKET)
+  {
+    freeaddrinfo(res);
+    return INVALID_SOCKET;
+  }
+
+  net_set_nonblocking(s, true);
+  int r = connect(s, res->ai_addr, (socklen_t)res->ai_addrlen);
+  freeaddrinfo(res);
+  if (r != 0)
+  {
+    // connect in progress
+    if (net_wait(s, true, timeout_ms) <= 0)
+    {
+      closesocket(s);
+      return INVALID_SOCKET;
+    }
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&err, &err_len);
+    if (err)
+    {
+      closesocket(s);
+      return INVALID_SOCKET;
+    }
+  }
+  net_set_nonblocking(s, false);
+  net_set_nodelay(s);
+  return s;
+}
+
+SOCKET net_listen(int port, bool bind_any)
+{
+  SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (s == INVALID_SOCKET)
+    return INVALID_SOCKET;
+
+  int one = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(uint16_t(port));
+  addr.sin_addr.s_addr = htonl(bind_any ? INADDR_ANY : INADDR_LOOPBACK);
+  if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 4) != 0)
+  {
+    closesocket(s);
+    return INVALID_SOCKET;
+  }
+  return s;
+}
+
+SOCKET net_udp_sender(const char* host, int port, int ttl, struct sockaddr_in& dest)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_protocol = IPPROTO_UDP;
+  struct addrinfo* res = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res)
+    return INVALID_SOCKET;
+  memcpy(&dest, res->ai_addr, sizeof(dest));
+  freeaddrinfo(res);
+  dest.sin_port = htons(uint16_t(port));
+
+  SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (s == INVALID_SOCKET)
+    return INVALID_SOCKET;
+
+  const uint32_t a = ntohl(dest.sin_addr.s_addr);
+  if ((a >> 28) == 0xE)   // 224.0.0.0/4
+  {
+#ifdef _WIN32
+    DWORD t = DWORD(ttl);
+#else
+    unsigned char t = (unsigned char)ttl;
+#endif
+    setsockopt(s, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&t, sizeof(t));
+  }
+
+  int sndbuf = 4 * 1024 * 1024;
+  setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*)&sndbuf, sizeof(sndbuf));
+  net_set_nonblocking(s, true);
+  return s;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// minimal socket portability layer - include before any <Windows.h> !
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+typedef int socklen_t;
+#define SOCK_LAST_ERROR()       WSAGetLastError()
+#define SOCK_ERR_WOULDBLOCK     WSAEWOULDBLOCK
+
+#else
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET          (-1)
+#define SOCKET_ERROR            (-1)
+#define closesocket             close
+#define SOCK_LAST_ERROR()       errno
+#define SOCK_ERR_WOULDBLOCK     EWOULDBLOCK
+
+#endif
+
+#include <stdint.h>
+
+
+// WSAStartup() / WSACleanup() reference counted
+bool net_init();
+void net_cleanup();
+
+bool net_set_nonblocking(SOCKET s, bool nonblocking);
+void net_set_nodelay(SOCKET s);
+
+// wait until socket is readable (want_write == false) or writable.
+// returns > 0 if ready, 0 on timeout, < 0 on error
+int net_wait(SOCKET s, bool want_write, int timeout_ms);
+
+// send/receive all len bytes - or fail. returns false on error or timeout
+bool net_send_all(SOCKET s, const void* data, int len, int timeout_ms);
+bool net_recv_all(SOCKET s, void* data, int len, int timeout_ms);
+
+// resolve host name or address and connect with timeout
+SOCKET net_connect(const char* host, int port, int timeout_ms);
+
+// listening tcp socket. bind_any == false: listen on localhost only
+SOCKET net_listen(int port, bool bind_any);
+
+// non-blocking udp socket for sending to host:port - resolved into dest.
+// ttl is applied for multicast destinations
+SOCKET net_udp_sender(const char* host, int port, int ttl, struct sockaddr_in& dest);
@@ -0,0 +1,220 @@
+
+#include "rate_qual.h"
+#include "device_profile.h"
+#include "control.h"
+#include "rates.h"
+#include "gui_dlg.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define CHECK_MS          2000      // streaming per candidate rate
+#define FIRST_CANDIDATE   2400000   // lower rates are known to work
+
+
+std::atomic_int rate_qual_max = 0;
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+static std::mutex mtx;    // status
+static std::thread worker;
+static std::atomic_bool running = false;
+static std::atomic_bool abort_req = false;
+static char status[160] = "not qualified";
+
+struct CounterCheck
+{
+  rtlsdr_dev_t* dev;
+  std::atomic_bool stop;
+  bool init;
+  uint8_t next;
+  uint64_t bytes;
+  uint64_t gaps;      // discontinuities of the counter
+  uint64_t skipped;   // bytes skipped over the gaps - modulo 256
+};
+
+
+static void set_status(const char* fmt, double a, double b = 0.0, unsigned long long c = 0)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  snprintf(status, sizeof(status) - 1, fmt, a, b, c);
+  status[sizeof(status) - 1] = 0;
+}
+
+static std::string computer_name()
+{
+  char name[MAX_COMPUTERNAME_LENGTH + 1];
+  DWORD n = MAX_COMPUTERNAME_LENGTH + 1;
+  if (!GetComputerNameA(name, &n))
+    return std::string();
+  return std::string(name, n);
+}
+
+static void counter_callback(unsigned char* buf, uint32_t len, void* ctx)
+{
+  CounterCheck& c = *((CounterCheck*)ctx);
+  if (c.stop.load())
+  {
+    rtlsdr_cancel_async(c.dev);
+    return;
+  }
+  if (!c.init && len)
+  {
+    c.next = buf[0];
+    c.init = true;
+  }
+  for (uint32_t k = 0; k < len; ++k)
+  {
+    if (buf[k] != c.next)
+    {
+      ++c.gaps;
+      c.skipped += uint8_t(buf[k] - c.next);
+      c.next = buf[k];
+    }
+    ++c.next;
+  }
+  c.bytes += len;
+}
+
+static bool check_rate(rtlsdr_dev_t* dev, int srate, int buf_num, int buf_len, CounterCheck& c)
+{
+  c.dev = dev;
+  c.stop = false;
+  c.init = false;
+  c.next = 0;
+  c.bytes = c.gaps = c.skipped = 0;
+  {
+    std::lock_guard<std::mutex> lock(control_mtx);
+    if (rtlsdr_set_sample_rate(dev, srate) < 0 || rtlsdr_reset_buffer(dev) < 0)
+      return false;
+  }
+
+  std::thread reader([&]() { rtlsdr_read_async(dev, counter_callback, &c, buf_num, buf_len); });
+  for (int ms = 0; ms < CHECK_MS && !abort_req.load(); ms += 100)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  c.stop = true;
+  rtlsdr_cancel_async(dev);
+  reader.join();
+  return c.bytes && !c.gaps;
+}
+
+// Control_Changes() is refused while running: the changes queue up in somewhat_changed
+static void qualify(rtlsdr_dev_t* dev, std::string serial, int buf_num, int buf_len)
+{
+  int below = 0;        // highest rate below the candidates
+  int max_srate = 0;
+  int failed_srate = 0;
+  CounterCheck c;
+
+  {
+    std::lock_guard<std::mutex> lock(control_mtx);
+    rtlsdr_set_testmode(dev, 1);
+  }
+  for (unsigned idx = 0; idx < rates::N && !abort_req.load(); ++idx)
+  {
+    const int srate = rates::tab[idx].valueInt;
+    if (srate < FIRST_CANDIDATE)
+    {
+      below = srate;
+      continue;
+    }
+    set_status("running: %.3f Msps", srate / 1E6);
+    if (!check_rate(dev, srate, buf_num, buf_len, c))
+    {
+      if (!abort_req.load())
+        failed_srate = srate;
+      break;
+    }
+    max_srate = srate;
+  }
+  {
+    // back to the rate, which 'last' claims. queued changes of nxt follow below
+    std::lock_guard<std::mutex> lock(control_mtx);
+    rtlsdr_set_testmode(dev, 0);
+    rtlsdr_set_sample_rate(dev, rates::tab[last.srate_idx].valueInt);
+  }
+
+  if (abort_req.load())
+  {
+    // StartHW() commands everything - or the device gets closed
+    set_status("stopped before completion", 0.0);
+    running = false;
+    return;
+  }
+
+  if (!max_srate)
+    max_srate = below;    // not verified - but all candidates failed
+  DeviceProfile p;
+  device_profile_get(serial.c_str(), p);
+  p.max_srate = max_srate;
+  p.max_srate_host = computer_name();
+  device_profile_set(serial.c_str(), p);
+  rate_qual_max = max_srate;
+
+  if (failed_srate)
+    set_status("max %.3f Msps - %.3f Msps skipped %llu bytes", max_srate / 1E6, failed_srate / 1E6, (unsigned long long)c.skipped);
+  else
+    set_status("max %.3f Msps - all rates loss-free", max_srate / 1E6);
+  running = false;
+  trigger_control(0);   // the changes queued while running
+
+  // host and GUI: refresh the list of samplerates
+  if (gpfnExtIOCallbackPtr)
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SRATES);
+  post_update_gui_init();
+}
+
+
+void rate_qual_load(const DeviceProfile& p)
+{
+  if (p.max_srate && p.max_srate_host == computer_name())
+    rate_qual_max = p.max_srate;
+  else
+    rate_qual_max = 0;
+}
+
+bool rate_qual_start(rtlsdr_dev_t* dev, const char* serial, int buf_num, int buf_len)
+{
+  if (!dev || running.load())
+    return false;
+  if (worker.joinable())
+    worker.join();
+  abort_req = false;
+  running = true;
+  set_status("starting", 0.0);
+  worker = std::thread(qualify, dev, std::string(serial ? serial : ""), buf_num, buf_len);
+  return true;
+}
+
+void rate_qual_stop()
+{
+  abort_req = true;
+  if (worker.joinable())
+    worker.join();
+}
+
+bool rate_qual_running()
+{
+  return running.load();
+}
+
+void rate_qual_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  snprintf(s, len - 1, "%s", status);
+  s[len - 1] = 0;
+}
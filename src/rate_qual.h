@@ -0,0 +1,34 @@
+#pragma once
+
+#include <rtl-sdr.h>
+
+#include "device_profile.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// qualification of the samplerates from 2.4 Msps up - per device and computer:
+//   the RTL2832U's test mode delivers an 8 bit counter instead of samples.
+//   every byte is checked for continuity - at each candidate rate, from low to high,
+//   until the first rate loses bytes. this replaces running rtl_test.
+// the highest loss-free rate is stored in the device's profile, together with the
+//   computer's name: USB host controllers and hubs differ.
+// rates above are hidden from the host's list and marked in the GUI.
+
+extern std::atomic_int rate_qual_max;   // qualified max samplerate of the open device. 0: not qualified
+
+inline bool rate_qual_stable(int srate) { return !rate_qual_max.load() || srate <= rate_qual_max.load(); }
+
+// open_selected_rtl_device(): the stored max rate of the device's profile - when qualified on this computer
+void rate_qual_load(const DeviceProfile& p);
+
+// from settings - while not streaming: starts the qualification in its own thread,
+//   with buf_num x buf_len USB transfers
+bool rate_qual_start(rtlsdr_dev_t* dev, const char* serial, int buf_num, int buf_len);
+// StartHW(), close_rtl_device(): stops a running qualification - waiting for the device
+void rate_qual_stop();
+bool rate_qual_running();
+
+// "running: 2.56 Msps" or "max 2.56 Msps - 2.646 Msps lost 1234 bytes"
+void rate_qual_format_stats(char* s, size_t len);
@@ -0,0 +1,216 @@
+
+#include "resampler.h"
+#include "ds_hilbert.h"
+#include "dc_avoid.h"
+#include "rate_qual.h"
+#include "control.h"
+#include "rates.h"
+
+#include <stdio.h>
+#include <vector>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define MAX_STAGES        6         // decimation up to 64
+#define LOSS_LIMIT        2400000   // higher ADC rates lose samples - without qualification
+#define MAX_RATIO         0.8       // fractional: room for the anti-alias transition
+#define MIN_RATIO         0.2       // fractional: the taps grow with 1 / ratio - up to FractionalResampler::MAX_TAPS
+#define HALFBAND_MACS     26        // per complex output sample: 12 folded taps + center
+
+
+std::atomic_int resample_rate = 0;
+
+// only accessed from RtlSdrCallback()
+static int cur_out_rate = 0;
+static int cur_adc_rate = 0;
+static int cur_decimation = 1;
+static bool cur_exact = true;
+static SampleFormat cur_fmt = SAMPLE_U8;
+static HalfbandDecimator stages[MAX_STAGES];
+static FractionalResampler frac;
+static NCO nco;
+static std::vector<float> work_re, work_im, res_re, res_im;
+static std::vector<uint8_t> out_buf[2];
+static unsigned out_idx = 0;
+static unsigned out_fill = 0;   // I/Q pairs
+
+static std::atomic_uint64_t stat_cpu_ns = 0;
+static std::atomic_uint64_t stat_in_samples = 0;
+
+
+bool resample_active()
+{
+  return resample_rate.load() > 0 && !ds_hilbert_active();
+}
+
+// largest power of 2 - keeping a fractional ratio <= MAX_RATIO.
+//   0: adc_rate doesn't fit - also with a ratio below MIN_RATIO, when the decimation is at its maximum
+static int decimation_for(int adc_rate, int out_rate)
+{
+  if (adc_rate < out_rate)
+    return 0;
+  int D = 1;
+  while (D < (1 << MAX_STAGES) && int64_t(adc_rate) >= int64_t(out_rate) * D * 2)
+    D *= 2;
+  if (int64_t(out_rate) * D != adc_rate && double(out_rate) * D > MAX_RATIO * adc_rate)
+    D /= 2;
+  if (double(out_rate) * D < MIN_RATIO * adc_rate)
+    return 0;
+  return D;
+}
+
+bool resample_find_plan(int out_rate, ResamplePlan& plan)
+{
+  bool found = false;
+  const int loss_limit = rate_qual_max.load() ? rate_qual_max.load() : LOSS_LIMIT;
+  for (int idx = 0; idx < int(rates::N); ++idx)
+  {
+    const int adc_rate = rates::tab[idx].valueInt;
+    if (adc_rate > loss_limit)
+      continue;
+    const int D = decimation_for(adc_rate, out_rate);
+    if (!D)
+      continue;
+    const double ratio = double(out_rate) * D / adc_rate;
+    double macs = 0.0;
+    for (int d = 2; d <= D; d *= 2)
+      macs += double(HALFBAND_MACS) * adc_rate / d;
+    if (ratio != 1.0)
+      macs += double(FractionalResampler::macs_per_output(ratio)) * 2.0 * out_rate;
+    if (!found || macs < plan.macs)
+    {
+      plan.srate_idx = idx;
+      plan.decimation = D;
+      plan.ratio = ratio;
+      plan.macs = macs;
+      found = true;
+    }
+  }
+  return found;
+}
+
+ResamplePlan resample_plan()
+{
+  ResamplePlan plan = { 0, 1, 1.0, 0.0 };
+  if (resample_rate.load() > 0)
+    resample_find_plan(resample_rate.load(), plan);
+  return plan;
+}
+
+
+void resample_reset()
+{
+  cur_out_rate = 0;
+}
+
+static void resample_init(int adc_rate, int out_rate, uint32_t len, SampleFormat fmt)
+{
+  cur_out_rate = out_rate;
+  cur_adc_rate = adc_rate;
+  cur_fmt = fmt;
+  cur_decimation = decimation_for(adc_rate, out_rate);
+  if (!cur_decimation)
+    cur_decimation = 1;   // transient, until the ADC rate of the plan is set
+  cur_exact = (int64_t(out_rate) * cur_decimation == adc_rate);
+  if (!cur_exact && !frac.init(unsigned(adc_rate), unsigned(out_rate * cur_decimation)))
+    cur_exact = true;
+  for (unsigned k = 0; k < MAX_STAGES; ++k)
+    stages[k].reset();
+  nco.reset();
+  work_re.resize(len / 2);
+  work_im.resize(len / 2);
+  res_re.resize(len / 2);
+  res_im.resize(len / 2);
+  out_buf[0].resize(size_t(len / 2) * dsp_sample_pair_size(fmt));
+  out_buf[1].resize(size_t(len / 2) * dsp_sample_pair_size(fmt));
+  out_idx = 0;
+  out_fill = 0;
+  stat_cpu_ns = 0;
+  stat_in_samples = 0;
+}
+
+const void* resample_feed(const uint8_t* buf, uint32_t len, SampleFormat fmt)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  const int out_rate = resample_rate.load();
+  const int adc_rate = rates::tab[last.srate_idx].valueInt;
+  if (out_rate != cur_out_rate || adc_rate != cur_adc_rate || fmt != cur_fmt || work_re.size() != len / 2)
+    resample_init(adc_rate, out_rate, len, fmt);
+
+  const unsigned n_pairs = len / 2;
+  float* re = work_re.data();
+  float* im = work_im.data();
+  for (unsigned k = 0; k < n_pairs; ++k)
+  {
+    re[k] = (float(buf[2 * k]) - 127.5F) * (1.0F / 127.5F);
+    im[k] = (float(buf[2 * k + 1]) - 127.5F) * (1.0F / 127.5F);
+  }
+  // shift back the LO offset of DC avoidance
+  const int64_t dc_offset = dc_avoid_tuned_offset();
+  if (dc_offset)
+  {
+    nco.set_freq(double(dc_offset) / adc_rate);
+    nco.mix(re, im, re, im, n_pairs);
+  }
+  unsigned n = n_pairs;
+  for (unsigned s = 0; (1 << (s + 1)) <= cur_decimation && s < MAX_STAGES; ++s)
+    n = stages[s].process(re, im, n);
+  if (!cur_exact)
+  {
+    n = frac.process(re, im, n, res_re.data(), res_im.data());
+    re = res_re.data();
+    im = res_im.data();
+  }
+
+  // collect into host blocks of n_pairs
+  const void* complete = nullptr;
+  // the fractional stage's lowpass adds resolution, too
+  const float pcm16_scale = dsp_pcm16_scale(double(cur_adc_rate) / cur_out_rate);
+  for (unsigned k = 0; k < n; )
+  {
+    const unsigned c = (n - k < n_pairs - out_fill) ? (n - k) : (n_pairs - out_fill);
+    dsp_store_samples(re + k, im + k, c, out_buf[out_idx].data(), out_fill, fmt, pcm16_scale);
+    k += c;
+    out_fill += c;
+    if (out_fill == n_pairs)
+    {
+      complete = out_buf[out_idx].data();
+      out_idx ^= 1;
+      out_fill = 0;
+    }
+  }
+
+  const auto t1 = std::chrono::steady_clock::now();
+  stat_cpu_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  stat_in_samples += n_pairs;
+  return complete;
+}
+
+
+void resample_format_stats(char* s, size_t len)
+{
+  if (resample_rate.load() <= 0)
+  {
+    snprintf(s, len - 1, "off");
+    s[len - 1] = 0;
+    return;
+  }
+  ResamplePlan plan;
+  if (!resample_find_plan(resample_rate.load(), plan))
+  {
+    snprintf(s, len - 1, "no ADC rate for %d Sps", resample_rate.load());
+    s[len - 1] = 0;
+    return;
+  }
+  const int srate = rates::tab[last.srate_idx].valueInt;
+  const uint64_t in_samples = stat_in_samples.load();
+  const double load = in_samples ? (stat_cpu_ns.load() * 1E-9) / (double(in_samples) / srate) : 0.0;
+  snprintf(s, len - 1, "ADC %s / %d, ratio %.6f => %d Sps, est. %.1f MMAC/s, %.1f %% CPU",
+    rates::tab[plan.srate_idx].name, plan.decimation, plan.ratio, resample_rate.load(), plan.macs * 1E-6, 100.0 * load);
+  s[len - 1] = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "dsp.h"
+
+// resampler: the host's stream at an arbitrary output rate - independent of rates::tab.
+// the plan: the best ADC rate from rates::tab up to the loss limit (2.4 Msps - or the qualified max),
+//   decimation by a power of 2 with half-band filters, then a polyphase fractional
+//   resampler with the exact ratio. the cheapest plan - in MACs - is chosen.
+// the host sees only the output rate. the host's block size is kept.
+// zoom is off, while resampling. the direct sampling conversion takes precedence.
+
+extern std::atomic_int resample_rate;     // 0: off, else output rate in Hz
+
+struct ResamplePlan
+{
+  int srate_idx;      // ADC rate: rates::tab[srate_idx]
+  int decimation;     // half-band cascade: 1 .. 64
+  double ratio;       // fractional: output rate / (ADC rate / decimation) - 1: none
+  double macs;        // estimated multiply-accumulates per second
+};
+
+bool resample_active();
+// false, if no ADC rate fits
+bool resample_find_plan(int out_rate, ResamplePlan& plan);
+// plan for resample_rate
+ResamplePlan resample_plan();
+
+// called from RtlSdrCallback(): returns a complete host block of len / 2 I/Q pairs
+//   in format fmt - or nullptr, while collecting
+const void* resample_feed(const uint8_t* buf, uint32_t len, SampleFormat fmt);
+void resample_reset();
+
+// "ADC x Msps / D, ratio r => y Sps, est. m MMAC/s, z % CPU"
+void resample_format_stats(char* s, size_t len);
@@ -0,0 +1,425 @@
+
+#include "net_sock.h"
+
+#include "rtl_tcp_client.h"
+#include "rtl_tcp_proto.h"
+#include "iq_ring.h"
+#include "iq_codec.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+// jitter buffer for ~ 7 seconds at 2.4 MSps
+#define JITTER_RING_SIZE      (32 * 1024 * 1024)
+#define RECV_CHUNK            (64 * 1024)
+#define ADAPT_WINDOW_MS       10000
+// no valid frame after requesting compression: server does not support it
+#define MAX_SYNC_SEARCH       (4 * 1024 * 1024)
+
+
+char rtl_tcp_client_host[256] = { 0 };
+std::atomic_int rtl_tcp_client_port = rtl_tcp::DEFAULT_PORT;
+std::atomic_int rtl_tcp_client_jitter_min_ms = 100;
+std::atomic_int rtl_tcp_client_jitter_max_ms = 2000;
+std::atomic_int rtl_tcp_client_compression = 0;
+std::atomic_int rtl_tcp_client_lossy_bits = 4;
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+static SOCKET cli_sock = INVALID_SOCKET;
+static std::mutex send_mtx;
+static bool batching = false;               // commands collect in batch_buf - under send_mtx
+static std::vector<uint8_t> batch_buf;
+static std::thread recv_thread;
+static std::atomic_bool connected = false;
+static std::atomic_bool terminate_Recv_Thread = false;
+static std::atomic_bool streaming = false;    // receiver fills the jitter buffer
+static std::atomic_bool reset_ring = false;   // receiver resets the jitter buffer - it is the only writer
+static std::atomic_bool cancel_async = false;
+static std::atomic_bool compressed = false;   // expecting frames
+
+static IQRing jitter_ring;
+
+static std::atomic_int stat_depth_ms = 0;
+static std::atomic_int stat_target_ms = 0;
+static std::atomic_uint64_t stat_underruns = 0;
+static std::atomic_uint64_t stat_overruns = 0;
+static std::atomic_uint64_t stat_received = 0;
+static IQCodecStats codec_stats;
+
+
+bool rtl_tcp_client_is_configured()
+{
+  return rtl_tcp_client_host[0] != 0;
+}
+
+bool rtl_tcp_client_is_connected()
+{
+  return connected.load();
+}
+
+
+// parse compressed frames from buf and append decoded samples while streaming.
+// returns the number of consumed bytes
+static size_t parse_frames(const uint8_t* buf, size_t len, IQDecoder& dec,
+                           std::vector<uint8_t>& raw, bool& synced, uint64_t& search_len)
+{
+  char acMsg[256];
+  size_t pos = 0;
+  while (len - pos >= size_t(iq_codec::HEADER_LEN))
+  {
+    iq_codec::Header h;
+    if (!iq_codec::get_header(buf + pos, h))
+    {
+      if (synced)
+      {
+        SDRLOG(extHw_MSG_WARNING, "rtl_tcp client: lost frame sync");
+        ++codec_stats.frame_errors;
+        synced = false;
+      }
+      ++pos;
+      ++search_len;
+      continue;
+    }
+    const size_t frame_len = iq_codec::HEADER_LEN + h.payload_len;
+    if (len - pos < frame_len)
+      break;    // wait for the rest
+    if (!synced)
+      SDRLG(extHw_MSG_DEBUG, "rtl_tcp client: frame sync after %llu bytes", (unsigned long long)search_len);
+    synced = true;
+    search_len = 0;
+    if (dec.decode(h, buf + pos + iq_codec::HEADER_LEN, raw, &codec_stats)
+      && streaming.load(std::memory_order_relaxed))
+      jitter_ring.append(raw.data(), raw.size());
+    pos += frame_len;
+  }
+  return pos;
+}
+
+static void Recv_ThreadProc()
+{
+  char acMsg[256];
+  std::vector<uint8_t> buf(RECV_CHUNK);
+  std::vector<uint8_t> frames;    // unparsed compressed bytes
+  std::vector<uint8_t> raw;
+  IQDecoder dec;
+  bool synced = false;
+  uint64_t search_len = 0;
+  uint64_t stream_pos = 0;        // for I/Q alignment of raw samples
+  bool was_streaming = false;
+
+  while (!terminate_Recv_Thread.load())
+  {
+    if (reset_ring.load())
+    {
+      jitter_ring.reset();
+      was_streaming = false;    // realign to I with the next append
+      reset_ring = false;
+    }
+    int r = net_wait(cli_sock, false, 100);
+    if (r == 0)
+      continue;
+    if (r > 0)
+      r = recv(cli_sock, (char*)buf.data(), RECV_CHUNK, 0);
+    if (r <= 0)
+    {
+      if (r < 0 && SOCK_LAST_ERROR() == SOCK_ERR_WOULDBLOCK)
+        continue;
+      SDRLG(extHw_MSG_ERROR, "rtl_tcp client: connection to %s lost", rtl_tcp_client_host);
+      break;
+    }
+    stat_received += uint64_t(r);
+
+    if (compressed.load(std::memory_order_relaxed))
+    {
+      frames.insert(frames.end(), buf.data(), buf.data() + r);
+      const size_t used = parse_frames(frames.data(), frames.size(), dec, raw, synced, search_len);
+      frames.erase(frames.begin(), frames.begin() + used);
+      if (!synced && search_len > MAX_SYNC_SEARCH && !codec_stats.frames.load())
+      {
+        SDRLG(extHw_MSG_WARNING, "rtl_tcp client: %s does not send compressed frames. using raw samples", rtl_tcp_client_host);
+        compressed = false;
+        frames.clear();
+      }
+      stream_pos += uint64_t(r);
+      continue;
+    }
+
+    // rtl_tcp streams from connect on: drop the samples while not streaming
+    size_t off = 0;
+    const bool is_streaming = streaming.load(std::memory_order_relaxed);
+    if (is_streaming && !was_streaming && (stream_pos & 1))
+      off = 1;    // start with I
+    was_streaming = is_streaming;
+    stream_pos += uint64_t(r);
+    if (is_streaming && size_t(r) > off)
+      jitter_ring.append(buf.data() + off, size_t(r) - off);
+  }
+
+  connected = false;
+  jitter_ring.wakeup();
+}
+
+
+bool rtl_tcp_client_connect(uint32_t& tuner_type, uint32_t& gain_count)
+{
+  char acMsg[256];
+  rtl_tcp_client_disconnect();
+
+  if (!rtl_tcp_client_is_configured())
+    return false;
+
+  if (!jitter_ring.alloc(JITTER_RING_SIZE))
+  {
+    SDRLOG(extHw_MSG_ERROR, "rtl_tcp client: could not allocate jitter buffer");
+    return false;
+  }
+
+  if (!net_init())
+  {
+    SDRLOG(extHw_MSG_ERROR, "rtl_tcp client: error initializing network");
+    return false;
+  }
+
+  SDRLG(extHw_MSG_DEBUG, "rtl_tcp client: connecting to %s:%d ..", rtl_tcp_client_host, rtl_tcp_client_port.load());
+  cli_sock = net_connect(rtl_tcp_client_host, rtl_tcp_client_port.load(), 3000);
+  if (cli_sock == INVALID_SOCKET)
+  {
+    SDRLG(extHw_MSG_ERROR, "rtl_tcp client: could not connect to %s:%d", rtl_tcp_client_host, rtl_tcp_client_port.load());
+    net_cleanup();
+    return false;
+  }
+
+  uint8_t info[rtl_tcp::DONGLE_INFO_LEN];
+  if (!net_recv_all(cli_sock, info, sizeof(info), 3000)
+    || !rtl_tcp::get_dongle_info(info, tuner_type, gain_count))
+  {
+    SDRLG(extHw_MSG_ERROR, "rtl_tcp client: %s did not send a valid dongle info", rtl_tcp_client_host);
+    closesocket(cli_sock);
+    cli_sock = INVALID_SOCKET;
+    net_cleanup();
+    return false;
+  }
+  SDRLG(extHw_MSG_DEBUG, "rtl_tcp client: connected. tuner type %u with %u gains",
+    unsigned(tuner_type), unsigned(gain_count));
+
+  streaming = false;
+  connected = true;
+  codec_stats.reset();
+  const int comp = rtl_tcp_client_compression.load();
+  compressed = (comp == iq_codec::MODE_LOSSLESS || comp == iq_codec::MODE_LOSSY);
+  terminate_Recv_Thread = false;
+  recv_thread = std::thread(Recv_ThreadProc);
+
+  if (compressed.load())
+  {
+    const uint32_t bits = uint32_t(rtl_tcp_client_lossy_bits.load());
+    SDRLG(extHw_MSG_DEBUG, "rtl_tcp client: requesting compression mode %d, bits %u", comp, unsigned(bits));
+    rtl_tcp_client_send_cmd(rtl_tcp::SET_COMPRESSION, uint32_t(comp) | (bits << 8));
+  }
+  return true;
+}
+
+void rtl_tcp_client_disconnect()
+{
+  if (cli_sock == INVALID_SOCKET)
+    return;
+  rtl_tcp_client_cancel_async();
+  terminate_Recv_Thread = true;
+  if (recv_thread.joinable())
+    recv_thread.join();
+  closesocket(cli_sock);
+  cli_sock = INVALID_SOCKET;
+  connected = false;
+  net_cleanup();
+}
+
+bool rtl_tcp_client_send_cmd(uint8_t cmd, uint32_t param)
+{
+  if (!connected.load())
+    return false;
+  uint8_t buf[rtl_tcp::CMD_LEN];
+  rtl_tcp::put_cmd(buf, cmd, param);
+  std::lock_guard<std::mutex> lk(send_mtx);
+  if (batching)
+  {
+    batch_buf.insert(batch_buf.end(), buf, buf + sizeof(buf));
+    return true;
+  }
+  return net_send_all(cli_sock, buf, sizeof(buf), 1000);
+}
+
+void rtl_tcp_client_batch_begin()
+{
+  std::lock_guard<std::mutex> lk(send_mtx);
+  batching = true;
+  batch_buf.clear();
+}
+
+bool rtl_tcp_client_batch_end()
+{
+  std::lock_guard<std::mutex> lk(send_mtx);
+  batching = false;
+  if (batch_buf.empty())
+    return true;
+  const bool ok = connected.load() && net_send_all(cli_sock, batch_buf.data(), int(batch_buf.size()), 1000);
+  batch_buf.clear();
+  return ok;
+}
+
+
+int rtl_tcp_client_read_async(rtlsdr_read_async_cb_t cb, void* ctx, uint32_t buf_len)
+{
+  using clock = std::chrono::steady_clock;
+  char acMsg[256];
+  if (!connected.load() || !cb || !buf_len)
+    return -1;
+
+  std::vector<uint8_t> block(buf_len);
+
+  streaming = false;
+  reset_ring = true;
+  while (reset_ring.load() && connected.load())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  uint64_t rpos = jitter_ring.write_pos();
+  cancel_async = false;
+  streaming = true;
+
+  int target_ms = rtl_tcp_client_jitter_min_ms.load();
+  bool prefetching = true;
+  clock::time_point next_deadline = clock::now();
+  clock::time_point window_start = next_deadline;
+  uint64_t window_min_depth = ~uint64_t(0);
+
+  while (!cancel_async.load() && connected.load())
+  {
+    const int min_ms = rtl_tcp_client_jitter_min_ms.load();
+    const int max_ms = rtl_tcp_client_jitter_max_ms.load();
+    const double bytes_per_ms = rates::tab[last.srate_idx].valueInt * 2 / 1000.0;
+    const uint64_t target_bytes = uint64_t(target_ms * bytes_per_ms) & ~uint64_t(1);  // whole I/Q pairs
+    const auto block_period = std::chrono::microseconds(int64_t(buf_len * 1000.0 / bytes_per_ms));
+
+    uint64_t depth = jitter_ring.lag(rpos);
+    if (depth > jitter_ring.lag_limit())
+    {
+      // far behind - drop the oldest samples
+      ++stat_overruns;
+      rpos = (jitter_ring.write_pos() - target_bytes) & ~uint64_t(1);   // keep starting with I
+      depth = jitter_ring.lag(rpos);
+    }
+    stat_depth_ms = int(depth / bytes_per_ms);
+    stat_target_ms = target_ms;
+
+    if (prefetching)
+    {
+      if (depth < target_bytes + buf_len)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        continue;
+      }
+      prefetching = false;
+      next_deadline = clock::now();
+      window_start = next_deadline;
+      window_min_depth = ~uint64_t(0);
+    }
+
+    if (depth < buf_len)
+    {
+      // underrun: grow the target and prefetch again
+      ++stat_underruns;
+      target_ms = (target_ms * 3) / 2 + 10;
+      if (target_ms > max_ms)
+        target_ms = max_ms;
+      prefetching = true;
+      SDRLG(extHw_MSG_DEBUG, "rtl_tcp client: jitter buffer underrun #%llu. new target %d ms",
+        (unsigned long long)stat_underruns.load(), target_ms);
+      continue;
+    }
+
+    const clock::time_point now = clock::now();
+    // deliver in cadence - or catch up, when the remote clock runs faster
+    if (now < next_deadline && depth < 2 * target_bytes + buf_len)
+    {
+      std::this_thread::sleep_until(next_deadline);
+      continue;
+    }
+
+    jitter_ring.copy_out(rpos, block.data(), buf_len);
+    if (!jitter_ring.is_valid(rpos))
+      continue;   // overwritten meanwhile: overrun handling above
+    rpos += buf_len;
+    cb(block.data(), buf_len, ctx);
+
+    next_deadline += block_period;
+    if (next_deadline + block_period < now)
+      next_deadline = now;    // no burst after a stall
+
+    // shrink the target slowly, when the buffer never got close to an underrun
+    if (depth < window_min_depth)
+      window_min_depth = depth;
+    if (now - window_start >= std::chrono::milliseconds(ADAPT_WINDOW_MS))
+    {
+      const int margin_ms = int((window_min_depth - buf_len) / bytes_per_ms);
+      if (margin_ms > target_ms / 2 && target_ms > min_ms)
+      {
+        target_ms = (target_ms * 9) / 10;
+        if (target_ms < min_ms)
+          target_ms = min_ms;
+      }
+      window_start = now;
+      window_min_depth = ~uint64_t(0);
+    }
+  }
+
+  streaming = false;
+  return connected.load() ? 0 : -1;
+}
+
+void rtl_tcp_client_cancel_async()
+{
+  cancel_async = true;
+  jitter_ring.wakeup();
+}
+
+void rtl_tcp_client_get_stats(RtlTcpClientStats& stats)
+{
+  stats.depth_ms = stat_depth_ms.load();
+  stats.target_ms = stat_target_ms.load();
+  stats.underruns = stat_underruns.load();
+  stats.overruns = stat_overruns.load();
+  stats.received_bytes = stat_received.load();
+  stats.compressed = compressed.load();
+}
+
+void rtl_tcp_client_codec_stats(char* s, size_t len)
+{
+  codec_stats.format(s, len);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <rtl-sdr.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// backend receiving I/Q from a remote rtl_tcp server - instead of local USB.
+// a receiver thread fills a jitter buffer, the RX thread hands out blocks
+//   to the callback in the cadence of the samplerate - after prefetching.
+//   the prefetch target adapts to the network: it grows on underruns
+//   and shrinks slowly, when the buffer stays well filled.
+
+extern char rtl_tcp_client_host[256];          // "" == disabled: use local USB devices
+extern std::atomic_int rtl_tcp_client_port;
+extern std::atomic_int rtl_tcp_client_jitter_min_ms;
+extern std::atomic_int rtl_tcp_client_jitter_max_ms;
+extern std::atomic_int rtl_tcp_client_compression;    // 0 == raw, 1 == lossless, 2 == lossy. see iq_codec.h
+extern std::atomic_int rtl_tcp_client_lossy_bits;     // 1 .. 7 bits per sample
+
+struct RtlTcpClientStats
+{
+  int depth_ms;
+  int target_ms;
+  uint64_t underruns;
+  uint64_t overruns;
+  uint64_t received_bytes;
+  bool compressed;            // receiving compressed frames
+};
+
+bool rtl_tcp_client_is_configured();
+bool rtl_tcp_client_is_connected();
+
+// connect and retrieve the dongle info
+bool rtl_tcp_client_connect(uint32_t& tuner_type, uint32_t& gain_count);
+void rtl_tcp_client_disconnect();
+
+bool rtl_tcp_client_send_cmd(uint8_t cmd, uint32_t param);
+// between begin and end, commands are collected - and sent with one send()
+void rtl_tcp_client_batch_begin();
+bool rtl_tcp_client_batch_end();
+
+// blocks - like rtlsdr_read_async() - until rtl_tcp_client_cancel_async().
+// the delivery cadence follows the commanded samplerate last.srate_idx
+int rtl_tcp_client_read_async(rtlsdr_read_async_cb_t cb, void* ctx, uint32_t buf_len);
+void rtl_tcp_client_cancel_async();
+
+void rtl_tcp_client_get_stats(RtlTcpClientStats& stats);
+void rtl_tcp_client_codec_stats(char* s, size_t len);
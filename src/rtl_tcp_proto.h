@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+// wire protocol of rtl_tcp - see librtlsdr/src/rtl_tcp.c
+//
+// server -> client: 12 bytes dongle info at connect, then raw 8-bit I/Q
+// client -> server: 5 bytes per command: command byte + 32 bit parameter,
+//   both in network byte order (big endian)
+
+struct rtl_tcp
+{
+  static constexpr uint8_t SET_FREQUENCY = 0x01;
+  static constexpr uint8_t SET_SAMPLE_RATE = 0x02;
+  static constexpr uint8_t SET_GAIN_MODE = 0x03;
+  static constexpr uint8_t SET_GAIN = 0x04;
+  static constexpr uint8_t SET_FREQUENCY_CORRECTION = 0x05;
+  static constexpr uint8_t SET_IF_STAGE = 0x06;
+  static constexpr uint8_t SET_TEST_MODE = 0x07;
+  static constexpr uint8_t SET_AGC_MODE = 0x08;
+  static constexpr uint8_t SET_DIRECT_SAMPLING = 0x09;
+  static constexpr uint8_t SET_OFFSET_TUNING = 0x0A;
+  static constexpr uint8_t SET_RTL_CRYSTAL = 0x0B;
+  static constexpr uint8_t SET_TUNER_CRYSTAL = 0x0C;
+  static constexpr uint8_t SET_TUNER_GAIN_BY_INDEX = 0x0D;
+  static constexpr uint8_t SET_BIAS_TEE = 0x0E;
+  // extensions of hayguen/librtlsdr's rtl_tcp
+  static constexpr uint8_t SET_TUNER_BANDWIDTH = 0x40;
+  static constexpr uint8_t SET_TUNER_BW_IF_CENTER = 0x45;
+  static constexpr uint8_t SET_TUNER_IF_MODE = 0x46;
+  static constexpr uint8_t SET_SIDEBAND = 0x47;
+  static constexpr uint8_t GPIO_SET_OUTPUT_MODE = 0x49;
+  static constexpr uint8_t GPIO_WRITE_PIN = 0x52;
+  static constexpr uint8_t SET_FREQ_HI32 = 0x56;
+  // extension of this plugin: switch the stream to compressed frames, see iq_codec.h
+  //   param: mode | (lossy bits << 8)
+  static constexpr uint8_t SET_COMPRESSION = 0x70;
+
+  static constexpr int DONGLE_INFO_LEN = 12;
+  static constexpr int CMD_LEN = 5;
+  static constexpr int DEFAULT_PORT = 1234;
+
+  // "RTL0" + tuner type + number of tuner gains
+  static void put_dongle_info(uint8_t* p, uint32_t tuner_type, uint32_t gain_count)
+  {
+    p[0] = 'R';  p[1] = 'T';  p[2] = 'L';  p[3] = '0';
+    put_be32(p + 4, tuner_type);
+    put_be32(p + 8, gain_count);
+  }
+
+  static bool get_dongle_info(const uint8_t* p, uint32_t& tuner_type, uint32_t& gain_count)
+  {
+    if (p[0] != 'R' || p[1] != 'T' || p[2] != 'L' || p[3] != '0')
+      return false;
+    tuner_type = get_be32(p + 4);
+    gain_count = get_be32(p + 8);
+    return true;
+  }
+
+  static void put_cmd(uint8_t* p, uint8_t cmd, uint32_t param)
+  {
+    p[0] = cmd;
+    put_be32(p + 1, param);
+  }
+
+  static void put_be32(uint8_t* p, uint32_t v)
+  {
+    p[0] = uint8_t(v >> 24);  p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);   p[3] = uint8_t(v);
+  }
+
+  static uint32_t get_be32(const uint8_t* p)
+  {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+  }
+};
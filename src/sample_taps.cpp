@@ -0,0 +1,463 @@
+
+#include "sample_taps.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define MAX_POOL_THREADS      8
+#define MAX_BLOCKS_PER_RUN    4     // then yield to other taps
+#define MAX_FREE_BLOCKS       64
+
+
+std::atomic_int sample_taps_threads = 2;
+std::atomic_int power_meter_enabled = 0;
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+struct TapEntry
+{
+  int id = 0;
+  std::shared_ptr<SampleTap> tap;
+  unsigned max_backlog = 0;
+
+  std::mutex mtx;                       // protects queue and scheduled
+  std::deque<SampleBlockPtr> queue;
+  bool scheduled = false;               // queued to - or running on - the pool
+
+  std::atomic_uint64_t processed{ 0 };
+  std::atomic_uint64_t dropped{ 0 };
+};
+
+struct PoolWorker
+{
+  std::mutex mtx;
+  std::deque<std::shared_ptr<TapEntry>> tasks;
+  std::thread thread;
+};
+
+// blocks with their buffer capacity - for reuse
+struct PooledBlock : public SampleBlock
+{
+  uint32_t capacity;
+};
+
+
+static std::mutex reg_mtx;      // serializes register/unregister
+static std::mutex taps_mtx;     // protects taps - against sample_taps_feed()
+static std::vector<std::shared_ptr<TapEntry>> taps;
+static std::atomic_uint num_taps = 0;
+static int next_tap_id = 1;
+
+static std::vector<std::unique_ptr<PoolWorker>> workers;
+static std::mutex pool_mtx;
+static std::condition_variable pool_cv;
+static std::atomic_uint pending_tasks = 0;
+static std::atomic_bool terminate_Pool_Threads = false;
+static std::atomic_uint next_worker = 0;
+
+static std::mutex free_mtx;
+static std::vector<PooledBlock*> free_blocks;
+
+// only accessed from RtlSdrCallback()
+static uint64_t feed_seq = 0;
+static uint64_t feed_sample_index = 0;
+
+
+static void free_block(const SampleBlock* b)
+{
+  PooledBlock* pb = (PooledBlock*)b;
+  {
+    std::lock_guard<std::mutex> lk(free_mtx);
+    if (free_blocks.size() < MAX_FREE_BLOCKS)
+    {
+      free_blocks.push_back(pb);
+      return;
+    }
+  }
+  delete[] pb->data;
+  delete pb;
+}
+
+static PooledBlock* alloc_block(uint32_t len)
+{
+  PooledBlock* pb = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(free_mtx);
+    if (!free_blocks.empty())
+    {
+      pb = free_blocks.back();
+      free_blocks.pop_back();
+    }
+  }
+  if (pb && pb->capacity < len)
+  {
+    delete[] pb->data;
+    pb->data = nullptr;
+  }
+  if (!pb)
+  {
+    pb = new (std::nothrow) PooledBlock();
+    if (!pb)
+      return nullptr;
+    pb->data = nullptr;
+  }
+  if (!pb->data)
+  {
+    pb->data = new (std::nothrow) uint8_t[len];
+    pb->capacity = len;
+    if (!pb->data)
+    {
+      delete pb;
+      return nullptr;
+    }
+  }
+  return pb;
+}
+
+
+static void schedule(const std::shared_ptr<TapEntry>& e)
+{
+  PoolWorker& w = *workers[next_worker++ % workers.size()];
+  {
+    std::lock_guard<std::mutex> lk(w.mtx);
+    w.tasks.push_back(e);
+  }
+  ++pending_tasks;
+  {
+    std::lock_guard<std::mutex> lk(pool_mtx);
+  }
+  pool_cv.notify_one();
+}
+
+// own tasks from the front, stolen ones from the back of other workers
+static bool pop_task(unsigned self, std::shared_ptr<TapEntry>& e)
+{
+  const unsigned n = unsigned(workers.size());
+  for (unsigned k = 0; k < n; ++k)
+  {
+    PoolWorker& w = *workers[(self + k) % n];
+    std::lock_guard<std::mutex> lk(w.mtx);
+    if (w.tasks.empty())
+      continue;
+    if (k == 0)
+    {
+      e = std::move(w.tasks.front());
+      w.tasks.pop_front();
+    }
+    else
+    {
+      e = std::move(w.tasks.back());
+      w.tasks.pop_back();
+    }
+    --pending_tasks;
+    return true;
+  }
+  return false;
+}
+
+static void run_tap(const std::shared_ptr<TapEntry>& e)
+{
+  for (int k = 0; k < MAX_BLOCKS_PER_RUN; ++k)
+  {
+    SampleBlockPtr blk;
+    {
+      std::lock_guard<std::mutex> lk(e->mtx);
+      if (e->queue.empty())
+        break;
+      blk = std::move(e->queue.front());
+      e->queue.pop_front();
+    }
+    e->tap->process(blk);
+    ++e->processed;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(e->mtx);
+    if (e->queue.empty())
+    {
+      e->scheduled = false;
+      return;
+    }
+  }
+  schedule(e);  // more blocks: requeue behind the other taps
+}
+
+static void Pool_ThreadProc(unsigned self)
+{
+  while (!terminate_Pool_Threads.load())
+  {
+    std::shared_ptr<TapEntry> e;
+    if (pop_task(self, e))
+    {
+      run_tap(e);
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(pool_mtx);
+    pool_cv.wait_for(lk, std::chrono::milliseconds(100), [] {
+      return terminate_Pool_Threads.load() || pending_tasks.load() > 0;
+    });
+  }
+}
+
+static void start_pool()
+{
+  char acMsg[256];
+  int n = sample_taps_threads.load();
+  if (n < 1)
+    n = 1;
+  else if (n > MAX_POOL_THREADS)
+    n = MAX_POOL_THREADS;
+
+  terminate_Pool_Threads = false;
+  pending_tasks = 0;
+  for (int k = 0; k < n; ++k)
+    workers.emplace_back(new PoolWorker());
+  for (int k = 0; k < n; ++k)
+    workers[k]->thread = std::thread(Pool_ThreadProc, unsigned(k));
+  SDRLG(extHw_MSG_DEBUG, "sample_taps: started pool with %d threads", n);
+}
+
+static void stop_pool()
+{
+  terminate_Pool_Threads = true;
+  {
+    std::lock_guard<std::mutex> lk(pool_mtx);
+  }
+  pool_cv.notify_all();
+  for (auto& w : workers)
+    if (w->thread.joinable())
+      w->thread.join();
+  workers.clear();
+  SDRLOG(extHw_MSG_DEBUG, "sample_taps: stopped pool");
+}
+
+
+int sample_taps_register(const std::shared_ptr<SampleTap>& tap, unsigned max_backlog)
+{
+  char acMsg[256];
+  if (!tap)
+    return 0;
+  std::lock_guard<std::mutex> rlk(reg_mtx);
+  if (workers.empty())
+    start_pool();
+
+  std::shared_ptr<TapEntry> e(new TapEntry());
+  e->tap = tap;
+  e->max_backlog = max_backlog ? max_backlog : 1;
+  {
+    std::lock_guard<std::mutex> lk(taps_mtx);
+    e->id = next_tap_id++;
+    taps.push_back(e);
+    num_taps = unsigned(taps.size());
+  }
+  SDRLG(extHw_MSG_DEBUG, "sample_taps: registered tap '%s' with id %d, backlog %u",
+    tap->name(), e->id, e->max_backlog);
+  return e->id;
+}
+
+void sample_taps_unregister(int id)
+{
+  char acMsg[256];
+  std::lock_guard<std::mutex> rlk(reg_mtx);
+  std::shared_ptr<TapEntry> e;
+  {
+    std::lock_guard<std::mutex> lk(taps_mtx);
+    for (auto it = taps.begin(); it != taps.end(); ++it)
+    {
+      if ((*it)->id == id)
+      {
+        e = *it;
+        taps.erase(it);
+        break;
+      }
+    }
+    num_taps = unsigned(taps.size());
+  }
+  if (!e)
+    return;
+
+  // drop the backlog and wait for a running process()
+  {
+    std::lock_guard<std::mutex> lk(e->mtx);
+    e->dropped += e->queue.size();
+    e->queue.clear();
+  }
+  for (;;)
+  {
+    {
+      std::lock_guard<std::mutex> lk(e->mtx);
+      if (!e->scheduled)
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  SDRLG(extHw_MSG_DEBUG, "sample_taps: unregistered tap '%s': processed %llu, dropped %llu blocks",
+    e->tap->name(), (unsigned long long)e->processed.load(), (unsigned long long)e->dropped.load());
+
+  if (num_taps.load() == 0 && !workers.empty())
+    stop_pool();
+}
+
+
+void sample_taps_feed(const uint8_t* buf, uint32_t len)
+{
+  if (!num_taps.load(std::memory_order_relaxed))
+    return;
+
+  PooledBlock* pb = alloc_block(len);
+  if (!pb)
+    return;
+  pb->seq = feed_seq++;
+  pb->sample_index = feed_sample_index;
+  feed_sample_index += len / 2;
+  pb->time_us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count());
+  pb->LO_freq = last.LO_freq.load(std::memory_order_relaxed);
+  pb->srate = rates::tab[last.srate_idx].valueInt;
+  pb->len = len;
+  memcpy(pb->data, buf, len);
+  SampleBlockPtr blk(pb, free_block);
+
+  std::lock_guard<std::mutex> lk(taps_mtx);
+  for (auto& e : taps)
+  {
+    bool need_schedule = false;
+    {
+      std::lock_guard<std::mutex> elk(e->mtx);
+      if (e->queue.size() >= e->max_backlog)
+      {
+        ++e->dropped;
+        continue;
+      }
+      e->queue.push_back(blk);
+      if (!e->scheduled)
+        need_schedule = e->scheduled = true;
+    }
+    if (need_schedule)
+      schedule(e);
+  }
+}
+
+
+unsigned sample_taps_get_stats(SampleTapStats* stats, unsigned max_stats)
+{
+  std::lock_guard<std::mutex> lk(taps_mtx);
+  unsigned n = 0;
+  for (auto& e : taps)
+  {
+    if (n >= max_stats)
+      break;
+    SampleTapStats& s = stats[n++];
+    snprintf(s.name, 31, "%s", e->tap->name());
+    s.name[31] = 0;
+    s.processed = e->processed.load();
+    s.dropped = e->dropped.load();
+    std::lock_guard<std::mutex> elk(e->mtx);
+    s.backlog = unsigned(e->queue.size());
+  }
+  return n;
+}
+
+void sample_taps_format_stats(char* s, size_t len)
+{
+  SampleTapStats stats[16];
+  const unsigned n = sample_taps_get_stats(stats, 16);
+  size_t pos = 0;
+  s[0] = 0;
+  for (unsigned k = 0; k < n && pos + 1 < len; ++k)
+  {
+    int r = snprintf(s + pos, len - pos - 1, "%s%s: processed %llu, dropped %llu, backlog %u",
+      (k ? "; " : ""), stats[k].name, (unsigned long long)stats[k].processed,
+      (unsigned long long)stats[k].dropped, stats[k].backlog);
+    if (r < 0)
+      break;
+    pos += size_t(r);
+  }
+  s[len - 1] = 0;
+}
+
+
+// built-in power meter tap
+
+class PowerMeterTap : public SampleTap
+{
+public:
+  const char* name() const override { return "power meter"; }
+
+  void process(const SampleBlockPtr& blk) override
+  {
+    const uint8_t* p = blk->data;
+    const uint32_t n = blk->len;
+    int64_t sum = 0;
+    for (uint32_t k = 0; k < n; ++k)
+    {
+      const int v = 2 * int(p[k]) - 255;    // 2x the offset from 127.5
+      sum += v * v;
+    }
+    // mean |I + jQ|^2 relative to full scale 127.5
+    const double mean = n ? double(sum) / 4.0 / (n / 2) : 0.0;
+    avg = (avg <= 0.0) ? mean : (0.9 * avg + 0.1 * mean);
+    dBFS = float(10.0 * std::log10(avg / (127.5 * 127.5) + 1E-20));
+  }
+
+  std::atomic<float> dBFS{ -200.0F };
+
+private:
+  double avg = 0.0;
+};
+
+static std::shared_ptr<PowerMeterTap> power_meter;
+static int power_meter_id = 0;
+
+void power_meter_start()
+{
+  if (!power_meter_enabled.load() || power_meter_id)
+    return;
+  power_meter = std::make_shared<PowerMeterTap>();
+  power_meter_id = sample_taps_register(power_meter, 8);
+}
+
+void power_meter_stop()
+{
+  if (!power_meter_id)
+    return;
+  sample_taps_unregister(power_meter_id);
+  power_meter_id = 0;
+}
+
+float power_meter_dBFS()
+{
+  return power_meter ? power_meter->dBFS.load() : -200.0F;
+}
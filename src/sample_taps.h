@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+// in-process side channel processors ("taps") on the raw I/Q stream,
+//   e.g. power meter, preamble detector or recorder.
+// RtlSdrCallback() wraps each USB block once into a reference counted SampleBlock
+//   and queues the handle to every registered tap - nothing else.
+// the taps run on a small work stealing thread pool: each tap processes its
+//   blocks in order and never concurrently with itself. when a tap's backlog
+//   exceeds its limit, new blocks are dropped for this tap - and counted.
+
+struct SampleBlock
+{
+  uint64_t seq;           // block number since start of the taps
+  uint64_t sample_index;  // index of the first sample since start
+  uint64_t time_us;       // arrival of the USB block in microseconds since 1970
+  int64_t LO_freq;        // in Hz
+  int srate;              // in Hz
+  uint32_t len;           // bytes of interleaved unsigned 8-bit I/Q
+  uint8_t* data;
+};
+
+using SampleBlockPtr = std::shared_ptr<const SampleBlock>;
+
+
+class SampleTap
+{
+public:
+  virtual ~SampleTap() {}
+  virtual const char* name() const = 0;
+  // called from a pool thread
+  virtual void process(const SampleBlockPtr& blk) = 0;
+};
+
+
+struct SampleTapStats
+{
+  char name[32];
+  uint64_t processed;
+  uint64_t dropped;
+  unsigned backlog;
+};
+
+extern std::atomic_int sample_taps_threads;   // pool size: 1 .. 8
+
+// returns id > 0. the pool starts with the first tap
+int sample_taps_register(const std::shared_ptr<SampleTap>& tap, unsigned max_backlog);
+// waits until the tap is idle. the pool stops with the last tap
+void sample_taps_unregister(int id);
+
+// called from RtlSdrCallback()
+void sample_taps_feed(const uint8_t* buf, uint32_t len);
+
+unsigned sample_taps_get_stats(SampleTapStats* stats, unsigned max_stats);
+// "name: processed n, dropped m, backlog k; .."
+void sample_taps_format_stats(char* s, size_t len);
+
+
+// built-in tap: mean power of the stream in dBFS
+extern std::atomic_int power_meter_enabled;
+void power_meter_start();
+void power_meter_stop();
+float power_meter_dBFS();
@@ -0,0 +1,186 @@
+
+#include "shm_export.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+// ring for ~ 3.5 seconds at 2.4 MSps
+#define SHM_RING_SIZE     (16 * 1024 * 1024)
+#define SHM_HEADER_SIZE   4096
+
+
+char shm_export_name[64] = { 0 };
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+static ShmIQHeader* shm_hdr = nullptr;
+static uint8_t* shm_data = nullptr;
+static std::atomic_bool shm_running = false;
+static uint64_t shm_wpos = 0;
+
+#ifdef _WIN32
+static HANDLE shm_handle = NULL;
+#else
+static char shm_path[80];
+#endif
+
+static constexpr size_t SHM_TOTAL = size_t(SHM_HEADER_SIZE) + size_t(SHM_RING_SIZE);
+
+
+bool shm_export_start()
+{
+  char acMsg[256];
+  if (!shm_export_name[0])
+    return false;
+  if (shm_running.load())
+    return true;
+
+  void* mem = nullptr;
+#ifdef _WIN32
+  char path[80];
+  snprintf(path, 79, "Local\\%s", shm_export_name);
+  path[79] = 0;
+  shm_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+    0, DWORD(SHM_TOTAL), path);
+  if (!shm_handle)
+  {
+    SDRLG(extHw_MSG_ERROR, "shm_export: CreateFileMapping('%s') failed: %u", path, unsigned(GetLastError()));
+    return false;
+  }
+  mem = MapViewOfFile(shm_handle, FILE_MAP_ALL_ACCESS, 0, 0, SHM_TOTAL);
+  if (!mem)
+  {
+    SDRLG(extHw_MSG_ERROR, "shm_export: MapViewOfFile('%s') failed: %u", path, unsigned(GetLastError()));
+    CloseHandle(shm_handle);
+    shm_handle = NULL;
+    return false;
+  }
+#else
+  snprintf(shm_path, 79, "/%s", shm_export_name);
+  shm_path[79] = 0;
+  int fd = shm_open(shm_path, O_CREAT | O_RDWR, 0644);
+  if (fd < 0 || ftruncate(fd, off_t(SHM_TOTAL)) != 0)
+  {
+    SDRLG(extHw_MSG_ERROR, "shm_export: shm_open('%s') failed", shm_path);
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  mem = mmap(nullptr, SHM_TOTAL, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED)
+  {
+    SDRLG(extHw_MSG_ERROR, "shm_export: mmap('%s') failed", shm_path);
+    shm_unlink(shm_path);
+    return false;
+  }
+#endif
+
+  shm_hdr = new (mem) ShmIQHeader;
+  shm_data = (uint8_t*)mem + SHM_HEADER_SIZE;
+  shm_wpos = 0;
+
+  shm_hdr->active.store(0);
+  memcpy(shm_hdr->magic, "RTLIQSHM", 8);
+  shm_hdr->version = 1;
+  shm_hdr->header_size = SHM_HEADER_SIZE;
+  shm_hdr->ring_size = SHM_RING_SIZE;
+  shm_hdr->param_seq.store(0);
+  shm_hdr->format = ShmIQHeader::FORMAT_U8_IQ;
+  shm_hdr->samplerate = uint32_t(rates::tab[last.srate_idx].valueInt);
+  shm_hdr->center_freq = last.LO_freq.load();
+  shm_hdr->write_index.store(0);
+  shm_hdr->block_seq.store(0);
+  shm_hdr->active.store(1, std::memory_order_release);
+
+  SDRLG(extHw_MSG_LOG, "shm_export: exporting to shared memory '%s' with %u bytes ring",
+    shm_export_name, unsigned(SHM_RING_SIZE));
+  shm_running = true;
+  return true;
+}
+
+void shm_export_stop()
+{
+  if (!shm_running.load())
+    return;
+  shm_running = false;
+  shm_hdr->active.store(0, std::memory_order_release);
+
+#ifdef _WIN32
+  UnmapViewOfFile(shm_hdr);
+  CloseHandle(shm_handle);
+  shm_handle = NULL;
+#else
+  munmap(shm_hdr, SHM_TOTAL);
+  shm_unlink(shm_path);   // mapping readers keep their view
+#endif
+  shm_hdr = nullptr;
+  shm_data = nullptr;
+  SDRLOG(extHw_MSG_DEBUG, "shm_export: stopped");
+}
+
+bool shm_export_is_running()
+{
+  return shm_running.load();
+}
+
+void shm_export_feed(const uint8_t* buf, uint32_t len)
+{
+  if (!shm_running.load(std::memory_order_relaxed) || len > SHM_RING_SIZE)
+    return;
+
+  // parameters - only on change
+  const uint32_t srate = uint32_t(rates::tab[last.srate_idx].valueInt);
+  const int64_t freq = last.LO_freq.load(std::memory_order_relaxed);
+  if (srate != shm_hdr->samplerate || freq != shm_hdr->center_freq)
+  {
+    shm_hdr->param_seq.fetch_add(1, std::memory_order_acq_rel);
+    shm_hdr->samplerate = srate;
+    shm_hdr->center_freq = freq;
+    shm_hdr->param_seq.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  const size_t off = size_t(shm_wpos & (SHM_RING_SIZE - 1));
+  const size_t first = (len <= SHM_RING_SIZE - off) ? len : (SHM_RING_SIZE - off);
+  memcpy(shm_data + off, buf, first);
+  if (first < len)
+    memcpy(shm_data, buf + first, len - first);
+  shm_wpos += len;
+  shm_hdr->write_index.store(shm_wpos, std::memory_order_release);
+  shm_hdr->block_seq.fetch_add(1, std::memory_order_relaxed);
+}
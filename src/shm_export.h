@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// export of the live I/Q stream into a named shared memory ring:
+//   POSIX shm_open("/<name>") on Linux, file mapping "Local\<name>" on Windows.
+// any number of local processes can map it read-only and follow write_index -
+//   without socket copies. RtlSdrCallback() does one append per USB block.
+//
+// layout: ShmIQHeader at offset 0, the data ring at offset header_size.
+// reader protocol:
+//   - wait for magic and active != 0
+//   - w = write_index (acquire). bytes [r, w) are valid, as long as w - r <= ring_size
+//     read data at (r % ring_size), then check write_index again: if it advanced
+//     more than ring_size - (w - r), the read data may be overwritten: resync
+//   - samplerate, center_freq and format change together: read them while
+//     param_seq is even and unchanged before/after
+
+struct ShmIQHeader
+{
+  static constexpr uint32_t FORMAT_U8_IQ = 1;     // interleaved unsigned 8-bit I/Q
+
+  char magic[8];                      // "RTLIQSHM"
+  uint32_t version;                   // 1
+  uint32_t header_size;               // offset of the data ring
+  uint64_t ring_size;                 // power of 2 bytes
+  std::atomic_uint32_t active;        // 0 when the writer stopped
+  std::atomic_uint32_t param_seq;     // odd while updating the parameters
+  uint32_t format;
+  uint32_t samplerate;
+  int64_t center_freq;                // LO frequency in Hz
+  std::atomic_uint64_t write_index;   // absolute number of written bytes
+  std::atomic_uint64_t block_seq;     // number of appended blocks
+};
+
+static_assert(std::atomic_uint64_t::is_always_lock_free, "atomics in shared memory must be lock free");
+
+extern char shm_export_name[64];    // "" == disabled
+
+bool shm_export_start();
+void shm_export_stop();
+bool shm_export_is_running();
+
+// called from RtlSdrCallback()
+void shm_export_feed(const uint8_t* buf, uint32_t len);
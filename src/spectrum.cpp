@@ -0,0 +1,350 @@
+
+#include "spectrum.h"
+#include "iq_ring.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <string.h>
+#include <time.h>
+#include <cmath>
+#include <thread>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+// ring for ~ 1.7 seconds at 2.4 MSps
+#define SPECTRUM_RING_SIZE    (8 * 1024 * 1024)
+
+static const double PI = 3.14159265358979323846;
+
+
+std::atomic_int spectrum_enabled = 0;
+std::atomic_int spectrum_fft_size = 1024;
+std::atomic_int spectrum_window = 1;
+std::atomic_int spectrum_overlap = 50;
+std::atomic_int spectrum_averages = 100;
+std::atomic_int spectrum_format = 0;
+char spectrum_file[256] = "rtl_spectrum.csv";
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+bool WelchAverager::init(unsigned fft_size, int window)
+{
+  if (!fft.init(fft_size))
+    return false;
+  const unsigned N = fft_size;
+  win.resize(N);
+  double sum_w = 0.0;
+  for (unsigned k = 0; k < N; ++k)
+  {
+    const double x = 2.0 * PI * double(k) / double(N);
+    double w = 1.0;
+    if (window == 1)
+      w = 0.5 - 0.5 * cos(x);
+    else if (window == 2)
+      w = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2.0 * x) - 0.01168 * cos(3.0 * x);
+    win[k] = float(w);
+    sum_w += w;
+  }
+  // full scale sine => 0 dB
+  norm = 1.0 / ((127.5 * sum_w) * (127.5 * sum_w));
+  re.resize(N);
+  im.resize(N);
+  acc.assign(N, 0.0);
+  num = 0;
+  return true;
+}
+
+void WelchAverager::reset()
+{
+  std::fill(acc.begin(), acc.end(), 0.0);
+  num = 0;
+}
+
+void WelchAverager::add_frame(const uint8_t* iq)
+{
+  const unsigned N = fft.size();
+  float* r = re.data();
+  float* i = im.data();
+  for (unsigned k = 0; k < N; ++k)
+  {
+    r[k] = (float(iq[2 * k]) - 127.5F) * win[k];
+    i[k] = (float(iq[2 * k + 1]) - 127.5F) * win[k];
+  }
+  fft.forward(r, i);
+  for (unsigned k = 0; k < N; ++k)
+    acc[k] += double(r[k]) * r[k] + double(i[k]) * i[k];
+  ++num;
+}
+
+void WelchAverager::result(std::vector<float>& dB) const
+{
+  const unsigned N = fft.size();
+  dB.resize(N);
+  const double scale = num ? norm / num : norm;
+  for (unsigned k = 0; k < N; ++k)
+  {
+    // fftshift: negative frequencies first
+    const double p = acc[(k + N / 2) & (N - 1)] * scale;
+    dB[k] = float(10.0 * log10(p + 1E-20));
+  }
+}
+
+
+void spectrum_write_line(FILE* f, int format, const SpectrumLine& line, const std::vector<float>& dB)
+{
+  const unsigned bins = unsigned(dB.size());
+  if (format == 1)
+  {
+    const uint32_t version = 1, nbins = bins, averages = line.averages;
+    fwrite("RTPS", 1, 4, f);
+    fwrite(&version, 4, 1, f);
+    fwrite(&nbins, 4, 1, f);
+    fwrite(&averages, 4, 1, f);
+    fwrite(&line.time_us, 8, 1, f);
+    fwrite(&line.f_low, 8, 1, f);
+    fwrite(&line.f_step, 8, 1, f);
+    fwrite(dB.data(), sizeof(float), bins, f);
+    return;
+  }
+
+  const time_t t = time_t(line.time_us / 1000000);
+  struct tm tm_val = *localtime(&t);
+  char date_time[64];
+  strftime(date_time, sizeof(date_time), "%Y-%m-%d, %H:%M:%S", &tm_val);
+  fprintf(f, "%s, %.0f, %.0f, %.2f, %llu", date_time,
+    line.f_low, line.f_low + line.f_step * bins, line.f_step, (unsigned long long)line.samples);
+  for (unsigned k = 0; k < bins; ++k)
+    fprintf(f, ", %.2f", dB[k]);
+  fprintf(f, "\n");
+}
+
+
+bool SpectrumLog::open(const char* path, int format)
+{
+  close();
+  fmt = format;
+  snprintf(filename, 255, "%s", path);
+  filename[255] = 0;
+  // the archive is opened with the first line's number of bins
+  if (fmt == 2)
+    return true;
+  f = fopen(filename, (fmt == 1) ? "ab" : "a");
+  return f != nullptr;
+}
+
+bool SpectrumLog::write(const SpectrumLine& line, const std::vector<float>& dB)
+{
+  if (fmt == 2)
+  {
+    if (!archive.is_open() && !archive.open(filename, unsigned(dB.size())))
+      return false;
+    return archive.append(line, dB);
+  }
+  if (!f)
+    return false;
+  spectrum_write_line(f, fmt, line, dB);
+  fflush(f);
+  return true;
+}
+
+void SpectrumLog::close()
+{
+  if (f)
+    fclose(f);
+  f = nullptr;
+  archive.close();
+}
+
+
+static IQRing spec_ring;
+static std::thread spec_thread;
+static std::atomic_bool spec_running = false;
+static std::atomic_bool terminate_Spectrum_Thread = false;
+
+static std::atomic_uint64_t stat_ffts = 0;
+static std::atomic_uint64_t stat_fft_ns = 0;
+static std::atomic_uint64_t stat_lines = 0;
+static std::atomic_uint64_t stat_skipped = 0;
+static std::atomic_uint64_t stat_write_errors = 0;
+static std::atomic_int stat_hop = 1;
+
+
+static void Spectrum_ThreadProc()
+{
+  char acMsg[256];
+  SpectrumLog log;
+  if (!log.open(spectrum_file, spectrum_format.load()))
+  {
+    SDRLG(extHw_MSG_ERROR, "spectrum: could not open '%s' for writing", spectrum_file);
+    return;
+  }
+
+  WelchAverager welch;
+  welch.init(unsigned(spectrum_fft_size.load()), spectrum_window.load());
+  const unsigned N = welch.fft_size();
+  int overlap = spectrum_overlap.load();
+  overlap = (overlap < 0) ? 0 : (overlap > 90) ? 90 : overlap;
+  unsigned hop = N * unsigned(100 - overlap) / 100U;
+  if (!hop)
+    hop = 1;
+  stat_hop = int(hop);
+  const unsigned averages = unsigned((spectrum_averages.load() > 0) ? spectrum_averages.load() : 1);
+
+  std::vector<uint8_t> frame(2 * N);
+  std::vector<float> dB;
+  uint64_t rpos = spec_ring.write_pos();
+  int64_t line_LO = 0;
+  int line_srate = 0;
+  int64_t line_time_us = 0;
+
+  while (!terminate_Spectrum_Thread.load())
+  {
+    if (!spec_ring.is_valid(rpos))
+    {
+      const uint64_t new_rpos = spec_ring.write_pos() & ~uint64_t(1);
+      stat_skipped += new_rpos - rpos;
+      rpos = new_rpos;
+      welch.reset();
+    }
+    const uint64_t avail = spec_ring.lag(rpos);
+    if (avail < 2 * N)
+    {
+      spec_ring.wait(rpos + avail, 50);
+      continue;
+    }
+
+    // a retune invalidates the running average
+    const int64_t LO = last.LO_freq.load();
+    const int srate = rates::tab[last.srate_idx].valueInt;
+    if (!welch.count() || LO != line_LO || srate != line_srate)
+    {
+      welch.reset();
+      line_LO = LO;
+      line_srate = srate;
+      line_time_us = int64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    spec_ring.copy_out(rpos, frame.data(), 2 * N);
+    if (!spec_ring.is_valid(rpos))
+      continue;
+    rpos += 2 * uint64_t(hop);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    welch.add_frame(frame.data());
+    const auto t1 = std::chrono::steady_clock::now();
+    stat_fft_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    ++stat_ffts;
+
+    if (welch.count() >= averages)
+    {
+      welch.result(dB);
+      SpectrumLine line;
+      line.time_us = line_time_us;
+      line.f_step = double(line_srate) / N;
+      line.f_low = double(line_LO) - line_srate / 2.0;
+      line.samples = uint64_t(averages) * N;
+      line.averages = averages;
+      if (log.write(line, dB))
+        ++stat_lines;
+      else if (!stat_write_errors++)
+        SDRLG(extHw_MSG_ERROR, "spectrum: could not write into '%s'", spectrum_file);
+      welch.reset();
+    }
+  }
+
+  log.close();
+  SDRLOG(extHw_MSG_DEBUG, "spectrum: thread finished");
+}
+
+
+bool spectrum_start()
+{
+  char acMsg[256];
+  if (!spectrum_enabled.load())
+    return false;
+  if (spec_running.load())
+    return true;
+
+  const int n = spectrum_fft_size.load();
+  if (n < 16 || n > 65536 || (n & (n - 1)))
+  {
+    SDRLG(extHw_MSG_ERROR, "spectrum: invalid FFT size %d", n);
+    return false;
+  }
+  if (!spec_ring.alloc(SPECTRUM_RING_SIZE))
+  {
+    SDRLOG(extHw_MSG_ERROR, "spectrum: could not allocate ring buffer");
+    return false;
+  }
+
+  SDRLG(extHw_MSG_LOG, "spectrum: FFT size %d, window %d, overlap %d %%, %d averages into '%s'",
+    n, spectrum_window.load(), spectrum_overlap.load(), spectrum_averages.load(), spectrum_file);
+  stat_ffts = 0;
+  stat_fft_ns = 0;
+  stat_lines = 0;
+  stat_skipped = 0;
+  stat_write_errors = 0;
+  terminate_Spectrum_Thread = false;
+  spec_running = true;
+  spec_thread = std::thread(Spectrum_ThreadProc);
+  return true;
+}
+
+void spectrum_stop()
+{
+  if (!spec_running.load())
+    return;
+  spec_running = false;
+  terminate_Spectrum_Thread = true;
+  spec_ring.wakeup();
+  if (spec_thread.joinable())
+    spec_thread.join();
+}
+
+bool spectrum_is_running()
+{
+  return spec_running.load();
+}
+
+void spectrum_feed(const uint8_t* buf, uint32_t len)
+{
+  if (!spec_running.load(std::memory_order_relaxed))
+    return;
+  spec_ring.append(buf, len);
+}
+
+void spectrum_format_stats(char* s, size_t len)
+{
+  const uint64_t ffts = stat_ffts.load();
+  const uint64_t ns = stat_fft_ns.load();
+  const double capacity = ns ? double(ffts) * 1E9 / double(ns) : 0.0;
+  const int srate = rates::tab[last.srate_idx].valueInt;
+  const double need = double(srate) / stat_hop.load();
+  snprintf(s, len - 1, "ffts %llu, capacity %.0f FFT/s, need %.0f FFT/s at %.2f MSps, lines %llu, skipped %llu bytes",
+    (unsigned long long)ffts, capacity, need, srate / 1E6,
+    (unsigned long long)stat_lines.load(), (unsigned long long)stat_skipped.load());
+  s[len - 1] = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "fft.h"
+#include "spectrum_archive.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+
+// averaged power spectrum (Welch's method) beside the stream - like rtl_power,
+//   but without giving up the dongle.
+// RtlSdrCallback() only appends into the spectrum's ring, a worker thread
+//   cuts overlapping frames, windows, transforms and averages them
+//   and writes one line per 'averages' FFTs into a CSV, binary or archive log.
+//
+// CSV line (rtl_power compatible):
+//   date, time, Hz low, Hz high, Hz step, samples, dB, dB, ..
+// binary record (little endian):
+//   "RTPS", uint32 version (1), uint32 bins, uint32 averages, int64 time in us since 1970,
+//   float64 Hz low, float64 Hz step, float32 dB[bins]
+// archive: memory mapped, indexed by time and frequency, see spectrum_archive.h
+// dB are relative to a full scale sine (dBFS).
+
+extern std::atomic_int spectrum_enabled;
+extern std::atomic_int spectrum_fft_size;     // power of 2: 16 .. 65536
+extern std::atomic_int spectrum_window;       // 0: rectangle, 1: Hann, 2: Blackman-Harris
+extern std::atomic_int spectrum_overlap;      // in percent: 0 .. 90
+extern std::atomic_int spectrum_averages;     // FFTs per output line
+extern std::atomic_int spectrum_format;       // 0: CSV, 1: binary, 2: archive
+extern char spectrum_file[256];
+
+
+class WelchAverager
+{
+public:
+  bool init(unsigned fft_size, int window);
+  void reset();
+  unsigned fft_size() const { return fft.size(); }
+  unsigned count() const { return num; }
+
+  // frame of fft_size() interleaved unsigned 8-bit I/Q pairs
+  void add_frame(const uint8_t* iq);
+  // averaged power in dBFS - with DC in the center
+  void result(std::vector<float>& dB) const;
+
+private:
+  FFT fft;
+  std::vector<float> win;
+  AlignedFloats re, im;
+  std::vector<double> acc;
+  double norm = 1.0;
+  unsigned num = 0;
+};
+
+void spectrum_write_line(FILE* f, int format, const SpectrumLine& line, const std::vector<float>& dB);
+
+// log of spectrum or sweep lines in one of the spectrum_format's
+class SpectrumLog
+{
+public:
+  ~SpectrumLog() { close(); }
+  bool open(const char* path, int format);
+  // false on error, e.g. different number of bins than the existing archive
+  bool write(const SpectrumLine& line, const std::vector<float>& dB);
+  void close();
+
+private:
+  FILE* f = nullptr;
+  SpectrumArchiveWriter archive;
+  int fmt = 0;
+  char filename[256] = { 0 };
+};
+
+
+bool spectrum_start();
+void spectrum_stop();
+bool spectrum_is_running();
+
+// called from RtlSdrCallback()
+void spectrum_feed(const uint8_t* buf, uint32_t len);
+
+// "ffts n, capacity x FFT/s, need y FFT/s at z MSps, lines n, skipped n bytes"
+void spectrum_format_stats(char* s, size_t len);
@@ -0,0 +1,349 @@
+
+#include "spectrum_archive.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+
+#define ARCHIVE_HEADER_SIZE     4096
+#define ARCHIVE_BLOCK_RECORDS   256
+// granularity of MapViewOfFile() offsets
+#define ARCHIVE_BLOCK_ALIGN     65536
+// grow the file by this number of blocks
+#define ARCHIVE_GROW_BLOCKS     4
+
+
+// file with two views: the header and one block
+class SpectrumArchiveMapping
+{
+public:
+  ~SpectrumArchiveMapping() { close(); }
+
+  bool open(const char* path, bool writable)
+  {
+    close();
+    rw = writable;
+#ifdef _WIN32
+    file = CreateFileA(path, writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(file, &sz))
+      return false;
+    file_size = uint64_t(sz.QuadPart);
+#else
+    fd = ::open(path, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      return false;
+    file_size = uint64_t(st.st_size);
+#endif
+    return true;
+  }
+
+  void close()
+  {
+    unmap(hdr_view, ARCHIVE_HEADER_SIZE);
+    unmap(blk_view, blk_len);
+    hdr_view = blk_view = nullptr;
+    blk_no = ~uint64_t(0);
+#ifdef _WIN32
+    if (mapping)
+      CloseHandle(mapping);
+    mapping = NULL;
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+#endif
+  }
+
+  bool is_open() const { return hdr_view != nullptr; }
+
+  // writer: file must have at least 'size' bytes
+  bool grow(uint64_t size)
+  {
+    if (size <= file_size)
+      return true;
+#ifdef _WIN32
+    // the mapping object can't grow: views stay valid, the object is recreated
+    if (mapping)
+      CloseHandle(mapping);
+    mapping = NULL;
+    LARGE_INTEGER pos;
+    pos.QuadPart = LONGLONG(size);
+    if (!SetFilePointerEx(file, pos, NULL, FILE_BEGIN) || !SetEndOfFile(file))
+      return false;
+#else
+    if (ftruncate(fd, off_t(size)) != 0)
+      return false;
+#endif
+    file_size = size;
+    return true;
+  }
+
+  uint8_t* map(uint64_t offset, size_t len)
+  {
+    if (offset + len > file_size)
+      return nullptr;
+#ifdef _WIN32
+    if (!mapping)
+    {
+      mapping = CreateFileMappingA(file, NULL, rw ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+      if (!mapping)
+        return nullptr;
+    }
+    void* p = MapViewOfFile(mapping, rw ? FILE_MAP_WRITE : FILE_MAP_READ,
+      DWORD(offset >> 32), DWORD(offset & 0xFFFFFFFFU), len);
+    return (uint8_t*)p;
+#else
+    void* p = mmap(nullptr, len, rw ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, off_t(offset));
+    return (p == MAP_FAILED) ? nullptr : (uint8_t*)p;
+#endif
+  }
+
+  void unmap(uint8_t* p, size_t len)
+  {
+    if (!p)
+      return;
+#ifdef _WIN32
+    (void)len;
+    UnmapViewOfFile(p);
+#else
+    munmap(p, len);
+#endif
+  }
+
+  bool map_header()
+  {
+    hdr_view = map(0, ARCHIVE_HEADER_SIZE);
+    return hdr_view != nullptr;
+  }
+
+  bool map_block(uint64_t blk)
+  {
+    if (blk == blk_no)
+      return true;
+    unmap(blk_view, blk_len);
+    blk_view = nullptr;
+    blk_no = ~uint64_t(0);
+    const SpectrumArchiveHeader* h = header();
+    blk_len = size_t(h->block_size);
+    blk_view = map(ARCHIVE_HEADER_SIZE + blk * h->block_size, blk_len);
+    if (!blk_view)
+      return false;
+    blk_no = blk;
+    return true;
+  }
+
+  SpectrumArchiveHeader* header() { return (SpectrumArchiveHeader*)hdr_view; }
+
+  uint64_t file_size = 0;
+  uint8_t* hdr_view = nullptr;
+  uint8_t* blk_view = nullptr;
+  size_t blk_len = 0;
+  uint64_t blk_no = ~uint64_t(0);
+  bool rw = false;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#else
+  int fd = -1;
+#endif
+};
+
+
+static uint64_t block_size_for(unsigned bins)
+{
+  const uint64_t R = ARCHIVE_BLOCK_RECORDS;
+  const uint64_t len = sizeof(SpectrumArchiveIndex) + R * (8 + 8 + 8 + 4) + uint64_t(bins) * R * 4;
+  return (len + ARCHIVE_BLOCK_ALIGN - 1) & ~uint64_t(ARCHIVE_BLOCK_ALIGN - 1);
+}
+
+
+SpectrumArchiveWriter::SpectrumArchiveWriter()
+  : m(new SpectrumArchiveMapping())
+{
+}
+
+SpectrumArchiveWriter::~SpectrumArchiveWriter()
+{
+  delete m;
+}
+
+bool SpectrumArchiveWriter::open(const char* path, unsigned bins)
+{
+  if (!m->open(path, true))
+    return false;
+
+  if (m->file_size >= ARCHIVE_HEADER_SIZE)
+  {
+    // append to an existing archive
+    if (!m->map_header())
+      return false;
+    const SpectrumArchiveHeader* h = m->header();
+    if (memcmp(h->magic, "RTLSPARC", 8) || h->version != 1 || (bins && h->bins != bins)
+      || h->block_records != ARCHIVE_BLOCK_RECORDS || h->block_size != block_size_for(h->bins))
+    {
+      m->close();
+      return false;
+    }
+    return true;
+  }
+
+  if (!bins || !m->grow(ARCHIVE_HEADER_SIZE) || !m->map_header())
+  {
+    m->close();
+    return false;
+  }
+  SpectrumArchiveHeader* h = m->header();
+  memset(h, 0, ARCHIVE_HEADER_SIZE);
+  h->version = 1;
+  h->bins = bins;
+  h->block_records = ARCHIVE_BLOCK_RECORDS;
+  h->block_size = block_size_for(bins);
+  h->num_blocks = 0;
+  h->num_records = 0;
+  memcpy(h->magic, "RTLSPARC", 8);   // valid, when magic is set
+  return true;
+}
+
+bool SpectrumArchiveWriter::is_open() const
+{
+  return m->is_open();
+}
+
+unsigned SpectrumArchiveWriter::bins() const
+{
+  return m->is_open() ? m->header()->bins : 0;
+}
+
+void SpectrumArchiveWriter::close()
+{
+  m->close();
+}
+
+bool SpectrumArchiveWriter::append(const SpectrumLine& line, const std::vector<float>& dB)
+{
+  if (!m->is_open())
+    return false;
+  SpectrumArchiveHeader* h = m->header();
+  if (dB.size() != h->bins)
+    return false;
+  const unsigned R = h->block_records;
+
+  // current block is full or there is none: start the next one
+  uint64_t blk = h->num_blocks;
+  if (blk && m->map_block(blk - 1) && ((SpectrumArchiveIndex*)m->blk_view)->count < R)
+    --blk;
+  else
+  {
+    const uint64_t need = ARCHIVE_HEADER_SIZE + (blk + 1) * h->block_size;
+    if (need > m->file_size && !m->grow(need + (ARCHIVE_GROW_BLOCKS - 1) * h->block_size))
+      return false;
+    if (!m->map_block(blk))
+      return false;
+    memset(m->blk_view, 0, sizeof(SpectrumArchiveIndex));
+    h->num_blocks = blk + 1;
+  }
+  if (!m->map_block(blk))
+    return false;
+
+  uint8_t* b = m->blk_view;
+  SpectrumArchiveIndex* idx = (SpectrumArchiveIndex*)b;
+  int64_t* t = (int64_t*)(b + sizeof(SpectrumArchiveIndex));
+  double* f_low = (double*)(t + R);
+  double* f_step = f_low + R;
+  uint32_t* averages = (uint32_t*)(f_step + R);
+  float* col = (float*)(averages + R);
+
+  const unsigned r = idx->count;
+  t[r] = line.time_us;
+  f_low[r] = line.f_low;
+  f_step[r] = line.f_step;
+  averages[r] = line.averages;
+  for (unsigned k = 0; k < h->bins; ++k)
+    col[size_t(k) * R + r] = dB[k];
+
+  const double f_high = line.f_low + line.f_step * h->bins;
+  if (!r)
+  {
+    idx->t_min = idx->t_max = line.time_us;
+    idx->f_min = line.f_low;
+    idx->f_max = f_high;
+  }
+  else
+  {
+    idx->t_min = (line.time_us < idx->t_min) ? line.time_us : idx->t_min;
+    idx->t_max = (line.time_us > idx->t_max) ? line.time_us : idx->t_max;
+    idx->f_min = (line.f_low < idx->f_min) ? line.f_low : idx->f_min;
+    idx->f_max = (f_high > idx->f_max) ? f_high : idx->f_max;
+  }
+  // count last: a concurrent reader sees only complete records
+  idx->count = r + 1;
+  ++h->num_records;
+  return true;
+}
+
+
+SpectrumArchiveReader::SpectrumArchiveReader()
+  : m(new SpectrumArchiveMapping())
+{
+}
+
+SpectrumArchiveReader::~SpectrumArchiveReader()
+{
+  delete m;
+}
+
+bool SpectrumArchiveReader::open(const char* path)
+{
+  if (!m->open(path, false) || m->file_size < ARCHIVE_HEADER_SIZE || !m->map_header())
+  {
+    m->close();
+    return false;
+  }
+  const SpectrumArchiveHeader* h = m->header();
+  if (memcmp(h->magic, "RTLSPARC", 8) || h->version != 1 || !h->block_records
+    || h->block_size != block_size_for(h->bins))
+  {
+    m->close();
+    return false;
+  }
+  return true;
+}
+
+void SpectrumArchiveReader::close()
+{
+  m->close();
+}
+
+const SpectrumArchiveHeader* SpectrumArchiveReader::header() const
+{
+  return m->is_open() ? m->header() : nullptr;
+}
+
+bool SpectrumArchiveReader::map_block(uint64_t blk)
+{
+  return m->map_block(blk);
+}
+
+const uint8_t* SpectrumArchiveReader::block() const
+{
+  return m->blk_view;
+}
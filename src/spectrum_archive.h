@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// spectrum history archive: fixed size records in columnar blocks,
+//   memory mapped for writing and reading - only the header and the
+//   current block are mapped, so a 32 bit host can write weeks of data.
+//
+// file layout, little endian:
+//   header, 4096 bytes:
+//     char magic[8] "RTLSPARC", uint32 version (1), uint32 bins,
+//     uint32 block_records, uint32 reserved, uint64 block_size,
+//     uint64 num_blocks, uint64 num_records
+//   num_blocks blocks of block_size bytes (multiple of 64 kB), each:
+//     index, 64 bytes:  uint32 count, uint32 reserved,
+//                       int64 t_min, int64 t_max  (us since 1970),
+//                       float64 f_min, float64 f_max  (Hz)
+//     int64   time_us[block_records]
+//     float64 f_low[block_records]
+//     float64 f_step[block_records]
+//     uint32  averages[block_records]
+//     float32 dB[bins][block_records]   - bin major: one bin over time is contiguous
+//
+// a query checks the block indices against time and frequency range
+//   and reads only the columns of matching blocks.
+
+struct SpectrumLine
+{
+  int64_t time_us;
+  double f_low;
+  double f_step;
+  uint64_t samples;
+  unsigned averages;
+};
+
+struct SpectrumArchiveIndex
+{
+  uint32_t count;
+  uint32_t reserved;
+  int64_t t_min;
+  int64_t t_max;
+  double f_min;
+  double f_max;
+  uint8_t pad[24];
+};
+
+struct SpectrumArchiveHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t bins;
+  uint32_t block_records;
+  uint32_t reserved;
+  uint64_t block_size;
+  uint64_t num_blocks;
+  uint64_t num_records;
+};
+
+
+class SpectrumArchiveMapping;
+
+class SpectrumArchiveWriter
+{
+public:
+  SpectrumArchiveWriter();
+  ~SpectrumArchiveWriter();
+
+  // creates the file or appends, when the existing file has the same number of bins.
+  // bins == 0: take the bins of an existing file. false on error
+  bool open(const char* path, unsigned bins);
+  bool is_open() const;
+  unsigned bins() const;
+  void close();
+
+  // dB.size() must match bins()
+  bool append(const SpectrumLine& line, const std::vector<float>& dB);
+
+private:
+  SpectrumArchiveMapping* m;
+};
+
+
+class SpectrumArchiveReader
+{
+public:
+  SpectrumArchiveReader();
+  ~SpectrumArchiveReader();
+
+  bool open(const char* path);
+  void close();
+  const SpectrumArchiveHeader* header() const;
+
+  // power at frequency f in [t_from, t_to]: calls cb(time_us, dB) in archive order.
+  // returns the number of matching records
+  template <class CB>
+  uint64_t query(double f, int64_t t_from, int64_t t_to, CB cb);
+
+  // number of blocks, which had to be read in the last query
+  uint64_t blocks_read() const { return n_blocks_read; }
+
+private:
+  bool map_block(uint64_t blk);
+  const uint8_t* block() const;
+
+  SpectrumArchiveMapping* m;
+  uint64_t n_blocks_read = 0;
+};
+
+
+template <class CB>
+uint64_t SpectrumArchiveReader::query(double f, int64_t t_from, int64_t t_to, CB cb)
+{
+  const SpectrumArchiveHeader* h = header();
+  n_blocks_read = 0;
+  if (!h)
+    return 0;
+  const unsigned R = h->block_records;
+  uint64_t n = 0;
+  for (uint64_t blk = 0; blk < h->num_blocks; ++blk)
+  {
+    if (!map_block(blk))
+      break;
+    const uint8_t* b = block();
+    const SpectrumArchiveIndex* idx = (const SpectrumArchiveIndex*)b;
+    if (!idx->count || idx->t_max < t_from || idx->t_min > t_to || f < idx->f_min || f >= idx->f_max)
+      continue;
+    ++n_blocks_read;
+    const int64_t* t = (const int64_t*)(b + sizeof(SpectrumArchiveIndex));
+    const double* f_low = (const double*)(t + R);
+    const double* f_step = f_low + R;
+    const float* dB = (const float*)((const uint32_t*)(f_step + R) + R);
+    for (unsigned r = 0; r < idx->count; ++r)
+    {
+      if (t[r] < t_from || t[r] > t_to)
+        continue;
+      const double bin = (f - f_low[r]) / f_step[r];
+      if (bin < 0.0 || bin >= double(h->bins))
+        continue;
+      cb(t[r], dB[size_t(bin) * R + r]);
+      ++n;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,95 @@
+
+// spectrum_query: power at one frequency over time from a spectrum archive
+//
+// usage: spectrum_query <archive> <frequency Hz> [<from> [<to>]]
+//   from/to: local time "YYYY-MM-DD HH:MM:SS", "YYYY-MM-DDTHH:MM:SS" or seconds since 1970
+// prints "date, time, dB" lines and a summary on stderr
+
+#include "spectrum_archive.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+
+static bool parse_time(const char* s, int64_t& t_us)
+{
+  struct tm tm_val;
+  memset(&tm_val, 0, sizeof(tm_val));
+  char sep = 0;
+  if (sscanf(s, "%d-%d-%d%c%d:%d:%d", &tm_val.tm_year, &tm_val.tm_mon, &tm_val.tm_mday, &sep,
+    &tm_val.tm_hour, &tm_val.tm_min, &tm_val.tm_sec) == 7 && (sep == ' ' || sep == 'T'))
+  {
+    tm_val.tm_year -= 1900;
+    tm_val.tm_mon -= 1;
+    tm_val.tm_isdst = -1;
+    const time_t t = mktime(&tm_val);
+    if (t == time_t(-1))
+      return false;
+    t_us = int64_t(t) * 1000000;
+    return true;
+  }
+  char* end = nullptr;
+  const double sec = strtod(s, &end);
+  if (end == s || *end)
+    return false;
+  t_us = int64_t(sec * 1E6);
+  return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "usage: %s <archive> <frequency Hz> [<from> [<to>]]\n", argv[0]);
+    fprintf(stderr, "  from/to: local time 'YYYY-MM-DD HH:MM:SS' or seconds since 1970\n");
+    return 1;
+  }
+
+  const double f = atof(argv[2]);
+  int64_t t_from = INT64_MIN;
+  int64_t t_to = INT64_MAX;
+  if ((argc > 3 && !parse_time(argv[3], t_from)) || (argc > 4 && !parse_time(argv[4], t_to)))
+  {
+    fprintf(stderr, "error: could not parse time range\n");
+    return 1;
+  }
+
+  SpectrumArchiveReader reader;
+  if (!reader.open(argv[1]))
+  {
+    fprintf(stderr, "error: could not open archive '%s'\n", argv[1]);
+    return 1;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  double sum = 0.0, min_dB = 1E9, max_dB = -1E9;
+  const uint64_t n = reader.query(f, t_from, t_to, [&](int64_t t_us, float dB) {
+    const time_t t = time_t(t_us / 1000000);
+    struct tm tm_val = *localtime(&t);
+    char date_time[64];
+    strftime(date_time, sizeof(date_time), "%Y-%m-%d, %H:%M:%S", &tm_val);
+    printf("%s, %.2f\n", date_time, dB);
+    sum += dB;
+    min_dB = (dB < min_dB) ? dB : min_dB;
+    max_dB = (dB > max_dB) ? dB : max_dB;
+  });
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+  const SpectrumArchiveHeader* h = reader.header();
+  fprintf(stderr, "%llu of %llu records in %llu of %llu blocks, %.1f ms",
+    (unsigned long long)n, (unsigned long long)h->num_records,
+    (unsigned long long)reader.blocks_read(), (unsigned long long)h->num_blocks, ms);
+  if (n)
+    fprintf(stderr, ", dB min %.2f, mean %.2f, max %.2f", min_dB, sum / n, max_dB);
+  fprintf(stderr, "\n");
+  return 0;
+}
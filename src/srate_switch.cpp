@@ -0,0 +1,100 @@
+
+#include "srate_switch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+
+enum SwitchState
+{
+  idle = 0,
+  commanding,     // drop all transfers
+  drop_next,      // drop the next drop_left transfers: they were submitted before the switch's end
+  measure         // the next transfer is at the new rate: end of the gap
+};
+
+static std::atomic_int state = idle;
+static std::mutex mtx;    // the state changes from the host's thread and the callback
+
+static uint64_t t_switch = 0;
+static uint64_t dropped = 0;    // bytes of the current switch
+static int drop_left = 0;       // transfers still to drop in state drop_next
+
+// stats
+static uint64_t n_switches = 0, last_gap_ns = 0, max_gap_ns = 0, last_dropped = 0;
+
+
+void srate_switch_reset()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  state = idle;
+}
+
+void srate_switch_begin(uint64_t t_ns)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  t_switch = t_ns;
+  dropped = 0;
+  state = commanding;
+}
+
+void srate_switch_end(int buf_num)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (state.load() == commanding)
+  {
+    drop_left = buf_num + 1;
+    state = drop_next;
+  }
+}
+
+bool srate_switch_drop(uint32_t len, uint64_t t_ns)
+{
+  if (state.load() == idle)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mtx);
+  switch (state.load())
+  {
+  case commanding:
+    dropped += len;
+    return true;
+  case drop_next:
+    dropped += len;
+    if (--drop_left <= 0)
+      state = measure;
+    return true;
+  case measure:
+    {
+      const uint64_t gap = (t_ns > t_switch) ? (t_ns - t_switch) : 0;
+      ++n_switches;
+      last_gap_ns = gap;
+      if (gap > max_gap_ns)
+        max_gap_ns = gap;
+      last_dropped = dropped;
+      state = idle;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+void srate_switch_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!n_switches)
+    snprintf(s, len - 1, "no samplerate switch while streaming");
+  else
+    snprintf(s, len - 1, "%llu switches: last gap %.1f ms with %llu samples dropped, max gap %.1f ms",
+      (unsigned long long)n_switches, last_gap_ns / 1E6, (unsigned long long)(last_dropped / 2), max_gap_ns / 1E6);
+  s[len - 1] = 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// samplerate switch while streaming - without restart of the USB stream:
+//   transfers, which complete while the new rate is commanded, mix samples of both rates.
+//   they are dropped - up to and including the transfers, which were submitted before
+//   the switch's end: all buf_num transfers in flight, and the one in the callback.
+//   the partial host block is dropped with them: the host's next block starts at the
+//   boundary, where the host was signalled the new samplerate.
+// the gap is the time from the switch's begin to the first transfer at the new rate.
+
+// StartHW(): no switch pending
+void srate_switch_reset();
+// host's thread - around commanding the new rate: steady clock in ns
+void srate_switch_begin(uint64_t t_ns);
+// buf_num: number of USB transfers of the running stream
+void srate_switch_end(int buf_num);
+
+// RtlSdrCallback(): true, when the transfer is to be dropped - with its partial host block
+bool srate_switch_drop(uint32_t len, uint64_t t_ns);
+
+// "n switches: last gap x ms with y samples dropped, max gap z ms"
+void srate_switch_format_stats(char* s, size_t len);
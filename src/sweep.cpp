@@ -0,0 +1,304 @@
+
+#include "sweep.h"
+#include "spectrum.h"
+#include "iq_ring.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <mutex>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define SWEEP_RING_SIZE   (8 * 1024 * 1024)
+
+
+std::atomic_int sweep_enabled = 0;
+std::atomic_int64_t sweep_start_freq = 88000000;
+std::atomic_int64_t sweep_stop_freq = 108000000;
+std::atomic_int sweep_overlap = 25;
+std::atomic_int sweep_dwell_ms = 50;
+std::atomic_int sweep_settle_ms = 10;
+char sweep_file[256] = "rtl_sweep.csv";
+
+extern std::atomic_int usb_buffer_len;
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+static IQRing sweep_ring;
+static std::thread sweep_thread;
+static std::atomic_bool sweep_running = false;
+static std::atomic_bool terminate_Sweep_Thread = false;
+
+// the tuner's LO for the host's frequency: reported to the host - and restored - while sweeping
+static std::mutex host_LO_mtx;
+static bool host_LO_held = false;
+static int64_t host_hw_LO = 0;
+
+static std::atomic_uint64_t stat_sweeps = 0;
+static std::atomic_uint64_t stat_sweep_us = 0;
+static std::atomic_uint64_t stat_hops = 0;
+static std::atomic_uint64_t stat_overhead_us = 0;
+static std::atomic_uint64_t stat_skipped = 0;
+static std::atomic_uint64_t stat_write_errors = 0;
+static std::atomic_int stat_hops_per_sweep = 0;
+
+
+static inline uint64_t now_us()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+// average 'frames' FFTs from rpos on. false on termination
+static bool collect_frames(WelchAverager& welch, uint64_t& rpos, unsigned frames, std::vector<uint8_t>& frame)
+{
+  const unsigned N = welch.fft_size();
+  welch.reset();
+  while (welch.count() < frames)
+  {
+    if (terminate_Sweep_Thread.load())
+      return false;
+    const uint64_t wpos = sweep_ring.write_pos();
+    if (rpos > wpos)
+    {
+      // still discarding after the retune
+      sweep_ring.wait(wpos, 50);
+      continue;
+    }
+    if (!sweep_ring.is_valid(rpos))
+    {
+      // too slow: the dwell restarts at the oldest valid position
+      const uint64_t new_rpos = (sweep_ring.write_pos() - sweep_ring.lag_limit()) & ~uint64_t(1);
+      stat_skipped += new_rpos - rpos;
+      rpos = new_rpos;
+      welch.reset();
+    }
+    const uint64_t avail = sweep_ring.lag(rpos);
+    if (avail < 2 * N)
+    {
+      sweep_ring.wait(rpos + avail, 50);
+      continue;
+    }
+    sweep_ring.copy_out(rpos, frame.data(), 2 * N);
+    if (!sweep_ring.is_valid(rpos))
+      continue;
+    rpos += 2 * uint64_t(N);
+    welch.add_frame(frame.data());
+  }
+  return true;
+}
+
+
+static void Sweep_ThreadProc()
+{
+  char acMsg[256];
+  SpectrumLog log;
+  if (!log.open(sweep_file, spectrum_format.load()))
+  {
+    SDRLG(extHw_MSG_ERROR, "sweep: could not open '%s' for writing", sweep_file);
+    std::lock_guard<std::mutex> lock(host_LO_mtx);
+    host_LO_held = false;
+    return;
+  }
+
+  WelchAverager welch;
+  welch.init(unsigned(spectrum_fft_size.load()), spectrum_window.load());
+  const unsigned N = welch.fft_size();
+  std::vector<uint8_t> frame(2 * N);
+  std::vector<float> dB;
+  std::vector<float> panorama;
+
+  while (!terminate_Sweep_Thread.load())
+  {
+    // plan the hops with the current samplerate
+    const int srate = rates::tab[last.srate_idx].valueInt;
+    int overlap = sweep_overlap.load();
+    overlap = (overlap < 0) ? 0 : (overlap > 50) ? 50 : overlap;
+    unsigned trim = unsigned(uint64_t(N) * overlap / 200U);
+    if (trim >= N / 2)
+      trim = N / 2 - 1;
+    const unsigned keep = N - 2 * trim;
+    const double f_step = double(srate) / N;
+    const double hop_step = keep * f_step;
+    const int64_t f_start = sweep_start_freq.load();
+    const int64_t f_stop = sweep_stop_freq.load();
+    unsigned hops = unsigned((double(f_stop - f_start) + hop_step - 1.0) / hop_step);
+    if (!hops)
+      hops = 1;
+    stat_hops_per_sweep = int(hops);
+
+    int dwell = sweep_dwell_ms.load();
+    unsigned frames = unsigned(int64_t(dwell > 0 ? dwell : 1) * srate / 1000 / N);
+    if (!frames)
+      frames = 1;
+    const uint64_t dwell_us = uint64_t(frames) * N * 1000000ULL / uint64_t(srate);
+    const int settle = sweep_settle_ms.load();
+    const uint64_t discard = 2 * (uint64_t(settle > 0 ? settle : 0) * srate / 1000)
+      + 2 * uint64_t(usb_buffer_len.load());
+
+    panorama.assign(size_t(hops) * keep, -200.0F);
+    const uint64_t sweep_t0 = now_us();
+    const int64_t sweep_time_us = int64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+    bool complete = true;
+
+    for (unsigned h = 0; h < hops; ++h)
+    {
+      const uint64_t hop_t0 = now_us();
+      // center, such that the kept bins start at f_start + h * hop_step
+      const int64_t center = f_start + int64_t(h * hop_step + (N / 2 - trim) * f_step);
+      if (nxt.LO_freq.load() != center || last.LO_freq.load() != center)
+      {
+        nxt.LO_freq.store(center);
+        trigger_control(CtrlFlags::freq);
+      }
+      uint64_t rpos = (sweep_ring.write_pos() & ~uint64_t(1)) + discard;
+
+      if (!collect_frames(welch, rpos, frames, frame) || rates::tab[last.srate_idx].valueInt != srate)
+      {
+        complete = false;
+        break;
+      }
+
+      welch.result(dB);
+      // DC spike of the zero IF: take the neighbours
+      dB[N / 2] = 0.5F * (dB[N / 2 - 1] + dB[N / 2 + 1]);
+      memcpy(&panorama[size_t(h) * keep], &dB[trim], keep * sizeof(float));
+
+      const uint64_t hop_us = now_us() - hop_t0;
+      stat_overhead_us += (hop_us > dwell_us) ? (hop_us - dwell_us) : 0;
+      ++stat_hops;
+    }
+    if (!complete)
+      continue;
+
+    SpectrumLine line;
+    line.time_us = sweep_time_us;
+    line.f_low = double(f_start);
+    line.f_step = f_step;
+    line.samples = uint64_t(hops) * frames * N;
+    line.averages = frames;
+    if (!log.write(line, panorama) && !stat_write_errors++)
+      SDRLG(extHw_MSG_ERROR, "sweep: could not write into '%s'", sweep_file);
+    stat_sweep_us += now_us() - sweep_t0;
+    ++stat_sweeps;
+  }
+
+  log.close();
+  // back to the host's frequency
+  {
+    std::lock_guard<std::mutex> lock(host_LO_mtx);
+    nxt.LO_freq.store(host_hw_LO);
+    host_LO_held = false;
+  }
+  trigger_control(CtrlFlags::freq);
+  SDRLOG(extHw_MSG_DEBUG, "sweep: thread finished");
+}
+
+
+bool sweep_start()
+{
+  char acMsg[256];
+  if (!sweep_enabled.load())
+    return false;
+  if (sweep_running.load())
+    return true;
+  if (sweep_stop_freq.load() <= sweep_start_freq.load())
+  {
+    SDRLOG(extHw_MSG_ERROR, "sweep: stop frequency must be above start frequency");
+    return false;
+  }
+  if (!sweep_ring.alloc(SWEEP_RING_SIZE))
+  {
+    SDRLOG(extHw_MSG_ERROR, "sweep: could not allocate ring buffer");
+    return false;
+  }
+
+  SDRLG(extHw_MSG_LOG, "sweep: %lld .. %lld Hz, overlap %d %%, dwell %d ms, settle %d ms into '%s'",
+    (long long)sweep_start_freq.load(), (long long)sweep_stop_freq.load(), sweep_overlap.load(),
+    sweep_dwell_ms.load(), sweep_settle_ms.load(), sweep_file);
+  stat_sweeps = 0;
+  stat_sweep_us = 0;
+  stat_hops = 0;
+  stat_overhead_us = 0;
+  stat_skipped = 0;
+  stat_write_errors = 0;
+  terminate_Sweep_Thread = false;
+  {
+    std::lock_guard<std::mutex> lock(host_LO_mtx);
+    host_hw_LO = nxt.LO_freq.load();
+    host_LO_held = true;
+  }
+  sweep_running = true;
+  sweep_thread = std::thread(Sweep_ThreadProc);
+  return true;
+}
+
+void sweep_stop()
+{
+  if (!sweep_running.load())
+    return;
+  sweep_running = false;
+  terminate_Sweep_Thread = true;
+  sweep_ring.wakeup();
+  if (sweep_thread.joinable())
+    sweep_thread.join();
+}
+
+int64_t sweep_host_hw_LO(int64_t hw_LO)
+{
+  std::lock_guard<std::mutex> lock(host_LO_mtx);
+  return host_LO_held ? host_hw_LO : hw_LO;
+}
+
+bool sweep_hold_hw_LO(int64_t hw_LO)
+{
+  std::lock_guard<std::mutex> lock(host_LO_mtx);
+  if (host_LO_held)
+    host_hw_LO = hw_LO;
+  return host_LO_held;
+}
+
+void sweep_feed(const uint8_t* buf, uint32_t len)
+{
+  if (!sweep_running.load(std::memory_order_relaxed))
+    return;
+  sweep_ring.append(buf, len);
+}
+
+void sweep_format_stats(char* s, size_t len)
+{
+  const uint64_t sweeps = stat_sweeps.load();
+  const uint64_t sweep_us = stat_sweep_us.load();
+  const uint64_t hops = stat_hops.load();
+  snprintf(s, len - 1, "sweeps %llu, %.2f sweeps/s, %d hops, retune overhead %.1f ms/hop, skipped %llu bytes",
+    (unsigned long long)sweeps, sweep_us ? sweeps * 1E6 / sweep_us : 0.0, stat_hops_per_sweep.load(),
+    hops ? stat_overhead_us.load() / 1E3 / hops : 0.0, (unsigned long long)stat_skipped.load());
+  s[len - 1] = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// wideband sweep: hop the LO through [start, stop] and stitch one panorama
+//   spectrum per sweep - replaces separate rtl_power runs.
+// each hop is retuned through trigger_control() / Control_Changes(),
+//   'settle' ms of samples and the USB buffers in flight are discarded,
+//   then 'dwell' ms are averaged with FFT size and window of the spectrum settings.
+// hops overlap by 'overlap' percent of the samplerate: the overlapping edges
+//   with the filter roll-off are trimmed and the DC bin is interpolated.
+// lines are written with spectrum_write_line() in the spectrum's format,
+//   one line per sweep with the panorama's bins.
+// keep the buffer size small: a retune can't be seen before the buffers
+//   in flight are delivered.
+
+extern std::atomic_int sweep_enabled;
+extern std::atomic_int64_t sweep_start_freq;   // Hz
+extern std::atomic_int64_t sweep_stop_freq;    // Hz
+extern std::atomic_int sweep_overlap;          // in percent of samplerate: 0 .. 50
+extern std::atomic_int sweep_dwell_ms;
+extern std::atomic_int sweep_settle_ms;
+extern char sweep_file[256];
+
+bool sweep_start();
+void sweep_stop();
+
+// the host keeps its LO while sweeping: GetHWLO() reports the tuner's LO
+//   from before the sweep - or from SetHWLO() meanwhile. the sweep returns to it at its end.
+// hw_LO, when not sweeping
+int64_t sweep_host_hw_LO(int64_t hw_LO);
+// SetHWLO(): true while sweeping - hw_LO is kept for the sweep's end, don't retune
+bool sweep_hold_hw_LO(int64_t hw_LO);
+
+// called from RtlSdrCallback()
+void sweep_feed(const uint8_t* buf, uint32_t len);
+
+// "sweeps n, x sweeps/s, n hops, retune overhead y ms/hop, skipped n bytes"
+void sweep_format_stats(char* s, size_t len);
@@ -0,0 +1,489 @@
+
+#include "net_sock.h"
+
+#include "tcp_server.h"
+#include "iq_ring.h"
+#include "iq_codec.h"
+#include "rtl_tcp_proto.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include "gui_dlg.h"
+
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+// ring for ~ 3.5 seconds at 2.4 MSps
+#define SERVER_RING_SIZE      (16 * 1024 * 1024)
+#define MAX_SEND_CHUNK        (64 * 1024)
+
+
+std::atomic_int tcp_server_port = 0;
+std::atomic_int tcp_server_bind_any = 0;
+std::atomic_int tcp_server_max_clients = 4;
+std::atomic_int tcp_server_slow_client = 0;
+std::atomic_int tcp_server_allow_control = 0;
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+struct TcpClient
+{
+  SOCKET sock = INVALID_SOCKET;
+  std::thread thread;
+  std::atomic_bool finished = false;
+  char peer[64] = { 0 };
+  uint64_t rpos = 0;
+  uint64_t skipped_bytes = 0;
+  uint32_t freq_hi32 = 0;   // SET_FREQ_HI32: upper bits for the next SET_FREQUENCY
+
+  // compressed transport - on request of the client
+  uint8_t req_mode = iq_codec::MODE_STORED;
+  uint8_t req_bits = 0;
+  bool compressed = false;
+  IQEncoder enc;
+  std::vector<uint8_t> frame;   // compressed frame - or copy of the raw samples
+  size_t frame_sent = 0;
+};
+
+static IQRing srv_ring;
+static SOCKET srv_sock = INVALID_SOCKET;
+static std::thread srv_thread;
+static std::atomic_bool srv_running = false;
+static std::atomic_bool terminate_Server_Thread = false;
+static std::atomic_uint num_clients = 0;
+static std::atomic_uint64_t num_dropped_clients = 0;
+static IQCodecStats codec_stats;
+
+static std::mutex clients_mtx;
+static std::vector<std::unique_ptr<TcpClient>> clients;
+
+
+static int nearestSrateIdxExact(uint32_t srate)
+{
+  for (int idx = 0; idx < int(rates::N); ++idx)
+    if (rates::tab[idx].valueInt == int(srate))
+      return idx;
+  return -1;
+}
+
+static void apply_client_command(TcpClient* c, uint8_t cmd, uint32_t param)
+{
+  char acMsg[256];
+  SDRLG(extHw_MSG_DEBUG, "tcp_server: client command 0x%02x, param %u", unsigned(cmd), unsigned(param));
+
+  switch (cmd)
+  {
+  case rtl_tcp::SET_FREQ_HI32:
+    // 64 bit frequency: the lower 32 bits follow with SET_FREQUENCY
+    c->freq_hi32 = param;
+    return;
+  case rtl_tcp::SET_FREQUENCY:
+    // the upper bits are used once: clients without the extension never send them
+    nxt.LO_freq = int64_t((uint64_t(c->freq_hi32) << 32) | param);
+    c->freq_hi32 = 0;
+    trigger_control(CtrlFlags::freq);
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
+    break;
+  case rtl_tcp::SET_SAMPLE_RATE:
+  {
+    const int idx = nearestSrateIdxExact(param);
+    if (idx < 0)
+    {
+      SDRLG(extHw_MSG_WARNING, "tcp_server: samplerate %u from client not in list. ignored", unsigned(param));
+      break;
+    }
+    nxt.srate_idx = idx;
+    trigger_control(CtrlFlags::srate);
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+    break;
+  }
+  case rtl_tcp::SET_GAIN_MODE:
+    nxt.tuner_rf_agc = param ? 0 : 1;   // 1 == manual gain
+    trigger_control(CtrlFlags::rf_agc);
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_RF_IF);
+    break;
+  case rtl_tcp::SET_GAIN:
+    if (n_rf_gains)
+    {
+      nxt.rf_gain = rf_gains[nearestGainIdx(int(param), rf_gains, n_rf_gains)];
+      trigger_control(CtrlFlags::rf_gain);
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_ATT);
+    }
+    break;
+  case rtl_tcp::SET_TUNER_GAIN_BY_INDEX:
+    if (param < uint32_t(n_rf_gains))
+    {
+      nxt.rf_gain = rf_gains[param];
+      trigger_control(CtrlFlags::rf_gain);
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_ATT);
+    }
+    break;
+  case rtl_tcp::SET_FREQUENCY_CORRECTION:
+    nxt.freq_corr_ppm = int(param);
+    trigger_control(CtrlFlags::ppm_correction);
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
+    break;
+  case rtl_tcp::SET_AGC_MODE:
+    nxt.rtl_agc = param ? 1 : 0;
+    trigger_control(CtrlFlags::rtl_agc);
+    break;
+  case rtl_tcp::SET_DIRECT_SAMPLING:
+    if (param <= 2)
+    {
+      nxt.sampling_mode = int(param);
+      trigger_control(CtrlFlags::sampling_mode);
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
+    }
+    break;
+  case rtl_tcp::SET_OFFSET_TUNING:
+    nxt.offset_tuning = param ? 1 : 0;
+    trigger_control(CtrlFlags::offset_tuning);
+    break;
+  case rtl_tcp::SET_BIAS_TEE:
+  {
+    // the bias tee is the enabled GPIO button with pin -1
+    int btnNo = 0;
+    while (btnNo < ControlVars::NUM_GPIO_BUTTONS && !(GPIO_en[btnNo].load() && GPIO_pin[btnNo].load() < 0))
+      ++btnNo;
+    if (btnNo >= ControlVars::NUM_GPIO_BUTTONS)
+    {
+      SDRLOG(extHw_MSG_DEBUG, "tcp_server: no GPIO button configured for the bias tee. ignored");
+      return;
+    }
+    nxt.GPIO[btnNo] = param ? 1 : 0;
+    trigger_control(CtrlFlags::gpio);
+    break;
+  }
+  case rtl_tcp::SET_TUNER_BANDWIDTH:
+    nxt.tuner_bw = int(param / 1000);
+    trigger_control(CtrlFlags::tuner_bandwidth);
+    break;
+  default:
+    SDRLG(extHw_MSG_DEBUG, "tcp_server: unsupported client command 0x%02x ignored", unsigned(cmd));
+    return;
+  }
+  post_update_gui_fields();
+}
+
+
+static void Client_ThreadProc(TcpClient* c)
+{
+  char acMsg[256];
+  uint8_t cmd_buf[rtl_tcp::CMD_LEN];
+  int cmd_fill = 0;
+
+  uint8_t info[rtl_tcp::DONGLE_INFO_LEN];
+  rtl_tcp::put_dongle_info(info, tunerNo.load(), uint32_t(n_rf_gains));
+  if (!net_send_all(c->sock, info, sizeof(info), 1000))
+  {
+    SDRLG(extHw_MSG_WARNING, "tcp_server: error sending dongle info to %s", c->peer);
+    c->finished = true;
+    return;
+  }
+
+  net_set_nonblocking(c->sock, true);
+  // start with the newest samples - not with old ones
+  c->rpos = srv_ring.write_pos();
+
+  while (!terminate_Server_Thread.load())
+  {
+    // receive commands - without blocking
+    if (net_wait(c->sock, false, 0) > 0)
+    {
+      int r = recv(c->sock, (char*)cmd_buf + cmd_fill, rtl_tcp::CMD_LEN - cmd_fill, 0);
+      if (r == 0 || (r < 0 && SOCK_LAST_ERROR() != SOCK_ERR_WOULDBLOCK))
+      {
+        SDRLG(extHw_MSG_LOG, "tcp_server: client %s disconnected", c->peer);
+        break;
+      }
+      if (r > 0)
+      {
+        cmd_fill += r;
+        if (cmd_fill == rtl_tcp::CMD_LEN)
+        {
+          cmd_fill = 0;
+          const uint32_t param = rtl_tcp::get_be32(cmd_buf + 1);
+          if (cmd_buf[0] == rtl_tcp::SET_COMPRESSION)
+          {
+            // transport of this client only: applied at the next frame boundary
+            c->req_mode = uint8_t(param & 0xFF);
+            c->req_bits = uint8_t((param >> 8) & 0xFF);
+            SDRLG(extHw_MSG_LOG, "tcp_server: client %s requested compression mode %u, bits %u",
+              c->peer, unsigned(c->req_mode), unsigned(c->req_bits));
+          }
+          else if (tcp_server_allow_control.load())
+            apply_client_command(c, cmd_buf[0], param);
+        }
+      }
+    }
+
+    // is this client too slow?
+    if (!srv_ring.is_valid(c->rpos))
+    {
+      if (!tcp_server_slow_client.load())
+      {
+        SDRLG(extHw_MSG_WARNING, "tcp_server: client %s is too slow: dropping", c->peer);
+        ++num_dropped_clients;
+        break;
+      }
+      // throttle: skip ahead, keeping some latency buffer
+      const uint64_t new_rpos = srv_ring.write_pos() - srv_ring.capacity() / 4;
+      c->skipped_bytes += new_rpos - c->rpos;
+      c->rpos = new_rpos;
+      SDRLG(extHw_MSG_DEBUG, "tcp_server: client %s is too slow: skipped %llu bytes in total",
+        c->peer, (unsigned long long)c->skipped_bytes);
+    }
+
+    const uint8_t* p = nullptr;
+    size_t n = 0;
+    if (c->frame_sent >= c->frame.size())
+    {
+      // frame boundary: switch transport
+      c->compressed = (c->req_mode != iq_codec::MODE_STORED);
+      c->frame.clear();
+      c->frame_sent = 0;
+    }
+    if (!c->compressed)
+    {
+      if (c->frame.empty())
+      {
+        // copy first: the ring might overwrite the samples while sending
+        const size_t raw_len = srv_ring.peek(c->rpos, p, MAX_SEND_CHUNK);
+        if (raw_len)
+        {
+          c->frame.resize(raw_len);
+          srv_ring.copy_out(c->rpos, c->frame.data(), raw_len);
+          if (!srv_ring.is_valid(c->rpos))
+          {
+            // overwritten while copying: the slowness check drops or resyncs
+            c->frame.clear();
+            continue;
+          }
+          c->rpos += raw_len;
+        }
+      }
+    }
+    else
+    {
+      if (c->frame.empty())
+      {
+        // frames start with I
+        if ((c->rpos & 1) && srv_ring.lag(c->rpos))
+          ++c->rpos;
+        const uint8_t* raw = nullptr;
+        const size_t raw_len = srv_ring.peek(c->rpos, raw, iq_codec::MAX_RAW_LEN);
+        if (raw_len && !(c->rpos & 1))
+        {
+          c->enc.encode(c->req_mode, c->req_bits, raw, raw_len, c->frame, &codec_stats);
+          if (!srv_ring.is_valid(c->rpos))
+          {
+            // overwritten while encoding: drop the frame - the slowness check drops or resyncs
+            c->frame.clear();
+            continue;
+          }
+          c->rpos += raw_len;
+        }
+      }
+    }
+    p = c->frame.data() + c->frame_sent;
+    n = c->frame.size() - c->frame_sent;
+    if (!n)
+    {
+      srv_ring.wait(c->rpos, 50);
+      continue;
+    }
+
+    if (net_wait(c->sock, true, 50) <= 0)
+      continue;   // not writable: re-check for slowness
+
+    int r = send(c->sock, (const char*)p, int(n), 0);
+    if (r < 0 && SOCK_LAST_ERROR() == SOCK_ERR_WOULDBLOCK)
+      continue;
+    if (r <= 0)
+    {
+      SDRLG(extHw_MSG_LOG, "tcp_server: client %s disconnected", c->peer);
+      break;
+    }
+    c->frame_sent += size_t(r);
+  }
+
+  closesocket(c->sock);
+  c->sock = INVALID_SOCKET;
+  c->finished = true;
+}
+
+
+static void reap_clients(bool all)
+{
+  std::lock_guard<std::mutex> lk(clients_mtx);
+  for (auto it = clients.begin(); it != clients.end(); )
+  {
+    TcpClient* c = it->get();
+    if (all || c->finished.load())
+    {
+      if (c->thread.joinable())
+        c->thread.join();
+      it = clients.erase(it);
+    }
+    else
+      ++it;
+  }
+  num_clients = unsigned(clients.size());
+}
+
+
+static void Server_ThreadProc()
+{
+  char acMsg[256];
+  SDRLG(extHw_MSG_LOG, "tcp_server: listening on port %d (%s)",
+    tcp_server_port.load(), tcp_server_bind_any.load() ? "all interfaces" : "localhost only");
+
+  while (!terminate_Server_Thread.load())
+  {
+    reap_clients(false);
+
+    if (net_wait(srv_sock, false, 100) <= 0)
+      continue;
+
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    SOCKET s = accept(srv_sock, (struct sockaddr*)&addr, &addr_len);
+    if (s == INVALID_SOCKET)
+      continue;
+
+    char peer[64];
+    snprintf(peer, 63, "%s:%u", inet_ntoa(addr.sin_addr), unsigned(ntohs(addr.sin_port)));
+    peer[63] = 0;
+
+    if (num_clients.load() >= unsigned(tcp_server_max_clients.load()))
+    {
+      SDRLG(extHw_MSG_WARNING, "tcp_server: rejecting client %s: maximum number of clients reached", peer);
+      closesocket(s);
+      continue;
+    }
+
+    SDRLG(extHw_MSG_LOG, "tcp_server: client %s connected", peer);
+    net_set_nodelay(s);
+    std::unique_ptr<TcpClient> c(new TcpClient());
+    c->sock = s;
+    memcpy(c->peer, peer, sizeof(peer));
+    TcpClient* cp = c.get();
+    {
+      std::lock_guard<std::mutex> lk(clients_mtx);
+      clients.push_back(std::move(c));
+      num_clients = unsigned(clients.size());
+    }
+    cp->thread = std::thread(Client_ThreadProc, cp);
+  }
+
+  SDRLOG(extHw_MSG_DEBUG, "tcp_server: server thread finished");
+}
+
+
+bool tcp_server_start()
+{
+  char acMsg[256];
+  const int port = tcp_server_port.load();
+  if (port <= 0 || port > 65535)
+    return false;
+  if (srv_running.load())
+    return true;
+
+  if (!srv_ring.alloc(SERVER_RING_SIZE))
+  {
+    SDRLOG(extHw_MSG_ERROR, "tcp_server: could not allocate ring buffer");
+    return false;
+  }
+
+  if (!net_init())
+  {
+    SDRLOG(extHw_MSG_ERROR, "tcp_server: error initializing network");
+    return false;
+  }
+
+  srv_sock = net_listen(port, tcp_server_bind_any.load() != 0);
+  if (srv_sock == INVALID_SOCKET)
+  {
+    SDRLG(extHw_MSG_ERROR, "tcp_server: error listening on port %d", port);
+    net_cleanup();
+    return false;
+  }
+
+  terminate_Server_Thread = false;
+  srv_running = true;
+  srv_thread = std::thread(Server_ThreadProc);
+  return true;
+}
+
+void tcp_server_stop()
+{
+  if (!srv_running.load())
+    return;
+
+  SDRLOG(extHw_MSG_DEBUG, "tcp_server: stopping ..");
+  terminate_Server_Thread = true;
+  srv_ring.wakeup();
+  if (srv_thread.joinable())
+    srv_thread.join();
+  reap_clients(true);
+
+  closesocket(srv_sock);
+  srv_sock = INVALID_SOCKET;
+  net_cleanup();
+  srv_running = false;
+  SDRLOG(extHw_MSG_DEBUG, "tcp_server: stopped");
+}
+
+bool tcp_server_is_running()
+{
+  return srv_running.load();
+}
+
+void tcp_server_feed(const uint8_t* buf, uint32_t len)
+{
+  // no copy without any client
+  if (!srv_running.load(std::memory_order_relaxed) || !num_clients.load(std::memory_order_relaxed))
+    return;
+  srv_ring.append(buf, len);
+}
+
+unsigned tcp_server_num_clients()
+{
+  return num_clients.load();
+}
+
+uint64_t tcp_server_num_dropped_clients()
+{
+  return num_dropped_clients.load();
+}
+
+void tcp_server_codec_stats(char* s, size_t len)
+{
+  codec_stats.format(s, len);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// rtl_tcp compatible server: serves the stream of the opened dongle
+//   to several clients - while the SDR application keeps receiving it.
+// RtlSdrCallback() appends each USB block once into a shared ring,
+//   each client's writer thread sends from that ring with its own read cursor.
+
+extern std::atomic_int tcp_server_port;           // 0 == disabled, else tcp port, e.g. 1234
+extern std::atomic_int tcp_server_bind_any;       // 0 == localhost only, 1 == all interfaces (LAN)
+extern std::atomic_int tcp_server_max_clients;
+extern std::atomic_int tcp_server_slow_client;    // 0 == drop slow client, 1 == skip ahead (throttle)
+extern std::atomic_int tcp_server_allow_control;  // 0 == ignore client commands, 1 == apply
+
+bool tcp_server_start();
+void tcp_server_stop();
+bool tcp_server_is_running();
+
+// called from RtlSdrCallback()
+void tcp_server_feed(const uint8_t* buf, uint32_t len);
+
+unsigned tcp_server_num_clients();
+uint64_t tcp_server_num_dropped_clients();
+
+// compression statistics of all clients, which requested compressed frames
+void tcp_server_codec_stats(char* s, size_t len);
@@ -0,0 +1,289 @@
+
+#include "net_sock.h"
+
+#include "udp_sender.h"
+#include "iq_ring.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+// ring for ~ 1.7 seconds at 2.4 MSps
+#define UDP_RING_SIZE     (8 * 1024 * 1024)
+#define UDP_HEADER_LEN    32
+#define MAX_BATCH         32
+
+
+char udp_out_host[256] = { 0 };
+std::atomic_int udp_out_port = 1235;
+std::atomic_int udp_out_ttl = 1;
+std::atomic_int udp_out_payload = 1024;
+
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+
+#define SDRLG( A, TEXT, ...) do { \
+  if ( gpfnExtIOCallbackPtr ) { \
+    snprintf(acMsg, 255, TEXT, __VA_ARGS__); \
+    acMsg[255] = 0; \
+    gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); \
+  } \
+} while (0)
+
+
+static IQRing udp_ring;
+static SOCKET udp_sock = INVALID_SOCKET;
+static struct sockaddr_in udp_dest;
+static std::thread udp_thread;
+static std::atomic_bool udp_running = false;
+static std::atomic_bool terminate_UDP_Thread = false;
+
+static std::atomic_uint64_t num_sent = 0;
+static std::atomic_uint64_t num_dropped = 0;
+
+// write position and time of the newest block - for the capture time estimate.
+// written by RtlSdrCallback(), consistent reads with the sequence lock
+static std::atomic_uint32_t stamp_seq = 0;
+static std::atomic_uint64_t stamp_wpos = 0;
+static std::atomic_uint64_t stamp_time_us = 0;
+
+
+static inline void put_le32(uint8_t* p, uint32_t v)
+{
+  p[0] = uint8_t(v);        p[1] = uint8_t(v >> 8);
+  p[2] = uint8_t(v >> 16);  p[3] = uint8_t(v >> 24);
+}
+
+static inline void put_le64(uint8_t* p, uint64_t v)
+{
+  put_le32(p, uint32_t(v));
+  put_le32(p + 4, uint32_t(v >> 32));
+}
+
+static uint64_t capture_time_us(uint64_t rpos, int srate)
+{
+  uint64_t wpos, t;
+  uint32_t s0, s1;
+  do
+  {
+    s0 = stamp_seq.load(std::memory_order_acquire);
+    wpos = stamp_wpos.load(std::memory_order_relaxed);
+    t = stamp_time_us.load(std::memory_order_relaxed);
+    s1 = stamp_seq.load(std::memory_order_acquire);
+  } while ((s0 & 1) || s0 != s1);
+  // the newest block ends at wpos
+  const uint64_t samples_before = (wpos > rpos) ? (wpos - rpos) / 2 : 0;
+  return t - (samples_before * 1000000U) / uint64_t(srate);
+}
+
+
+// send n packets. returns number of sent packets, the others are dropped
+static int send_batch(std::vector<uint8_t>* pkts, int n)
+{
+#ifdef __linux__
+  struct mmsghdr msgs[MAX_BATCH];
+  struct iovec iovs[MAX_BATCH];
+  memset(msgs, 0, sizeof(msgs));
+  for (int k = 0; k < n; ++k)
+  {
+    iovs[k].iov_base = pkts[k].data();
+    iovs[k].iov_len = pkts[k].size();
+    msgs[k].msg_hdr.msg_name = &udp_dest;
+    msgs[k].msg_hdr.msg_namelen = sizeof(udp_dest);
+    msgs[k].msg_hdr.msg_iov = &iovs[k];
+    msgs[k].msg_hdr.msg_iovlen = 1;
+  }
+  int sent = 0;
+  while (sent < n)
+  {
+    int r = sendmmsg(udp_sock, msgs + sent, unsigned(n - sent), MSG_DONTWAIT);
+    if (r <= 0)
+      break;  // would block or error: drop the rest
+    sent += r;
+  }
+  return sent;
+#else
+  int sent = 0;
+  for (int k = 0; k < n; ++k)
+  {
+    int r = sendto(udp_sock, (const char*)pkts[k].data(), int(pkts[k].size()), 0,
+      (const struct sockaddr*)&udp_dest, sizeof(udp_dest));
+    if (r > 0)
+      ++sent;
+  }
+  return sent;
+#endif
+}
+
+
+static void UDP_ThreadProc()
+{
+  char acMsg[256];
+  std::vector<uint8_t> pkts[MAX_BATCH];
+  uint32_t seq = 0;
+
+  int payload = udp_out_payload.load() & ~1;
+  for (int k = 0; k < MAX_BATCH; ++k)
+    pkts[k].resize(UDP_HEADER_LEN + payload);
+
+  uint64_t rpos = udp_ring.write_pos();
+  const uint64_t start_pos = rpos;
+
+  while (!terminate_UDP_Thread.load())
+  {
+    if (!udp_ring.is_valid(rpos))
+    {
+      // far behind: skip ahead to the newest samples
+      const uint64_t new_rpos = udp_ring.write_pos() & ~uint64_t(1);
+      const uint64_t lost = (new_rpos - rpos) / uint64_t(payload);
+      num_dropped += lost;
+      seq += uint32_t(lost);
+      rpos = new_rpos;
+      SDRLG(extHw_MSG_DEBUG, "udp_sender: too slow: dropped %llu packets in total",
+        (unsigned long long)num_dropped.load());
+    }
+
+    const uint64_t avail = udp_ring.lag(rpos);
+    int n = int(avail / uint64_t(payload));
+    if (!n)
+    {
+      udp_ring.wait(rpos + avail, 50);
+      continue;
+    }
+    if (n > MAX_BATCH)
+      n = MAX_BATCH;
+
+    const int srate = rates::tab[last.srate_idx].valueInt;
+    for (int k = 0; k < n; ++k)
+    {
+      uint8_t* p = pkts[k].data();
+      const uint64_t pos = rpos + uint64_t(k) * uint64_t(payload);
+      p[0] = 'R';  p[1] = 'T';  p[2] = 'U';  p[3] = '1';
+      put_le32(p + 4, seq + uint32_t(k));
+      put_le32(p + 8, uint32_t(srate));
+      put_le32(p + 12, uint32_t(payload));
+      put_le64(p + 16, (pos - start_pos) / 2);
+      put_le64(p + 24, capture_time_us(pos, srate));
+      udp_ring.copy_out(pos, p + UDP_HEADER_LEN, size_t(payload));
+    }
+    if (!udp_ring.is_valid(rpos))
+      continue;   // overwritten while copying
+
+    const int sent = send_batch(pkts, n);
+    num_sent += uint64_t(sent);
+    num_dropped += uint64_t(n - sent);
+    seq += uint32_t(n);
+    rpos += uint64_t(n) * uint64_t(payload);
+  }
+
+  SDRLOG(extHw_MSG_DEBUG, "udp_sender: thread finished");
+}
+
+
+bool udp_sender_start()
+{
+  char acMsg[256];
+  if (!udp_out_host[0])
+    return false;
+  if (udp_running.load())
+    return true;
+
+  const int payload = udp_out_payload.load();
+  if (payload < 256 || payload > 65000)
+  {
+    SDRLG(extHw_MSG_ERROR, "udp_sender: invalid payload size %d", payload);
+    return false;
+  }
+
+  if (!udp_ring.alloc(UDP_RING_SIZE))
+  {
+    SDRLOG(extHw_MSG_ERROR, "udp_sender: could not allocate ring buffer");
+    return false;
+  }
+
+  if (!net_init())
+  {
+    SDRLOG(extHw_MSG_ERROR, "udp_sender: error initializing network");
+    return false;
+  }
+
+  udp_sock = net_udp_sender(udp_out_host, udp_out_port.load(), udp_out_ttl.load(), udp_dest);
+  if (udp_sock == INVALID_SOCKET)
+  {
+    SDRLG(extHw_MSG_ERROR, "udp_sender: error opening socket to %s:%d", udp_out_host, udp_out_port.load());
+    net_cleanup();
+    return false;
+  }
+
+  SDRLG(extHw_MSG_LOG, "udp_sender: sending to %s:%d with %d bytes payload per packet",
+    udp_out_host, udp_out_port.load(), payload);
+  num_sent = 0;
+  num_dropped = 0;
+  terminate_UDP_Thread = false;
+  udp_running = true;
+  udp_thread = std::thread(UDP_ThreadProc);
+  return true;
+}
+
+void udp_sender_stop()
+{
+  if (!udp_running.load())
+    return;
+
+  SDRLOG(extHw_MSG_DEBUG, "udp_sender: stopping ..");
+  udp_running = false;
+  terminate_UDP_Thread = true;
+  udp_ring.wakeup();
+  if (udp_thread.joinable())
+    udp_thread.join();
+
+  closesocket(udp_sock);
+  udp_sock = INVALID_SOCKET;
+  net_cleanup();
+}
+
+bool udp_sender_is_running()
+{
+  return udp_running.load();
+}
+
+void udp_sender_feed(const uint8_t* buf, uint32_t len)
+{
+  if (!udp_running.load(std::memory_order_relaxed))
+    return;
+  udp_ring.append(buf, len);
+
+  const uint64_t now_us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count());
+  stamp_seq.fetch_add(1, std::memory_order_acq_rel);
+  stamp_wpos.store(udp_ring.write_pos(), std::memory_order_relaxed);
+  stamp_time_us.store(now_us, std::memory_order_relaxed);
+  stamp_seq.fetch_add(1, std::memory_order_acq_rel);
+}
+
+uint64_t udp_sender_sent_packets()
+{
+  return num_sent.load();
+}
+
+uint64_t udp_sender_dropped_packets()
+{
+  return num_dropped.load();
+}
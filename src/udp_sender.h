@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// UDP output of the raw 8-bit I/Q stream - unicast or multicast, similar to rtl_udp.
+// RtlSdrCallback() appends each block into the sender's ring,
+//   the sender thread cuts it into packets and sends them in batches,
+//   with sendmmsg() on Linux. the RX path never waits for the network:
+//   packets get dropped - and counted - when sending can't keep up.
+//
+// packet: 32 bytes header + raw I/Q payload. header fields are little endian:
+//   "RTU1", sequence number (32 bit), samplerate (32 bit), payload length (32 bit),
+//   index of the first sample since start (64 bit),
+//   estimated capture time of the first sample in microseconds since 1970 (64 bit)
+
+extern char udp_out_host[256];            // "" == disabled, e.g. "239.1.2.3" or "192.168.1.10"
+extern std::atomic_int udp_out_port;
+extern std::atomic_int udp_out_ttl;       // for multicast
+extern std::atomic_int udp_out_payload;   // I/Q bytes per packet
+
+bool udp_sender_start();
+void udp_sender_stop();
+bool udp_sender_is_running();
+
+// called from RtlSdrCallback()
+void udp_sender_feed(const uint8_t* buf, uint32_t len);
+
+uint64_t udp_sender_sent_packets();
+uint64_t udp_sender_dropped_packets();
@@ -0,0 +1,220 @@
+
+#include "usb_calib.h"
+#include "device_profile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <mutex>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define SETTLE_STEPS      1       // steps after a restart - discarded
+#define MEASURE_STEPS     4       // measurement window in steps
+#define MAX_STEPS         20      // .. extended for slow transfers - up to
+#define MIN_BLOCKS        8       // transfers in a window
+#define MAX_DROP_RATIO    0.002   // tolerance of the sample count against samplerate
+#define LATENCY_TOLERANCE 1.1     // prefer less memory, when latency is within
+
+
+static const int cal_buf_num[] = { 2, 4, 8, 15, 32 };
+static const int cal_buf_len[] = { 16, 32, 64, 128, 256 };    // in kBytes
+static constexpr int N_NUM = int(sizeof(cal_buf_num) / sizeof(cal_buf_num[0]));
+static constexpr int N_LEN = int(sizeof(cal_buf_len) / sizeof(cal_buf_len[0]));
+static constexpr int N_PAIRS = N_NUM * N_LEN;
+
+struct PairResult
+{
+  double drops;
+  double latency_ms;
+};
+
+
+std::atomic_int usb_calib_use = 1;
+
+static std::mutex mtx;    // the window is written from the callback, evaluated from the supervision
+static std::atomic_bool running = false;
+
+static std::string cal_serial;
+static int cal_srate = 0;
+static int orig_num = 0, orig_len = 0;
+static int pair_idx = -1;
+static int steps = 0;
+static PairResult results[N_PAIRS];
+static char status[160] = "not calibrated";
+
+// measurement window
+static uint64_t w_first = 0, w_prev = 0, w_max_gap = 0;
+static uint64_t w_blocks = 0, w_bytes = 0;
+static uint32_t w_len = 0;
+
+
+static void reset_window()
+{
+  w_first = w_prev = w_max_gap = 0;
+  w_blocks = w_bytes = 0;
+  w_len = 0;
+}
+
+static int pair_num(int idx) { return cal_buf_num[idx / N_LEN]; }
+static int pair_len(int idx) { return cal_buf_len[idx % N_LEN] * 1024; }
+
+static void set_status(const char* reason, int idx)
+{
+  if (idx < 0)
+    snprintf(status, sizeof(status) - 1, "%s", reason);
+  else
+    snprintf(status, sizeof(status) - 1, "%s%d transfers of %d kB at %.1f kSps: latency %.1f ms",
+      reason, pair_num(idx), pair_len(idx) / 1024, cal_srate / 1E3, results[idx].latency_ms);
+  status[sizeof(status) - 1] = 0;
+}
+
+
+bool usb_calib_start(const char* serial, int srate, int buf_num, int buf_len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (running.load() || srate <= 0)
+    return false;
+  cal_serial = serial ? serial : "";
+  cal_srate = srate;
+  orig_num = buf_num;
+  orig_len = buf_len;
+  pair_idx = -1;
+  steps = 0;
+  reset_window();
+  set_status("starting", -1);
+  running = true;
+  return true;
+}
+
+void usb_calib_abort()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!running.load())
+    return;
+  running = false;
+  set_status("stopped before completion", -1);
+}
+
+bool usb_calib_running()
+{
+  return running.load();
+}
+
+void usb_calib_block(uint32_t len, uint64_t t_begin)
+{
+  if (!running.load(std::memory_order_relaxed))
+    return;
+  std::lock_guard<std::mutex> lock(mtx);
+  if (!w_blocks)
+    w_first = t_begin;
+  else if (t_begin - w_prev > w_max_gap)
+    w_max_gap = t_begin - w_prev;
+  w_prev = t_begin;
+  ++w_blocks;
+  w_bytes += len;
+  w_len = len;
+}
+
+static void evaluate_window(PairResult& r)
+{
+  // samples between the first and the last transfer's arrival
+  const double span = double(w_prev - w_first) * 1E-9;
+  const double expected = span * cal_srate;
+  const double received = double(w_bytes - w_len) / 2.0;
+  r.drops = (w_blocks < 2 || expected <= 0.0) ? 1.0 : (1.0 - received / expected);
+  if (r.drops < 0.0)
+    r.drops = 0.0;
+  r.latency_ms = 1E-6 * double(w_max_gap);
+}
+
+static int best_pair()
+{
+  int best = -1;
+  for (int k = 0; k < N_PAIRS; ++k)
+  {
+    if (results[k].drops <= MAX_DROP_RATIO && (best < 0 || results[k].latency_ms < results[best].latency_ms))
+      best = k;
+  }
+  if (best < 0)
+    return best;
+  // with similar latency: less memory
+  const double limit = LATENCY_TOLERANCE * results[best].latency_ms;
+  for (int k = 0; k < N_PAIRS; ++k)
+  {
+    if (results[k].drops <= MAX_DROP_RATIO && results[k].latency_ms <= limit
+      && double(pair_num(k)) * pair_len(k) < double(pair_num(best)) * pair_len(best))
+      best = k;
+  }
+  return best;
+}
+
+bool usb_calib_step(int srate, int& buf_num, int& buf_len)
+{
+  if (!running.load())
+    return false;
+  std::lock_guard<std::mutex> lock(mtx);
+  if (srate != cal_srate)
+  {
+    running = false;
+    set_status("samplerate changed: dropped", -1);
+    buf_num = orig_num;
+    buf_len = orig_len;
+    return true;
+  }
+
+  if (pair_idx >= 0)
+  {
+    ++steps;
+    if (steps == SETTLE_STEPS)
+      reset_window();
+    if (steps < SETTLE_STEPS + MEASURE_STEPS || (w_blocks < MIN_BLOCKS && steps < MAX_STEPS))
+      return false;
+    evaluate_window(results[pair_idx]);
+  }
+
+  ++pair_idx;
+  steps = 0;
+  reset_window();
+  if (pair_idx < N_PAIRS)
+  {
+    buf_num = pair_num(pair_idx);
+    buf_len = pair_len(pair_idx);
+    snprintf(status, sizeof(status) - 1, "running: pair %d / %d: %d transfers of %d kB",
+      pair_idx + 1, N_PAIRS, buf_num, buf_len / 1024);
+    status[sizeof(status) - 1] = 0;
+    return true;
+  }
+
+  running = false;
+  const int best = best_pair();
+  if (best < 0)
+  {
+    set_status("no loss-free pair: kept the previous one", -1);
+    buf_num = orig_num;
+    buf_len = orig_len;
+    return true;
+  }
+
+  DeviceProfile p;
+  device_profile_get(cal_serial.c_str(), p);
+  p.usb_srate = cal_srate;
+  p.usb_buf_num = pair_num(best);
+  p.usb_buf_len = pair_len(best);
+  device_profile_set(cal_serial.c_str(), p);
+  set_status(cal_serial.empty() ? "not stored - device without serial: " : "", best);
+  buf_num = p.usb_buf_num;
+  buf_len = p.usb_buf_len;
+  return true;
+}
+
+void usb_calib_format_stats(char* s, size_t len)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  snprintf(s, len - 1, "%s", status);
+  s[len - 1] = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// calibration of the USB transfers: sweeps the number of transfers (buf_num)
+//   x the transfer size (buf_len) at the running samplerate. each pair streams
+//   for a measurement window, in which lost samples - the sample count against
+//   the samplerate - and the latency - the largest gap between transfers - are measured.
+// the loss-free pair with the lowest latency is stored in the device's profile.
+// the stream is restarted for each pair - without the host: the host's block size
+//   is kept by the reblocking. a calibration runs for about a minute.
+
+static constexpr int USB_DEFAULT_BUF_NUM = 15;  // librtlsdr's default - with buf_num 0
+
+extern std::atomic_int usb_calib_use;   // 1: use the calibrated pair of the device - at the calibrated samplerate
+
+// from settings - while streaming: starts the calibration for the device with serial.
+//   buf_num x buf_len is the running pair: restored, when no pair is loss-free
+bool usb_calib_start(const char* serial, int srate, int buf_num, int buf_len);
+// StopHW(): a running calibration is dropped
+void usb_calib_abort();
+bool usb_calib_running();
+
+// RtlSdrCallback(): arrival of one USB transfer - steady clock in ns
+void usb_calib_block(uint32_t len, uint64_t t_begin);
+// periodically from the stream supervision, with the running samplerate:
+//   true, when the stream has to be restarted with buf_num x buf_len -
+//   for the next pair, or finally with the best one
+bool usb_calib_step(int srate, int& buf_num, int& buf_len);
+
+// "running: pair k / n: x transfers of y kB" or "z transfers of y kB at r kSps: latency l ms"
+void usb_calib_format_stats(char* s, size_t len);
@@ -0,0 +1,156 @@
+
+#include "zoom_ddc.h"
+#include "lo_chain.h"
+#include "dsp.h"
+#include "control.h"
+#include "rates.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+#define MAX_ZOOM_STAGES   6     // decimation up to 64
+
+
+std::atomic_int zoom_decimation = 1;
+std::atomic_int zoom_follow_tune = 1;
+
+static std::atomic_int64_t zoom_center = 0;
+
+// only accessed from RtlSdrCallback()
+static int cur_decimation = 0;
+static SampleFormat cur_fmt = SAMPLE_U8;
+static HalfbandDecimator stages[MAX_ZOOM_STAGES];
+static NCO nco;
+static std::vector<float> work_re, work_im;
+static std::vector<uint8_t> out_buf[2];
+static unsigned out_idx = 0;
+static unsigned out_fill = 0;   // I/Q pairs
+
+static std::atomic_uint64_t stat_cpu_ns = 0;
+static std::atomic_uint64_t stat_in_samples = 0;
+
+
+static bool zoom_fits(int64_t center, int64_t hw_LO, int srate)
+{
+  const int D = zoom_decimation.load();
+  const double reach = 0.4 * srate - srate / (2.0 * D);
+  return std::fabs(double(center - hw_LO)) <= reach;
+}
+
+int64_t zoom_host_LO(int64_t hw_LO)
+{
+  return zoom_active() ? zoom_center.load() : hw_LO;
+}
+
+int64_t zoom_set_LO(int64_t host_LO, int64_t hw_LO, int srate)
+{
+  if (!zoom_active())
+    return host_LO;
+  zoom_center = host_LO;
+  return zoom_fits(host_LO, hw_LO, srate) ? hw_LO : host_LO;
+}
+
+bool zoom_tune_changed(int64_t tune_freq)
+{
+  if (!zoom_active() || !zoom_follow_tune.load() || tune_freq == zoom_center.load())
+    return false;
+  zoom_center = tune_freq;
+  const int srate = rates::tab[nxt.srate_idx].valueInt;
+  if (!zoom_fits(tune_freq, host_LO_from_hw(nxt.LO_freq.load()), srate))
+  {
+    // the zoomed band left the tuner's band. a running sweep keeps the LO for its end
+    if (set_hw_LO_from_host(tune_freq, tune_freq))
+      trigger_control(CtrlFlags::freq);
+  }
+  return true;
+}
+
+
+void zoom_reset()
+{
+  cur_decimation = 0;
+}
+
+static void zoom_init(int D, uint32_t len, SampleFormat fmt)
+{
+  cur_decimation = D;
+  cur_fmt = fmt;
+  for (unsigned k = 0; k < MAX_ZOOM_STAGES; ++k)
+    stages[k].reset();
+  nco.reset();
+  work_re.resize(len / 2);
+  work_im.resize(len / 2);
+  out_buf[0].resize(size_t(len / 2) * dsp_sample_pair_size(fmt));
+  out_buf[1].resize(size_t(len / 2) * dsp_sample_pair_size(fmt));
+  out_idx = 0;
+  out_fill = 0;
+  stat_cpu_ns = 0;
+  stat_in_samples = 0;
+}
+
+const void* zoom_feed(const uint8_t* buf, uint32_t len, SampleFormat fmt)
+{
+  const auto t0 = std::chrono::steady_clock::now();
+  const int D = zoom_decimation.load();
+  if (D != cur_decimation || fmt != cur_fmt || work_re.size() != len / 2)
+    zoom_init(D, len, fmt);
+
+  const unsigned n_pairs = len / 2;
+  const int srate = rates::tab[last.srate_idx].valueInt;
+  nco.set_freq(-double(zoom_center.load() - last.LO_freq.load()) / srate);
+
+  float* re = work_re.data();
+  float* im = work_im.data();
+  for (unsigned k = 0; k < n_pairs; ++k)
+  {
+    re[k] = (float(buf[2 * k]) - 127.5F) * (1.0F / 127.5F);
+    im[k] = (float(buf[2 * k + 1]) - 127.5F) * (1.0F / 127.5F);
+  }
+  nco.mix(re, im, re, im, n_pairs);
+  unsigned n = n_pairs;
+  for (unsigned s = 0; (1 << (s + 1)) <= D && s < MAX_ZOOM_STAGES; ++s)
+    n = stages[s].process(re, im, n);
+
+  // collect into host blocks of n_pairs
+  const void* complete = nullptr;
+  const float pcm16_scale = dsp_pcm16_scale(D);
+  for (unsigned k = 0; k < n; )
+  {
+    const unsigned c = (n - k < n_pairs - out_fill) ? (n - k) : (n_pairs - out_fill);
+    dsp_store_samples(re + k, im + k, c, out_buf[out_idx].data(), out_fill, fmt, pcm16_scale);
+    k += c;
+    out_fill += c;
+    if (out_fill == n_pairs)
+    {
+      complete = out_buf[out_idx].data();
+      out_idx ^= 1;
+      out_fill = 0;
+    }
+  }
+
+  const auto t1 = std::chrono::steady_clock::now();
+  stat_cpu_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  stat_in_samples += n_pairs;
+  return complete;
+}
+
+
+void zoom_format_stats(char* s, size_t len)
+{
+  const int D = zoom_decimation.load();
+  const int srate = rates::tab[last.srate_idx].valueInt;
+  const uint64_t in_samples = stat_in_samples.load();
+  const double load = in_samples ? (stat_cpu_ns.load() * 1E-9) / (double(in_samples) / srate) : 0.0;
+  snprintf(s, len - 1, "decimation %d, output %.1f kSps, offset %lld Hz, %.1f %% CPU",
+    D, srate / 1E3 / D, (long long)(zoom_host_LO(last.LO_freq.load()) - last.LO_freq.load()), 100.0 * load);
+  s[len - 1] = 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "ds_hilbert.h"
+#include "resampler.h"
+#include "dsp.h"
+
+// zoom: digital down conversion for the host's stream.
+// the NCO mixes the zoom center to zero, a cascade of half-band filters
+//   decimates by zoom_decimation. the host gets samplerate / zoom_decimation
+//   and sees the zoom center as its LO (virtual LO).
+// with 'follow tune', the zoom center follows TuneChanged() - without USB retune,
+//   as long as the zoomed band stays inside the tuner's band.
+// zoom is off, while the direct sampling conversion or the resampler is active.
+// the host's block size is kept: decimated samples are collected
+//   over zoom_decimation USB blocks. 16 bit and float output keep the
+//   added resolution of the decimation - see dsp_pcm16_scale().
+
+extern std::atomic_int zoom_decimation;   // 1: off, 2 .. 64: power of 2
+extern std::atomic_int zoom_follow_tune;  // 0: zoom center = host's LO, 1: = host's tune frequency
+
+inline bool zoom_active() { return zoom_decimation.load() > 1 && !ds_hilbert_active() && !resample_active(); }
+
+// host's LO - the zoom center - when zoom is active, else hw_LO
+int64_t zoom_host_LO(int64_t hw_LO);
+// SetHWLO(): set the zoom center. returns the LO for the tuner:
+//   unchanged hw_LO while the zoomed band fits into the tuner's band
+int64_t zoom_set_LO(int64_t host_LO, int64_t hw_LO, int srate);
+// TuneChanged(): returns true, when the zoom center moved and the host's LO changed
+bool zoom_tune_changed(int64_t tune_freq);
+
+// called from RtlSdrCallback(): returns a complete host block of len / 2 I/Q pairs
+//   in format fmt - or nullptr, while collecting
+const void* zoom_feed(const uint8_t* buf, uint32_t len, SampleFormat fmt);
+void zoom_reset();
+
+// "decimation n, output x kSps, offset y Hz, z % CPU"
+void zoom_format_stats(char* s, size_t len);